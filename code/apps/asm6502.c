@@ -7,6 +7,101 @@
  *
  * Revision history:
  *
+ * 10/18/2026
+ *  Added line index - sparse table of text record addresses (anchor every
+ *  LIDX_STEP lines) kept in upper RAM (XBSS). goto_line() and listing start
+ *  from the nearest anchor, so reading source lines during compilation no
+ *  longer walks the text buffer from the beginning for each line.
+ *
+ * 10/18/2026
+ *  Text buffer format version 2 (see textbuf.h), records don't store line
+ *  numbers. Gap left in the buffer by text editor is skipped.
+ *  Buffers in old format are refused, they are converted by texted.
+ *
+ * 10/18/2026
+ *  Tail address, line count and free space cached in text buffer header.
+ *  Once the output buffer was checked, check_buf() validates and uses the
+ *  cached values, so add2output() appends in constant time.
+ *
+ * 10/18/2026
+ *  Mnemonics are found with perfect hash (opc_find()) instead of copying and
+ *  comparing OpCodes entries one by one. Mnemonics are not case sensitive.
+ *  Added missing BVS instruction to OpCodes.
+ *  Assembly shows its time (MOS timer, 1/64 s) and the time per line in
+ *  microseconds (all passes), to measure the assembler on the target.
+ *
+ * 10/18/2026
+ *  Symbol table moved from 64 fixed size entries in RAM to its own RAM bank
+ *  (symbol bank, bank 6 by default, set with 'b'). Open addressing hash
+ *  table of SYMB_SLOTS entries points to symbols with variable length
+ *  names. Command 'm' shows symbol table load statistics.
+ *
+ * 10/18/2026
+ *  Assembler core: expressions, addressing modes, directives .org, .byte,
+ *  .word and name = expr assignment. Command 'a' assembles in 2 passes,
+ *  'a 1' in single pass - forward references are recorded in fixup table
+ *  (XBSS) and patched in the output at the end. Source code records are
+ *  read in order, without line lookups. check_buf() selects the bank.
+ *
+ * 10/18/2026
+ *  Option 'm' of command 'a' puts machine code directly to output bank
+ *  instead of monitor commands. Code for addresses $8000 - $BFFF is put at
+ *  its address (it runs in place once the bank is selected), other code
+ *  is put in the bank starting at $8000. Option 'l' lists assembled code.
+ *  Symbol bank records that output bank holds machine code (AST_CODE),
+ *  commands 'm', 'b', 'l out' and the start of program show its address
+ *  range instead of checking the bank as text buffer.
+ *
+ * 10/18/2026
+ *  Zero page mode is also selected for forward references, passes are
+ *  repeated until symbol values don't change (ASM_MAXPASS max.), 2-nd pass
+ *  is the last one if sizes guessed in the 1-st pass were right.
+ *  Option 'b' of command 'a' replaces branches out of range with inverted
+ *  branch over JMP.
+ *
+ * 10/18/2026
+ *  Listing shows cycles of each instruction (OpCycles table) and cycle
+ *  totals of blocks of code starting at labels.
+ *
+ * 10/19/2026
+ *  Program didn't fit in memory anymore. Linked with its own configuration
+ *  asm6502.cfg: code and read-only data share one memory area. Help ('h'),
+ *  info ('m', 'b', banner), listing ('l') and the start and end of
+ *  assembly (incremental assembly setup, fixups, summary) are overlays
+ *  linked to run at the same address, loaded to RAM bank OVL_BANK (file
+ *  asm6502_ovl.txt) before the program, ovl_load() copies the one needed
+ *  to the overlay area. Line index anchor every 32 lines, unused
+ *  delete_text(), relink() and assert() removed.
+ *
+ * 10/18/2026
+ *  Parsing and encoding of source code moved to asm6502core.c, so it can
+ *  be built for host computer as well (see xasm6502.c). This file reads
+ *  the source from text buffer, keeps symbol table in RAM bank and writes
+ *  the output to output bank.
+ *
+ * 10/18/2026
+ *  Incremental assembly, option 'i' of 'a m'. Line info (hash of text,
+ *  address and size of code, flags) of each line and the state of the
+ *  assembly are kept in symbol bank. Only lines from the 1-st changed one
+ *  (and earlier lines with forward references) are assembled again, or
+ *  just the changed line if its code keeps its size and address. Symbols
+ *  record the line# that defined them (see symb_read()). All lines are
+ *  assembled instead if a wide line (absolute operand, long branch) gets
+ *  operand in zero page or short branch, e.g. when symbol moves from
+ *  absolute to zero page, or code goes back over other code (.org back),
+ *  so code is the same as after 'a m'.
+ *
+ * 10/18/2026
+ *  Option 'o' of 'a' - peephole optimization (see peep_ins() in
+ *  asm6502core.c), bytes and cycles saved are shown in the summary.
+ *
+ * 10/18/2026
+ *  Directive '.include bank#' assembles text buffer in another RAM bank
+ *  in place of the line, macros (.macro, .endm) are read again from their
+ *  bank for each call. Nothing is copied to the source code buffer, see
+ *  src_push(). Incremental assembly is not used with them (line info is
+ *  not kept).
+ *
  *  ..........................................................................
  *  TO DO:
  *
@@ -24,17 +119,51 @@
 #include "mkhbcos_ml.h"
 #include "mkhbcos_ds1685.h"
 #include "romlib.h"
+#include "textbuf.h"
+#include "asm6502core.h"
 
 #define IBUF1_SIZE      20
-#define IBUF2_SIZE      20
-#define IBUF3_SIZE      20
 #define PROMPTBUF_SIZE  80
 #define TEXTLINE_SIZE   80
 #define RADIX_DEC       10
 #define RADIX_HEX       16
 #define RADIX_BIN       2
-#define MAX_LINES       ((END_BRAM-START_BRAM)/6)
-#define SYMBTBL_SIZE    64
+#define MAX_LINES       ((END_BRAM-START_TEXT)/TBREC_SIZE)
+#define SYMB_BANK       6       // default RAM bank of symbol table
+#define SYMB_SLOTS      2048    // hash table slots, power of 2
+#define SYMB_SHIFT      5       // 16 - log2(SYMB_SLOTS)
+#define SYMB_MAXCOUNT   (SYMB_SLOTS / 8 * 7)    // max. load 7/8
+#define SYMB_TABLE      START_BRAM              // hash table in symbol bank
+#define SYMB_STATE      (START_BRAM + SYMB_SLOTS * 2)   // assembler state
+#define SYMB_POOL       (SYMB_STATE + sizeof(struct asm_state)) // symbols
+#define SYMB_VAL        0       // offsets in symbol
+#define SYMB_FLAGS      2
+#define SYMB_LINE       3       // line# that defined the symbol
+#define SYMB_LEN        5
+#define SYMB_NAME       6
+#define AST_MAGIC       0x6502  // assembler state is valid
+#define AST_CODE        0x6503  // only output bank info is valid (code)
+#define LINF_SIZE       6       // line info (at the end of symbol bank)
+#define LINF_HASH       0       // offsets in line info: hash of text,
+#define LINF_PC         2       //  address of code,
+#define LINF_LEN        4       //  # of bytes of code,
+#define LINF_FLAGS      5       //  flags
+#define LINF_FWD        0x01    // flags: line uses forward reference,
+#define LINF_DEF        0x02    //        defines symbol,
+#define LINF_WIDE       0x04    //        is wide (see asm6502core.c)
+#define LINF_ADDR(line) (END_BRAM - ((line) + 1) * LINF_SIZE)
+#define LIDX_STEP       32      // line index: anchor every 32 lines
+#define LIDX_SIZE       (0x4000/TBREC_SIZE/LIDX_STEP+1) // max. anchors
+#define OUT_MAXBYTES    16      // max. # of bytes in line of output
+#define SRC_DEPTH       8       // max. # of nested .include and macro calls
+#define OVL_BANK        3       // RAM bank reserved for overlays
+#define OVL_SLOT        0x0900  // overlay# n is at START_BRAM + n * OVL_SLOT
+#define OVL_HELP        0       // overlay of 'h' (OVERLAY1)
+#define OVL_INFO        1       // overlay of 'b', 'm' and banner (OVERLAY2)
+#define OVL_LIST        2       // overlay of 'l' (OVERLAY3)
+#define OVL_ASM         3       // start and end of assembly (OVERLAY4)
+#define OVL_COUNT       4
+#define OVL_NONE        0xFF    // no valid overlay in the overlay area
 
 // command codes
 enum cmdcodes
@@ -46,6 +175,7 @@ enum cmdcodes
     CMD_BANK,
     CMD_INFO,
     CMD_ERASE,
+    CMD_ASM,
 	//-------------
 	CMD_UNKNOWN
 };
@@ -54,184 +184,119 @@ const char *ver = "1.0.0.\n\r";
 
 // next pointer in last line's header in text buffer should point to
 // such content in memory
-const char null_txt_hdr[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00};
+const char null_txt_hdr[] = {0xFF, 0xFF, 0xFF, 0x00};
 
 // some other commonly used constants, defining them here and using pointers
 // saves some code space
 const char *divider = "--------------------------------------------\n\r";
 
-// error codes
-enum eErrors {
-    ERROR_OK = 0,
-    ERROR_BADCMD,
-    ERROR_BADARG,
-    ERROR_NOTEXT,
-    ERROR_BUFNOTINIT,
-    ERROR_ADDROOR,
-    ERROR_TIMEOUT,
-    ERROR_FULLBUF,
-    ERROR_BADBANK,
-    ERROR_BANKSEQUAL,
-    ERROR_SYMBFULL,
-    //------------------
-    ERROR_UNKNOWN
+// Overlays. Signature of each overlay must match ovl_sig, so an overlay
+// left in OVL_BANK by another build of the program is not run.
+extern uint16_t _OVERLAY1_LOAD__, _OVERLAY1_SIZE__;
+extern uint16_t _OVERLAY2_LOAD__, _OVERLAY2_SIZE__;
+extern uint16_t _OVERLAY3_LOAD__, _OVERLAY3_SIZE__;
+extern uint16_t _OVERLAY4_LOAD__, _OVERLAY4_SIZE__;
+extern const char ovl_sighelp[], ovl_siginfo[], ovl_siglist[], ovl_sigasm[];
+const char ovl_sig[] = __DATE__ " " __TIME__;
+uint16_t * const ovl_run[OVL_COUNT] =
+{
+    &_OVERLAY1_LOAD__, &_OVERLAY2_LOAD__, &_OVERLAY3_LOAD__, &_OVERLAY4_LOAD__
 };
-
-// Error messages.
-const char *ga_errmsg[13] =
-{
-    "OK.",
-    "Unknown command.",
-    "Check arguments.",
-    "No text in buffer.",
-    "Buffer was never initialized.",
-    "Address out of range.",
-    "Timeout during text buffer search operation.",
-    "Buffer full.",
-    "Invalid RAM bank#. (expected: 0..7)",
-    "Code and output buffers must be in different banks.",
-    "Symbol table full.",
-    "Unknown."
+uint16_t * const ovl_size[OVL_COUNT] =
+{
+    &_OVERLAY1_SIZE__, &_OVERLAY2_SIZE__, &_OVERLAY3_SIZE__, &_OVERLAY4_SIZE__
 };
-
-// Usage help.
-const char *helptext[24] =
+const char * const ovl_sigs[OVL_COUNT] =
 {
-    "\n\r",
-    " b : set buffers (bank #-s) for source code and for output\n\r",
-    "     b <src_bank#> [out_bank#]\n\r",
-    " l : List buffer contents.\n\r",
-    "     l <src | out> <all | from_line#>[-to_line# | -end] [n]\n\r",
-    "      src - source code buffer\n\r",
-    "      out - output buffer\n\r",
-    "      n - show line numbers\n\r",
-    "      all - list all content\n\r",
-    " a : assembly (compile) source code.\n\r",
-    "     NOTE: output will be appended at the end of output buffer.\n\r",
-    "           This way it is possible to compile multiple source code\n\r",
-    "           buffers into single output buffer.\n\r",
-    " x : exit program, leave contents in buffers.\n\r",
-    " e : erase output buffer.\n\r",
-    " m : show memory information and symbols table.\n\r",
-    "NOTE:\n\r",
-    "   Default to_line# is the same as from_line#.\n\r",
-    "   Arguments are <mandatory> OR [optional].\n\r",
-    "   For range arguments, SPACE can be used instead of '-'.\n\r",
-    "   'end' - last line of text.\n\r",
-    "\n\r",
-    "@EOH"
+    ovl_sighelp, ovl_siginfo, ovl_siglist, ovl_sigasm
 };
 
 // Buffer for current source code record (line).
 struct text_line {
-    unsigned int num;
     unsigned char len;
     uint16_t next_ptr;
     char text[TEXTLINE_SIZE];
 } CurrLine;
 
-enum eAddrModes {
-    IMM = 0,    // #aa
-    ABS,        // aaaa
-    ZPG,        // aa
-    IMP,
-    INDABS,     // (aaaa)
-    ABSINX,     // aaaa,X
-    ABSINY,     // aaaa,Y
-    ZPGINX,     // aa,X
-    ZPGINY,     // aa,Y
-    INXIND,     // (aa,X)
-    INDINY,     // (aa),Y
-    REL,        // aaaa
-    ACC         // Acc
+// State of the last assembly with option 'm', kept in symbol bank at
+// SYMB_STATE. Together with the symbol table and line info it allows
+// incremental assembly (option 'i'). It also tells that the output bank
+// holds machine code, not text (see out_iscode()).
+struct asm_state {
+    uint16_t magic;             // AST_MAGIC or AST_CODE if valid
+    unsigned char code_bank;    // banks of source code and machine code
+    unsigned char out_bank;
+    unsigned char opts;         // options (OPT_LONGBR matters)
+    unsigned char pass;         // # of the last pass
+    unsigned int lines;         // # of lines of source code (line info)
+    unsigned int symb_count;    // symbol table: # of symbols,
+    uint16_t symb_free;         //  free space,
+    uint16_t symb_end;          //  end of symbols (line info follows)
+    uint16_t bin_base;          // output: address of code at START_BRAM,
+    uint16_t bin_top;           //  size of machine code image,
+    unsigned int bytes;         //  # of bytes of code
 };
 
-struct symb {
-    char name[36];
-    uint16_t val;
+// Source code being assembled: text buffer in RAM bank, address of the
+// next record and its line#.
+struct source {
+    unsigned char bank;
+    unsigned char macro;        // lines of macro, see mac_line()
+    uint16_t addr;
+    unsigned int line;
 };
 
-struct instr {
-    char mnem[4];   // assembly mnemonic of the instruction
-    unsigned char opcode[14];   // op-codes for each addressing mode
+// Line index anchor: address of the text record of line# line.
+struct lidx_anchor {
+    unsigned int line;
+    uint16_t addr;
 };
 
-const struct instr OpCodes[57] = {
-    // aa = Z (8-bit value), aaaa = Address (16-bit value), Acc - accumulator (register)
-    //instr  IMM   ABS   ZPG   IMP   INDAB ABINX ABINY ZPGIX ZPGIY IXIND INDIY REL   ACC
-    //       #Z    A     Z           (A)   A,X   A,Y   Z,X   Z,Y   (Z,X) (Z),Y A     Acc
-    {"adc", {0x69, 0x6D, 0x65, 0x00, 0x00, 0x7D, 0x79, 0x75, 0x00, 0x61, 0x71, 0x00, 0x00, 0x00}},
-    {"and", {0x29, 0x2D, 0x25, 0x00, 0x00, 0x3D, 0x39, 0x35, 0x00, 0x21, 0x31, 0x00, 0x00, 0x00}},
-    {"asl", {0x00, 0x0E, 0x06, 0x00, 0x00, 0x1E, 0x00, 0x16, 0x00, 0x00, 0x00, 0x00, 0x0A, 0x00}},
-    {"bit", {0x00, 0x2C, 0x24, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"bpl", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00}},
-    {"bmi", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00}},
-    {"bvc", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x50, 0x00, 0x00}},
-    {"bcc", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00}},
-    {"bcs", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xB0, 0x00, 0x00}},
-    {"bne", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xD0, 0x00, 0x00}},
-    {"beq", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x00, 0x00}},
-    {"cmp", {0xC9, 0xCD, 0xC5, 0x00, 0x00, 0xDD, 0xD9, 0xD5, 0x00, 0xC1, 0xD1, 0x00, 0x00, 0x00}},
-    {"cpx", {0xE0, 0xEC, 0xE4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"cpy", {0xC0, 0xCC, 0xC4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"dec", {0x00, 0xCE, 0xC6, 0x00, 0x00, 0xDE, 0x00, 0xD6, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"eor", {0x49, 0x4D, 0x45, 0x00, 0x00, 0x5D, 0x59, 0x55, 0x00, 0x41, 0x51, 0x00, 0x00, 0x00}},
-    {"clc", {0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"sec", {0x00, 0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"cli", {0x00, 0x00, 0x00, 0x58, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"sei", {0x00, 0x00, 0x00, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"clv", {0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"cld", {0x00, 0x00, 0x00, 0xD8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"sed", {0x00, 0x00, 0x00, 0xF8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"inc", {0x00, 0xEE, 0xE6, 0x00, 0x00, 0xFE, 0x00, 0xF6, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"jmp", {0x00, 0x4C, 0x00, 0x00, 0x6C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"jsr", {0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"lda", {0xA9, 0xAD, 0xA5, 0x00, 0x00, 0xBD, 0xB9, 0xB5, 0x00, 0xA1, 0xB1, 0x00, 0x00, 0x00}},
-    {"ldx", {0xA2, 0xAE, 0xA6, 0x00, 0x00, 0x00, 0xBE, 0x00, 0xB6, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"ldy", {0xA0, 0xAC, 0xA4, 0x00, 0x00, 0xBC, 0x00, 0xB4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"lsr", {0x00, 0x4E, 0x46, 0x00, 0x00, 0x5E, 0x00, 0x56, 0x00, 0x00, 0x00, 0x00, 0x4A, 0x00}},
-    {"nop", {0x00, 0x00, 0x00, 0xEA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"ora", {0x09, 0x0D, 0x05, 0x00, 0x00, 0x1D, 0x19, 0x15, 0x00, 0x01, 0x11, 0x00, 0x00, 0x00}},
-    {"tax", {0x00, 0x00, 0x00, 0xAA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"txa", {0x00, 0x00, 0x00, 0x8A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"dex", {0x00, 0x00, 0x00, 0xCA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"inx", {0x00, 0x00, 0x00, 0xE8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"tay", {0x00, 0x00, 0x00, 0xA8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"tya", {0x00, 0x00, 0x00, 0x98, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"dey", {0x00, 0x00, 0x00, 0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"iny", {0x00, 0x00, 0x00, 0xC8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    // aa = Z (8-bit value), aaaa = Address (16-bit value), Acc - accumulator (register)
-    //instr  IMM   ABS   ZPG   IMP   INDAB ABINX ABINY ZPGIX ZPGIY IXIND INDIY REL   ACC
-    //       #Z    A     Z           (A)   A,X   A,Y   Z,X   Z,Y   (Z,X) (Z),Y A     Acc
-    {"rol", {0x00, 0x2E, 0x26, 0x00, 0x00, 0x3E, 0x00, 0x36, 0x00, 0x00, 0x00, 0x00, 0x2A, 0x00}},
-    {"ror", {0x00, 0x6E, 0x66, 0x00, 0x00, 0x7E, 0x00, 0x76, 0x00, 0x00, 0x00, 0x00, 0x6A, 0x00}},
-    {"rti", {0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"rts", {0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"sbc", {0xE9, 0xED, 0xE5, 0x00, 0x00, 0xFD, 0xF9, 0xF5, 0x00, 0xE1, 0xF1, 0x00, 0x00, 0x00}},
-    {"sta", {0x00, 0x8D, 0x85, 0x00, 0x00, 0x9D, 0x99, 0x95, 0x00, 0x81, 0x91, 0x00, 0x00, 0x00}},
-    {"txs", {0x00, 0x00, 0x00, 0x9A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"tsx", {0x00, 0x00, 0x00, 0xBA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"pha", {0x00, 0x00, 0x00, 0x48, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"pla", {0x00, 0x00, 0x00, 0x68, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"php", {0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"plp", {0x00, 0x00, 0x00, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"stx", {0x00, 0x8E, 0x86, 0x00, 0x00, 0x00, 0x00, 0x00, 0x96, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"sty", {0x00, 0x8C, 0x84, 0x00, 0x00, 0x00, 0x00, 0x94, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"brk", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
-    {"nnn", {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}}
-};
+// Line index, sorted by line#. 1-st anchor is always line #0.
+// Table is large, so it is kept in upper RAM (not cleared at start).
+#pragma bss-name (push, "XBSS")
+struct lidx_anchor lidx[LIDX_SIZE];
+#pragma bss-name (pop)
 
 // globals
 int  cmd_code = CMD_NULL;
 char prompt_buf[PROMPTBUF_SIZE];
 char out_buf[TEXTLINE_SIZE];
-char ibuf1[IBUF1_SIZE], ibuf2[IBUF2_SIZE], ibuf3[IBUF3_SIZE];
+char ibuf1[IBUF1_SIZE];
 char bankinit_flags[8];
-struct symb symbol_table[SYMBTBL_SIZE];
+unsigned int lidx_count;    // # of anchors in line index, 0 - not valid
+unsigned char lidx_bank;    // RAM bank# the line index was built for
 unsigned int line_num, line_count, last_line;
-uint16_t curr_addr, lastaddr, asm_pc;
-int code_bank_num, out_bank_num, bank_num, symb_idx;
+uint16_t curr_addr, lastaddr;
+int code_bank_num, out_bank_num, bank_num, symb_bank_num;
+unsigned char ram_bank;         // RAM bank# to select
+unsigned int symb_count;        // # of symbols in symbol table
+uint16_t symb_free;             // free space in symbol bank
+uint16_t symb_end;              // end of symbols (line info follows)
+unsigned long symb_lookups;     // # of symbol table lookups
+unsigned long symb_probes;      // # of hash table slots visited by them
+uint16_t out_pc;                // address of next byte in out_buf
+uint16_t out_rec;               // address out_buf will be written to
+unsigned char out_n, out_col;   // # of bytes and length of out_buf
+unsigned char out_full;         // output buffer full
+uint16_t bin_base;              // address of code put at START_BRAM
+uint16_t bin_top;               // size of machine code image
+unsigned char bin_back;         // code put over other code (.org back)
+struct asm_state ast;           // state of the last assembly
 unsigned long tmr64;
+unsigned long asm_ticks;        // time of the assembly in 1/64 s
+unsigned long asm_count;        // # of lines passed to asm6502() by it
+unsigned int linf_lines;        // # of lines with line info, 0 - none
+unsigned char inc_pass;         // 1-st pass of incremental assembly
+                                // (0 - assembly from the 1-st line)
+unsigned int inc_from, inc_to;  // lines inc_from..inc_to-1 are assembled
+unsigned char inc_fwd;          // and earlier lines with forward references
+unsigned int inc_first;         // the 1-st line assembled
+unsigned int inc_lines;         // # of lines assembled in the last pass
+uint16_t inc_pc;                // address of code of line inc_from
+struct source src_stack[SRC_DEPTH];     // source code, .include, macros
+unsigned char src_depth;        // # of entries in src_stack
+unsigned char ovl_curr;         // overlay in the overlay area
 
 // Functions prototypes.
 void        get_line(void);
@@ -247,6 +312,10 @@ void        list_buf(void);
 void        pause_sec64(uint16_t delay);
 int         isnull_hdr(const char *hdr);
 void        init_buf(void);
+void        ast_save(void);
+void        ast_clear(void);
+int         out_iscode(void);
+void        prn_code(uint16_t base, uint16_t top);
 void        set_buffers(void);
 void        mem_info(void);
 int         check_buf(int bank);
@@ -254,211 +323,1172 @@ int         isaddr_oor(uint16_t addr);
 void        set_timeout(int secs);
 int         is_timeout(void);
 void        write_text2mem(uint16_t addr);
-void        assert(uint16_t line, int cond, const char *msg);
 void        add2output(const char *txt);
 uint16_t    goto_line(unsigned int gtl);
-void        delete_text(unsigned int from_line, unsigned int to_line);
-uint16_t    renumber(uint16_t addr, int offs);
-void        compile(void);
-void        asm6502(const char *buf, uint16_t pass);
-void        read_line(int lnum, char *buf);
-void        add_label2symb(const char *lbl, uint16_t val);
+void        compile(unsigned char passes, unsigned char opts);
+void        asm_summary(unsigned char opts);
+int         asm_source(void);
+void        src_push(unsigned char bank, uint16_t addr, unsigned char macro);
+uint16_t    line_hash(const char *s);
+void        linf_put(uint16_t hash);
+unsigned char inc_prepare(unsigned char opts);
+void        inc_resume(unsigned char opts);
+int         inc_line(unsigned int line);
+int         inc_skip(void);
+int         inc_sizeok(void);
+void        asm_cmd(void);
+void        fix_resolve(void);
+void        emit_code(void);
+void        emit_bin(void);
+void        out_flush(void);
+void        sel_bank(unsigned char bank);
+void        symb_init(void);
+uint16_t    symb_slot(const char *name, unsigned char len);
+void        symb_name(uint16_t sym, char *buf);
+void        fix_error(int errnum, const struct fixup *f);
+void        symb_stats(void);
+void        lidx_build(void);
+unsigned int lidx_search(unsigned int line);
+unsigned int lidx_find(unsigned int line);
+uint16_t    tb_next(uint16_t addr);
+uint16_t    tb_first(void);
+void        tb_putcache(uint16_t gap);
+int         tb_cacheok(void);
+int         ovl_load(unsigned char ovl);
 
 ////////////////////////////// CODE /////////////////////////////////////
 
 /*
- * Add entry / item (name, value) to symbol table.
+ * Output of text for assembler core.
+ */
+void asm_puts(const char *s)
+{
+    puts(s);
+}
+
+/*
+ * Select RAM bank.
+ */
+void sel_bank(unsigned char bank)
+{
+    ram_bank = bank;
+    __asm__("lda %v", ram_bank);
+    __asm__("jsr %w", MOS_BANKEDRAMSEL);
+}
+
+/*
+ * Clear symbol table, state of the last assembly is no longer valid.
+ */
+void symb_init(void)
+{
+    unsigned char bank = *RAMBANKNUM;
+
+    sel_bank(symb_bank_num);
+    memset((void *)SYMB_TABLE, 0, SYMB_SLOTS * 2);
+    if (AST_MAGIC == PEEKW(SYMB_STATE)) {
+        POKEW(SYMB_STATE, AST_CODE);    // symbols are gone, code is not
+    }
+    sel_bank(bank);
+    symb_count = 0;
+    symb_end = END_BRAM;
+    symb_free = END_BRAM - SYMB_POOL;
+    symb_lookups = 0;
+    symb_probes = 0;
+}
+
+/*
+ * Return address of the hash table slot of symbol name (len characters,
+ * not null terminated). The slot points to the symbol or it is the empty
+ * slot for the new symbol. Symbol bank must be selected.
+ * Slots are probed linearly from the hash of the name.
+ */
+uint16_t symb_slot(const char *name, unsigned char len)
+{
+    uint16_t h = 0;
+    uint16_t slot, sym;
+    unsigned char i;
+
+    for (i = 0; i < len; i++) {
+        h = (h << 5) + h + (unsigned char)name[i];
+    }
+    // Fibonacci hashing - upper bits of h * 2^16 / golden ratio
+    h = (uint16_t)(h * 40503U) >> SYMB_SHIFT;
+    symb_lookups++;
+    while (1) {
+        symb_probes++;
+        slot = SYMB_TABLE + ((h & (SYMB_SLOTS - 1)) << 1);
+        sym = PEEKW(slot);
+        if (0 == sym
+            || (PEEK(sym + SYMB_LEN) == len
+                && 0 == memcmp((const void *)(sym + SYMB_NAME), name, len))) {
+
+            break;
+        }
+        h++;
+    }
+
+    return slot;
+}
+
+/*
+ * Return address of symbol name (len characters) in symbol bank.
+ * If add is non-zero, symbol not found in symbol table is added to it
+ * (undefined). Return 0 if symbol was not found or symbol table is full.
+ */
+uint16_t symb_find(const char *name, unsigned char len, unsigned char add)
+{
+    unsigned char bank = *RAMBANKNUM;
+    uint16_t slot, sym;
+
+    if (len > SYMB_NAMELEN) {
+        len = SYMB_NAMELEN;
+    }
+    sel_bank(symb_bank_num);
+    slot = symb_slot(name, len);
+    sym = PEEKW(slot);
+    if (0 == sym && add
+        && symb_count < SYMB_MAXCOUNT && symb_free >= SYMB_NAME + len) {
+
+        // new symbol is interned at the end of symbols
+        sym = symb_end - symb_free;
+        POKEW(sym + SYMB_VAL, 0);
+        POKE(sym + SYMB_FLAGS, 0);
+        POKE(sym + SYMB_LEN, len);
+        memcpy((void *)(sym + SYMB_NAME), name, len);
+        POKEW(slot, sym);
+        symb_free -= SYMB_NAME + len;
+        symb_count++;
+    }
+    sel_bank(bank);
+
+    return sym;
+}
+
+/*
+ * Read value of symbol at address sym to val, return its flags
+ * (0 - undefined symbol).
+ * Incremental assembly: symbol defined by line that is not assembled is
+ * read as defined in the current pass (in the previous pass if the line
+ * follows the current one, the reference is forward). Symbol of line that
+ * is assembled, not defined again after the 1-st pass, is undefined.
+ */
+unsigned char symb_read(uint16_t sym, uint16_t *val)
+{
+    unsigned char bank = *RAMBANKNUM;
+    unsigned char flags;
+    unsigned int line;
+
+    sel_bank(symb_bank_num);
+    *val = PEEKW(sym + SYMB_VAL);
+    flags = PEEK(sym + SYMB_FLAGS);
+    if (inc_pass && flags) {
+        line = PEEKW(sym + SYMB_LINE);
+        if (0 == inc_line(line)) {
+            flags = (flags & ~SYMB_PASSMASK)
+                    | (line > asm_line ? asm_pass - 1 : asm_pass);
+        } else if ((flags & SYMB_PASSMASK) < inc_pass
+                   && asm_pass > inc_pass) {
+
+            flags = 0;
+        }
+    }
+    sel_bank(bank);
+
+    return flags;
+}
+
+/*
+ * Set value and flags of symbol at address sym.
+ */
+void symb_write(uint16_t sym, uint16_t val, unsigned char flags)
+{
+    unsigned char bank = *RAMBANKNUM;
+
+    sel_bank(symb_bank_num);
+    POKEW(sym + SYMB_VAL, val);
+    POKE(sym + SYMB_FLAGS, flags);
+    POKEW(sym + SYMB_LINE, asm_line);
+    sel_bank(bank);
+}
+
+/*
+ * Copy name of symbol at address sym to buf (null terminated).
+ */
+void symb_name(uint16_t sym, char *buf)
+{
+    unsigned char bank = *RAMBANKNUM;
+    unsigned char len;
+
+    sel_bank(symb_bank_num);
+    len = PEEK(sym + SYMB_LEN);
+    memcpy(buf, (const void *)(sym + SYMB_NAME), len);
+    buf[len] = 0;
+    sel_bank(bank);
+}
+
+/*
+ * Report error errnum of fixup f, found when forward references are
+ * patched: line of source code the fixup comes from and its symbol.
+ */
+void fix_error(int errnum, const struct fixup *f)
+{
+    char name[SYMB_NAMELEN + 1];
+
+    puts("\n\rERROR in line #");
+    puts(utoa(f->line, ibuf1, RADIX_DEC));
+    if (f->unit != asm_main) {
+        puts(" of bank#");
+        puts(utoa(f->unit, ibuf1, RADIX_DEC));
+    }
+    puts(": ");
+    puts(ga_errmsg[errnum]);
+    puts("\n\rSymbol: ");
+    symb_name(f->sym, name);
+    puts(name);
+    puts("\n\r");
+    asm_errors++;
+}
+
+/*
+ * Write pending line of output (monitor command) to output buffer.
+ */
+void out_flush(void)
+{
+    if (out_n) {
+        add2output(out_buf);
+        if (out_rec == lastaddr - strlen(null_txt_hdr)) {
+            out_full = 1;       // output buffer full, line was not added
+        }
+        out_rec = lastaddr - strlen(null_txt_hdr);
+        out_n = 0;
+    }
+}
+
+/*
+ * Put machine code of the line to output bank. The bank is an image of
+ * memory from bin_base up, bin_base is $8000 if the 1-st code is in banked
+ * RAM address range, so such code is at its address.
+ */
+void emit_bin(void)
+{
+    unsigned int f;
+    uint16_t ofs;
+
+    if (0 == asm_bytes) {
+        bin_base = (asm_pc >= START_BRAM && asm_pc < END_BRAM)
+                   ? START_BRAM : asm_pc;
+    }
+    ofs = asm_pc - bin_base;
+    if (ofs >= SIZE_BRAM || SIZE_BRAM - ofs < asm_len) {
+        asm_error(ERROR_ADDROOR);
+        fix_count = fix_line;   // code is not in the output, nothing to patch
+        return;
+    }
+    // code below the top of code (.org back), except earlier lines assembled
+    // again in incremental assembly (their code stays in place)
+    if (ofs < bin_top
+        && (0 == inc_pass || (inc_fwd && asm_line >= inc_from))) {
+        bin_back = 1;
+        if (inc_pass) {
+            return;     // see asm_source()
+        }
+    }
+    for (f = fix_line; f < fix_count; f++) {
+        fixups[f].loc = START_BRAM + ofs + fixups[f].col;
+    }
+    sel_bank(out_bank_num);
+    memcpy((void *)(START_BRAM + ofs), asm_code, asm_len);
+    if (bin_top < ofs + asm_len) {
+        bin_top = ofs + asm_len;
+    }
+    asm_bytes += asm_len;
+}
+
+/*
+ * Emit machine code of the line to output as monitor 'w' commands:
+ *    w hhhh bb bb ...
+ * Consecutive code is put to the same output line (OUT_MAXBYTES bytes max.),
+ * instructions and 2-byte values of fixups are not split.
+ * Columns of fixups recorded for the line are set here.
+ */
+void emit_code(void)
+{
+    unsigned int f = fix_line;
+    unsigned char i;
+
+    if (out_n && (out_pc != asm_pc
+                  || (asm_len <= 3 && out_n + asm_len > OUT_MAXBYTES))) {
+
+        out_flush();
+    }
+    for (i = 0; i < asm_len; i++) {
+        if (OUT_MAXBYTES == out_n
+            || (f < fix_count && fixups[f].col == i
+                && FIX_WORD == fixups[f].type && out_n + 2 > OUT_MAXBYTES)) {
+
+            out_flush();
+        }
+        if (0 == out_n) {
+            strcpy(out_buf, "w ");
+            hex2str(out_buf + 2, asm_pc + i, 4);
+            out_col = 6;
+            out_pc = asm_pc + i;
+        }
+        while (f < fix_count && fixups[f].col == i) {
+            fixups[f].loc = out_rec;
+            fixups[f].col = out_col + 1;
+            f++;
+        }
+        out_buf[out_col] = ' ';
+        hex2str(out_buf + out_col + 1, asm_code[i], 2);
+        out_col += 3;
+        out_buf[out_col] = 0;
+        out_n++;
+        out_pc++;
+    }
+    asm_bytes += asm_len;
+}
+
+/*
+ * Assemble (compile) the MOS 6502 assembly program.
+ * With passes = 1 code is emitted in single pass over the source code and
+ * forward references are patched at the end. Otherwise symbols are
+ * defined in the 1-st pass and passes are repeated until nothing changes
+ * in a pass (passes is the max. # of them), code is emitted in the next
+ * (last) pass.
+ * opts - OPT_BIN: machine code to output bank, OPT_LIST: show listing,
+ *        OPT_LONGBR: long branches, OPT_INC: incremental assembly (with
+ *        OPT_BIN, see inc_prepare()), OPT_PEEP: peephole optimization.
+ */
+void compile(unsigned char passes, unsigned char opts)
+{
+    out_n = 0;
+    out_full = 0;
+    bin_top = 0;
+    bin_back = 0;
+    if (0 == (opts & OPT_BIN)) {
+        if (out_iscode()) {
+            init_buf();     // text replaces machine code
+        }
+        if (out_iscode() || 0 == check_buf(out_bank_num)) {
+            return;
+        }
+        out_rec = lastaddr - strlen(null_txt_hdr);
+    }
+    if (0 == check_buf(code_bank_num) || 0 == ovl_load(OVL_ASM)) {
+        return;
+    }
+    if (opts & OPT_BIN) {
+        bankinit_flags[out_bank_num] = 0;   // no longer a text buffer
+        if (out_bank_num == lidx_bank) {
+            lidx_count = 0;
+        }
+    }
+    asm_count = 0;
+    asm_ticks = *TIMER64HZ;
+    inc_pass = 0;
+    if (opts & OPT_INC) {
+        inc_pass = inc_prepare(opts);
+    }
+    while (1) {
+        if (inc_pass) {
+            inc_resume(opts);
+        } else {
+            bin_top = 0;
+            bin_back = 0;
+            symb_init();
+            // line info for incremental assembly takes up to 2/3 of
+            // the space for symbols
+            linf_lines = line_count;
+            if ((opts & OPT_BIN) && passes > 1
+                && linf_lines <= symb_free / 3 * 2 / LINF_SIZE) {
+
+                symb_end -= linf_lines * LINF_SIZE;
+                symb_free -= linf_lines * LINF_SIZE;
+            } else {
+                linf_lines = 0;
+            }
+            asm_start(passes, opts);
+        }
+        if (asm_source()) {
+            break;
+        }
+        // size of code of reassembled line changed
+        if (inc_fwd) {
+            inc_pass = 0;
+        } else {
+            inc_to = 0xFFFF;
+            inc_fwd = 1;
+            inc_pass = asm_pass + 1;
+        }
+    }
+    out_flush();
+    if (0 == out_full) {
+        fix_resolve();
+    }
+    asm_ticks = *TIMER64HZ - asm_ticks;
+    if (opts & OPT_BIN) {
+        ast_save();
+    }
+    asm_summary(opts);
+}
+
+/*
+ * Assemble source code in passes started by asm_start() or asm_resume().
+ * Source code records are read in order, no line lookup. Line info of
+ * lines assembled in the last pass is updated. Lines of banks included
+ * by .include and of called macros are read in place of the line.
+ * Return 0 if incremental assembly can't be finished (see inc_sizeok(),
+ * asm_narrow).
+ */
+int asm_source(void)
+{
+    struct source *src;
+    uint16_t hash = 0;
+    unsigned char r;
+
+    asm_main = code_bank_num;
+    do {
+        asm_begin();
+        inc_lines = 0;
+        src_depth = 0;
+        sel_bank(code_bank_num);
+        src_push(code_bank_num, tb_first(), 0);
+        if (inc_pass && inc_first) {
+            if (inc_first < line_count) {
+                goto_line(inc_first);
+                src_stack[0].addr = curr_addr;
+                src_stack[0].line = inc_first;
+                asm_line = inc_first;
+            } else {
+                src_depth = 0;      // nothing to do
+            }
+        }
+        while (0 == out_full && src_depth) {
+            src = &src_stack[src_depth - 1];
+            sel_bank(src->bank);
+            if (isaddr_oor(src->addr)
+                || isnull_hdr((const char *)src->addr)) {
+
+                if (src->macro) {
+                    asm_error(ERROR_MACRO);     // no .endm
+                    mac_exit();
+                }
+                src_depth--;
+                continue;
+            }
+            if (inc_pass && inc_skip()) {
+                if (asm_line >= inc_to) {
+                    break;
+                }
+                sel_bank(src->bank);
+                src->addr = tb_next(src->addr);
+                src->line++;
+                asm_line++;
+                continue;
+            }
+            asm_unit = src->bank;
+            asm_pos = src->addr;
+            asm_srcline = src->line++;
+            sel_bank(src->bank);
+            strcpy(asm_buf, TBREC_TXTPTR(src->addr));
+            src->addr = tb_next(src->addr);
+            if (src->macro) {
+                r = mac_line(asm_buf);
+                if (MAC_END == r) {
+                    src_depth--;
+                }
+                if (MAC_LINE != r) {
+                    continue;
+                }
+            }
+            if (asm_emit && linf_lines) {
+                hash = line_hash(asm_buf);
+            }
+            asm6502(asm_buf);
+            asm_count++;
+            if (SRC_NONE != asm_include || asm_call || mac_count) {
+                // lines no longer match lines of source code buffer
+                if (inc_pass) {
+                    inc_fwd = 1;
+                    return 0;
+                }
+                linf_lines = 0;
+            }
+            if (inc_pass && 0 == inc_sizeok()) {
+                return 0;
+            }
+            if (inc_pass && asm_narrow) {
+                // wide line of the last assembly, code may differ
+                inc_fwd = 1;
+                return 0;
+            }
+            if (asm_emit && (asm_opts & OPT_LIST)) {
+                list_line();
+            }
+            if (asm_emit && asm_len) {
+                if (asm_opts & OPT_BIN) {
+                    emit_bin();
+                } else {
+                    emit_code();
+                }
+            }
+            if (inc_pass && bin_back) {
+                // code of lines that are not assembled may be overwritten
+                inc_fwd = 1;
+                return 0;
+            }
+            if (asm_emit && asm_line < linf_lines) {
+                linf_put(hash);
+            }
+            asm_next();
+            inc_lines++;
+            if (SRC_NONE != asm_include) {
+                src_push(asm_include, 0, 0);
+            }
+            if (asm_call) {
+                src_push(mac_unit, mac_pos, 1);
+            }
+        }
+    } while (0 == asm_end());
+
+    return 1;
+}
+
+/*
+ * Continue assembly with text buffer in bank at record addr (macro: its
+ * .macro line) or with the whole text buffer included by .include.
+ */
+void src_push(unsigned char bank, uint16_t addr, unsigned char macro)
+{
+    struct source *src = &src_stack[src_depth];
+    int err = ERROR_OK;
+
+    if (SRC_DEPTH == src_depth) {
+        err = ERROR_NESTING;
+        if (macro) {
+            mac_exit();
+        }
+    } else if (0 == macro && src_depth) {
+        if (bank > 7) {
+            err = ERROR_BADBANK;
+        } else if (bank == symb_bank_num) {
+            err = ERROR_SYMBBANK;
+        } else if (bank == out_bank_num) {
+            err = ERROR_BANKSEQUAL;
+        } else if (OVL_BANK == bank) {
+            err = ERROR_OVLBANK;
+        } else {
+            sel_bank(bank);
+            if (0 == tb_cacheok()) {
+                err = ERROR_BUFNOTINIT;
+            }
+            addr = tb_first();
+        }
+    }
+    if (err) {
+        asm_error(err);
+        return;
+    }
+    src->bank = bank;
+    src->macro = macro;
+    src->addr = addr;
+    src->line = 0;
+    src_depth++;
+}
+
+/*
+ * Return hash of line of source code s.
+ */
+uint16_t line_hash(const char *s)
+{
+    uint16_t h = 0;
+
+    while (*s) {
+        h = (h << 5) + h + (unsigned char)*s++;
+    }
+
+    return h;
+}
+
+/*
+ * Put line info of line asm_line (hash of its text) to symbol bank.
+ */
+void linf_put(uint16_t hash)
+{
+    unsigned char bank = *RAMBANKNUM;
+    uint16_t addr = LINF_ADDR(asm_line);
+
+    sel_bank(symb_bank_num);
+    POKEW(addr + LINF_HASH, hash);
+    POKEW(addr + LINF_PC, asm_pc);
+    POKE(addr + LINF_LEN, asm_len);
+    POKE(addr + LINF_FLAGS, (asm_fwd ? LINF_FWD : 0) | (asm_def ? LINF_DEF : 0)
+                            | (wide_get() ? LINF_WIDE : 0));
+    sel_bank(bank);
+}
+
+/*
+ * Invalidate state of the last assembly (output bank was erased).
+ */
+void ast_clear(void)
+{
+    unsigned char bank = *RAMBANKNUM;
+
+    sel_bank(symb_bank_num);
+    POKEW(SYMB_STATE, 0);
+    sel_bank(bank);
+}
+
+/*
+ * Return non-zero if output bank holds machine code of the last assembly
+ * with option 'm', read its state to ast. Such bank is not a text buffer,
+ * it must not be checked by check_buf() (it would offer to erase it).
+ */
+int out_iscode(void)
+{
+    unsigned char bank = *RAMBANKNUM;
+
+    if (symb_bank_num < 0 || symb_bank_num > 7
+        || symb_bank_num == out_bank_num || OVL_BANK == symb_bank_num) {
+
+        return 0;       // see check_buf()
+    }
+    sel_bank(symb_bank_num);
+    memcpy(&ast, (const void *)SYMB_STATE, sizeof(struct asm_state));
+    sel_bank(bank);
+
+    return (AST_MAGIC == ast.magic || AST_CODE == ast.magic)
+           && ast.out_bank == out_bank_num;
+}
+
+/*
+ * Show where machine code of size top from address base is in output bank.
+ */
+void prn_code(uint16_t base, uint16_t top)
+{
+    puts("Code in bank#");
+    puts(itoa(out_bank_num, ibuf1, RADIX_DEC));
+    puts("...........: $");
+    puts(utoa(START_BRAM, ibuf1, RADIX_HEX));
+    puts(" - $");
+    puts(utoa(START_BRAM + top - 1, ibuf1, RADIX_HEX));
+    puts("\n\rCode address.............: $");
+    puts(utoa(base, ibuf1, RADIX_HEX));
+    puts(" - $");
+    puts(utoa(base + top - 1, ibuf1, RADIX_HEX));
+    puts("\n\r");
+}
+
+#pragma code-name (push, "OVERLAY4")
+#pragma rodata-name (push, "OVERLAY4")
+
+const char ovl_sigasm[] = __DATE__ " " __TIME__;
+
+/*
+ * Patch values of forward references in output buffer.
+ */
+void fix_resolve(void)
+{
+    struct fixup *f = fixups;
+    unsigned int i;
+    uint16_t val;
+    char *p;
+
+    for (i = 0; i < fix_count; i++, f++) {
+        if (0 == symb_read(f->sym, &val)) {
+            fix_error(ERROR_UNDEFSYMB, f);
+            continue;
+        }
+        val += f->addend;
+        if (FIX_LO == f->type) {
+            val &= 0xFF;
+        } else if (FIX_HI == f->type) {
+            val >>= 8;
+        } else if (FIX_BYTE == f->type && val > 0xFF && val < 0xFF80) {
+            fix_error(ERROR_RANGE, f);
+        } else if (FIX_REL == f->type && val >= 0x80 && val < 0xFF80) {
+            fix_error(ERROR_BRANCH, f);
+        }
+        sel_bank(out_bank_num);
+        if (asm_opts & OPT_BIN) {
+            POKE(f->loc, val);
+            if (FIX_WORD == f->type) {
+                POKE(f->loc + 1, val >> 8);
+            }
+            continue;
+        }
+        p = TBREC_TXTPTR(f->loc) + f->col;
+        hex2str(p, val, 2);
+        if (FIX_WORD == f->type) {
+            hex2str(p + 3, val >> 8, 2);
+        }
+    }
+}
+
+/*
+ * Save state of the assembly with option 'm' to symbol bank. It is valid
+ * for incremental assembly if there were no errors, line info was kept
+ * and no code was put over other code. Otherwise it only tells that the
+ * output bank holds machine code.
+ */
+void ast_save(void)
+{
+    unsigned char bank = *RAMBANKNUM;
+
+    ast.magic = (0 == asm_errors && linf_lines && 0 == bin_back)
+                ? AST_MAGIC : AST_CODE;
+    ast.code_bank = code_bank_num;
+    ast.out_bank = out_bank_num;
+    ast.opts = asm_opts;
+    ast.pass = asm_pass;
+    ast.lines = linf_lines;
+    ast.symb_count = symb_count;
+    ast.symb_free = symb_free;
+    ast.symb_end = symb_end;
+    ast.bin_base = bin_base;
+    ast.bin_top = bin_top;
+    ast.bytes = asm_bytes;
+    sel_bank(symb_bank_num);
+    memcpy((void *)SYMB_STATE, &ast, sizeof(struct asm_state));
+    sel_bank(bank);
+}
+
+/*
+ * Show summary of the assembly with options opts.
+ */
+void asm_summary(unsigned char opts)
+{
+    puts(divider);
+    puts("Lines....................: ");
+    puts(utoa(inc_pass ? line_count : asm_line, ibuf1, RADIX_DEC));
+    if (inc_pass) {
+        puts("\n\rLines assembled..........: ");
+        puts(utoa(inc_lines, ibuf1, RADIX_DEC));
+    }
+    puts("\n\rPasses...................: ");
+    puts(utoa(asm_pass - asm_pass1 + 1, ibuf1, RADIX_DEC));
+    puts("\n\rBytes of code............: ");
+    puts(utoa(asm_bytes, ibuf1, RADIX_DEC));
+    if (opts & OPT_PEEP) {
+        puts("\n\rOptimized lines..........: ");
+        puts(utoa(peep_lines, ibuf1, RADIX_DEC));
+        puts("\n\rBytes saved..............: ");
+        puts(utoa(peep_bytes, ibuf1, RADIX_DEC));
+        puts("\n\rCycles saved.............: ");
+        puts(utoa(peep_cycles, ibuf1, RADIX_DEC));
+    }
+    puts("\n\rForward references.......: ");
+    puts(utoa(fix_count, ibuf1, RADIX_DEC));
+    puts("\n\rTime (1/64 s)............: ");
+    puts(ultoa(asm_ticks, ibuf1, RADIX_DEC));
+    if (asm_count) {
+        // 1/64 s = 15625 us, in all passes
+        puts("\n\rTime per line (us).......: ");
+        puts(ultoa(asm_ticks * 15625 / asm_count, ibuf1, RADIX_DEC));
+    }
+    puts("\n\r");
+    if (bin_top) {
+        prn_code(bin_base, bin_top);
+    }
+    puts("Errors...................: ");
+    puts(utoa(asm_errors, ibuf1, RADIX_DEC));
+    puts("\n\r");
+    puts(divider);
+}
+
+/*
+ * Prepare incremental assembly: compare the source code with line info of
+ * the last assembly with option 'm' (hashes of lines) to find the 1-st
+ * changed line. If it is the only changed line and it doesn't define
+ * symbol, only this line is assembled again, provided the size and
+ * address of its code stay the same. Otherwise lines from the 1-st changed
+ * one to the end are assembled, together with earlier lines that use
+ * forward references, provided the size of their code stays the same.
+ * See inc_sizeok(). Code put below other code (.org back) makes the
+ * assembly of all lines necessary (see bin_back).
+ * Return the 1-st pass of incremental assembly or 0 if all lines must be
+ * assembled (no valid state of the last assembly, other banks or options,
+ * optimization, no room for line info).
+ */
+unsigned char inc_prepare(unsigned char opts)
+{
+    uint16_t src_addr;
+    uint16_t h, n;
+    unsigned int line = 0;
+    unsigned int first = 0xFFFF;
+    unsigned int changed = 0;
+
+    sel_bank(symb_bank_num);
+    memcpy(&ast, (const void *)SYMB_STATE, sizeof(struct asm_state));
+    if (ast.magic != AST_MAGIC
+        || ast.code_bank != code_bank_num || ast.out_bank != out_bank_num
+        || ((ast.opts ^ opts) & OPT_LONGBR) || ((ast.opts | opts) & OPT_PEEP)
+        || ast.pass > SYMB_PASSMASK - 2 * ASM_MAXPASS) {
+
+        return 0;
+    }
+    sel_bank(code_bank_num);
+    src_addr = tb_first();
+    while (0 == isnull_hdr((const char *)src_addr)) {
+        h = line_hash(TBREC_TXTPTR(src_addr));
+        sel_bank(symb_bank_num);
+        if (line >= ast.lines || PEEKW(LINF_ADDR(line) + LINF_HASH) != h) {
+            if (first > line) {
+                first = line;
+            }
+            changed++;
+        }
+        line++;
+        sel_bank(code_bank_num);
+        src_addr = tb_next(src_addr);
+        if (isaddr_oor(src_addr)) {
+            return 0;
+        }
+    }
+    if (first > line) {
+        first = line;   // no change or lines removed at the end
+    }
+    // line info of added lines takes space of symbols
+    n = (END_BRAM - ast.symb_end) / LINF_SIZE;
+    if (line > n) {
+        n = (line - n) * LINF_SIZE;
+        if (n > ast.symb_free) {
+            return 0;
+        }
+        ast.symb_end -= n;
+        ast.symb_free -= n;
+    }
+    symb_count = ast.symb_count;
+    symb_free = ast.symb_free;
+    symb_end = ast.symb_end;
+    linf_lines = line;
+    inc_from = first;
+    sel_bank(symb_bank_num);
+    if (line == ast.lines && changed <= 1
+        && (first == line
+            || 0 == (PEEK(LINF_ADDR(first) + LINF_FLAGS) & LINF_DEF))) {
+
+        inc_to = first + 1;
+        inc_fwd = 0;
+    } else {
+        inc_to = 0xFFFF;
+        inc_fwd = 1;
+    }
+
+    return ast.pass + 1;
+}
+
+/*
+ * Start passes of incremental assembly at pass inc_pass. Wide line flags
+ * of earlier lines with forward references are restored from line info,
+ * size of code in the output and the address of code of line inc_from
+ * are found.
+ */
+void inc_resume(unsigned char opts)
+{
+    unsigned int line;
+    uint16_t addr, top = 0;
+    unsigned int bytes = 0;
+
+    asm_resume(inc_pass, opts);
+    sel_bank(symb_bank_num);
+    inc_first = inc_from;
+    if (inc_fwd) {
+        for (line = 0; line < inc_from; line++) {
+            addr = LINF_ADDR(line);
+            if (inc_line(line)) {
+                if (inc_first > line) {
+                    inc_first = line;
+                }
+                if (PEEK(addr + LINF_FLAGS) & LINF_WIDE) {
+                    asm_line = line;
+                    wide_set();
+                }
+            } else if (PEEK(addr + LINF_LEN)) {
+                bytes += PEEK(addr + LINF_LEN);
+                if (top < PEEKW(addr + LINF_PC) - ast.bin_base
+                          + PEEK(addr + LINF_LEN)) {
+
+                    top = PEEKW(addr + LINF_PC) - ast.bin_base
+                          + PEEK(addr + LINF_LEN);
+                }
+            }
+        }
+    } else {
+        // the rest of code is in the output
+        bytes = ast.bytes;
+        top = ast.bin_top;
+        if (inc_from < ast.lines) {
+            bytes -= PEEK(LINF_ADDR(inc_from) + LINF_LEN);
+        }
+    }
+    inc_pc = ASM_ORG;
+    if (inc_from) {
+        addr = LINF_ADDR(inc_from - 1);
+        inc_pc = PEEKW(addr + LINF_PC) + PEEK(addr + LINF_LEN);
+    }
+    asm_bytes = bytes;
+    bin_base = ast.bin_base;
+    bin_top = top;
+}
+
+#pragma rodata-name (pop)
+#pragma code-name (pop)
+
+/*
+ * Return non-zero if line is assembled in incremental assembly.
+ * Symbol bank must be selected.
+ */
+int inc_line(unsigned int line)
+{
+    return (line >= inc_from && line < inc_to)
+           || (inc_fwd && line < inc_from
+               && (PEEK(LINF_ADDR(line) + LINF_FLAGS) & LINF_FWD));
+}
+
+/*
+ * Return non-zero if line asm_line is not assembled in incremental
+ * assembly, otherwise set address of its code.
  */
-void add_label2symb(const char *lbl, uint16_t val)
-{
-    if (symb_idx < SYMBTBL_SIZE) {
-        if (NULL != lbl && 0 < strlen(lbl)) {
-            strcpy(symbol_table[symb_idx].name, lbl);
-            symbol_table[symb_idx].name[strlen(lbl)-1] = 0; // remove ':'
-            symbol_table[symb_idx].val = val;
-            symb_idx++;
-        }
-    } else {
-        prn_error(ERROR_SYMBFULL);
-        assert(__LINE__, symb_idx < SYMBTBL_SIZE, "Memory full.");
+int inc_skip(void)
+{
+    sel_bank(symb_bank_num);
+    if (0 == inc_line(asm_line)) {
+        return 1;
     }
+    if (asm_line < inc_from) {
+        asm_pc = PEEKW(LINF_ADDR(asm_line) + LINF_PC);
+    } else if (asm_line == inc_from) {
+        asm_pc = inc_pc;
+    }
+
+    return 0;
 }
 
 /*
- * Read line lnum from text buffer to buf.
+ * Return 0 if code of line asm_line assembled in incremental assembly
+ * doesn't fit between code of lines that are not assembled: size of code
+ * of earlier line with forward reference changed or the only changed line
+ * has other size or address of code or defines symbol.
  */
-void read_line(int lnum, char *buf)
+int inc_sizeok(void)
 {
-    if (0xFFFF != goto_line(lnum)) {
-        strcpy(buf, (const char *)(curr_addr + 5));
+    unsigned char bank = *RAMBANKNUM;
+    uint16_t addr = LINF_ADDR(asm_line);
+    int ret = 1;
+
+    sel_bank(symb_bank_num);
+    if (asm_line < inc_from) {
+        ret = (PEEK(addr + LINF_LEN) == asm_len);
+    } else if (0 == inc_fwd) {
+        ret = (PEEK(addr + LINF_LEN) == asm_len
+               && PEEKW(addr + LINF_PC) == asm_pc && 0 == asm_def);
     }
+    sel_bank(bank);
+
+    return ret;
 }
 
 /*
- * Compile single line of assembly code in buf.
- * Output in out_buf.
- *
- * .org num
- * name = expr
- * expr = <
- *    literal op literal
- * >
- * literal = <
- *    num, <num, >num
- * >
- * num = <
- *    DEC8, DEC16, $hh, $hhhh, label
- * >
- * label:
- * asminstr arg
- * arg = <
- *    #DEC8
- *    num
- *    num,x
- *    num,y
- *    (num)
- *    (DEC8,x)
- *    (DEC8),y
- * >
- *
+ * Assemble source code.
+ * Command is expected in prompt_buf before calling this function:
+ * "a [1] [m] [l] [b] [i] [o]"
  */
-void asm6502(const char *buf, uint16_t pass)
+void asm_cmd(void)
 {
-    int i = 0, opcidx = -1;
     int n0, n1;
-    struct instr asm_instr;
-    unsigned char buf1[3];
+    unsigned char passes = ASM_MAXPASS;
+    unsigned char opts = 0;
 
-    n0 = adv2nxt_token(0);
+    n0 = adv2nxt_token(1);
     n1 = adv2next_spc(n0);
-    if (n1 > n0) {
-        // check if .org (set address counter)
-        if (0 == strncmp(buf + n0, ".org", 4)) {
-            n0 = adv2nxt_token(n1);
-            n1 = adv2next_spc(n0);
-            if (n1 > n0) {
-                asm_pc = atoi(buf + n0);
-            }
-            return;
-        }
-        // check if a label in form:
-        // <string-literal>:
-        if (buf[n1-1] == ':') {
-            // it is a label
-            add_label2symb(buf + n0, asm_pc);
-            // label can only be by itself in the line, ignore the rest
+    while (n1 > n0) {
+        if (0 == strcmp(prompt_buf + n0, "1")) {
+            passes = 1;
+        } else if (0 == strcmp(prompt_buf + n0, "m")) {
+            opts |= OPT_BIN;
+        } else if (0 == strcmp(prompt_buf + n0, "l")) {
+            opts |= OPT_LIST;
+        } else if (0 == strcmp(prompt_buf + n0, "b")) {
+            opts |= OPT_LONGBR;
+        } else if (0 == strcmp(prompt_buf + n0, "i")) {
+            opts |= OPT_INC;
+        } else if (0 == strcmp(prompt_buf + n0, "o")) {
+            opts |= OPT_PEEP;
+        } else {
+            prn_error(ERROR_BADARG);
+            puts("Expected: a [1] [m] [l] [b] [i] [o]\n\r");
             return;
         }
-        // check if MOS6502 assembly instr.
-        if (3 == strlen(buf + n0)) {
-            while (1) {
-                asm_instr = OpCodes[i];
-                if (0 == strncmp(asm_instr.mnem, buf + n0, 3)) {
-                    opcidx = i; // yes, 6502 instr.
-                    break;
-                }
-                if (0 == strncmp(asm_instr.mnem, "nnn", 3)) {
-                    break;  // the end of opcodes table reached
-                }
-                i++;
-            }
-        }
         n0 = adv2nxt_token(n1);
         n1 = adv2next_spc(n0);
-        if (n1 > n0) {
-            if (0 > opcidx) {
-                // not a 6502 assembly instruction
-                // may be name = expr assignment or one of the pseudo commands
-                // like .org, .byte, .word, .string.
-            } else {
-                // assembly instruction followed by argument(s),
-                // parse argument, determine addressing mode and derive op-code
-            }
-        } else {
-            if (0 <= opcidx) {
-                // assembly instr. with no arguments (implied addressing mode)
-            } else {
-                // non-assembly (pseudo) instruction with no arguments
-            }
-        }
     }
-    // prepare output buffer
-    /***
-    if (strlen(out_buf) == 0) {
-        memset(out_buf, 0, TEXTLINE_SIZE);
-        strcpy(out_buf, "w ");
-        utoa(asm_pc, ibuf1, RADIX_HEX);
-        if (strlen(ibuf1) < 4) {
-            strncpy(ibuf2, "000", 4 - strlen(ibuf1));
-            strcat(ibuf2, ibuf1);
-            strcpy(ibuf1, ibuf2);
+    if ((opts & OPT_INC) && (1 == passes || 0 == (opts & OPT_BIN))) {
+        prn_error(ERROR_BADARG);
+        puts("Option i needs m and can't be used with 1.\n\r");
+        return;
+    }
+    if ((opts & OPT_PEEP) && 1 == passes) {
+        prn_error(ERROR_BADARG);
+        puts("Option o can't be used with 1.\n\r");
+        return;
+    }
+    compile(passes, opts);
+}
+
+/*
+ * Write single text record (header and contents) to the memory address addr.
+ */
+void write_text2mem(uint16_t addr)
+{
+    POKE(addr + TBREC_LEN, CurrLine.len);
+    POKEW(addr + TBREC_NEXT, CurrLine.next_ptr);
+    strcpy(TBREC_TXTPTR(addr), CurrLine.text);
+}
+
+/*
+ * Return address of the text record following the one at addr.
+ * Gap left in text buffer by text editor is skipped.
+ */
+uint16_t tb_next(uint16_t addr)
+{
+    addr = TBREC_GETNXT(addr);
+    if (TBREC_GETLEN(addr) == TBGAP_MARK && TBREC_GETNXT(addr) != 0xFFFF) {
+        addr = TBREC_GETNXT(addr);
+    }
+
+    return addr;
+}
+
+/*
+ * Return address of the 1-st text record in selected bank.
+ */
+uint16_t tb_first(void)
+{
+    uint16_t addr = START_TEXT;
+
+    if (TBREC_GETLEN(addr) == TBGAP_MARK && TBREC_GETNXT(addr) != 0xFFFF) {
+        addr = TBREC_GETNXT(addr);      // text begins with the gap
+    }
+
+    return addr;
+}
+
+/*
+ * Store tail address, line count, free space and gap address in text buffer
+ * header. Must be called after text buffer was altered.
+ */
+void tb_putcache(uint16_t gap)
+{
+    TBHDR_PUTW(TBHDR_TAIL, lastaddr - strlen(null_txt_hdr));
+    TBHDR_PUTW(TBHDR_LINES, line_count);
+    TBHDR_PUTW(TBHDR_FREE, gap ? TBREC_GETNXT(gap) - gap
+                               : END_BRAM - lastaddr - 1);
+    TBHDR_PUTW(TBHDR_GAP, gap);
+}
+
+/*
+ * Validate values cached in text buffer header against the text buffer.
+ * Return non-zero if they can be used.
+ */
+int tb_cacheok(void)
+{
+    uint16_t tail = TBHDR_GETW(TBHDR_TAIL);
+    uint16_t gap = TBHDR_GETW(TBHDR_GAP);
+    uint16_t nfree;
+
+    if (0 == TB_HDROK
+        || tail < START_TEXT
+        || tail > END_BRAM - sizeof(null_txt_hdr)
+        || 0 == isnull_hdr((const char *)tail)
+        || TBHDR_GETW(TBHDR_LINES) > MAX_LINES) {
+
+        return 0;
+    }
+    if (gap) {
+        if (gap < START_TEXT || gap >= tail
+            || TBREC_GETLEN(gap) != TBGAP_MARK
+            || TBREC_GETNXT(gap) > tail) {
+
+            return 0;
         }
-        strcat(out_buf, ibuf1);
-        strcat(out_buf, " ");
-    }***/
+        nfree = TBREC_GETNXT(gap) - gap;
+    } else {
+        nfree = END_BRAM - tail - sizeof(null_txt_hdr);
+    }
+
+    return (TBHDR_GETW(TBHDR_FREE) == nfree);
 }
 
 /*
- * Assemble (compile) the MOS 6502 assembly program.
+ * Build line index of the text buffer in current RAM bank.
  */
-void compile(void)
+void lidx_build(void)
 {
-    unsigned int code_lines;
-    unsigned int code_curr_line = 0, pass = 0;
+    uint16_t addr = START_TEXT;
+    unsigned int line = 0;
 
-    asm_pc = 0x0B00; // default code start address
-    memset(out_buf, 0, TEXTLINE_SIZE);
-    check_buf(code_bank_num);
-    code_lines = line_count;
-    // pass 0 - build symbols table only
-    while (code_curr_line < line_count) {
-        // switch to source code bank
-        check_buf(code_bank_num);
-        read_line(code_curr_line, prompt_buf);
-        asm6502(prompt_buf, pass);
-        code_curr_line++;
-    }
-    pass++;
-    code_curr_line = 0;
-    asm_pc = 0x0B00;
-    // pass 1 - generate code to output
-    while (code_curr_line < line_count) {
-        // switch to source code bank
-        check_buf(code_bank_num);
-        read_line(code_curr_line, prompt_buf);
-        asm6502(prompt_buf, pass);
-        check_buf(out_bank_num);
-        add2output(out_buf);
-        code_curr_line++;
+    lidx_count = 0;
+    lidx_bank = *RAMBANKNUM;
+    if (TBREC_GETLEN(addr) == TBGAP_MARK && TBREC_GETNXT(addr) != 0xFFFF) {
+        addr = TBREC_GETNXT(addr);  // text begins with the gap
+    }
+    while (lidx_count < LIDX_SIZE) {
+        if (isnull_hdr((const char *)addr)) {
+            break;
+        }
+        if (0 == (line % LIDX_STEP)) {
+            lidx[lidx_count].line = line;
+            lidx[lidx_count].addr = addr;
+            lidx_count++;
+        }
+        line++;
+        addr = tb_next(addr);
+        if (isaddr_oor(addr)) {
+            lidx_count = 0;
+            break;
+        }
+    }
+    if (0 == lidx_count) {  // empty buffer
+        lidx[0].line = 0;
+        lidx[0].addr = addr;
+        lidx_count = 1;
     }
 }
 
 /*
- * If the condition evaluates to zero (false), prints a message and aborts
- * the program.
+ * Return index of the last anchor with line# not greater than line
+ * (binary search). Line index must be valid.
  */
-void assert(uint16_t line, int cond, const char *msg)
+unsigned int lidx_search(unsigned int line)
 {
-    if (!cond) {
-        puts("\n\rASSERT in line ");
-        puts(utoa(line, ibuf3, RADIX_DEC));
-        puts("\n\rMessage: ");
-        puts(msg);
-        puts("\n\r");
-        pause_sec64(65);
-        exit(0);
+    unsigned int lo = 0, mid;
+    unsigned int hi = lidx_count - 1;
+
+    while (lo < hi) {
+        mid = (lo + hi + 1) >> 1;
+        if (lidx[mid].line <= line) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
     }
+
+    return lo;
 }
 
 /*
- * Write single text record (header and contents) to the memory address addr.
+ * Return index of the nearest anchor at or before the line.
+ * Index is rebuilt if not valid.
  */
-void write_text2mem(uint16_t addr)
+unsigned int lidx_find(unsigned int line)
 {
-    POKEW(addr, CurrLine.num);
-    POKE(addr + 2, CurrLine.len);
-    POKEW(addr + 3, CurrLine.next_ptr);
-    strcpy((char *)(addr + 5), CurrLine.text);
+    if (0 == lidx_count || lidx_bank != *RAMBANKNUM) {
+        lidx_build();
+    }
+
+    return lidx_search(line);
 }
 
 /*
@@ -620,10 +1650,61 @@ void parse_cmd(void)
     else if (*prompt_buf == 'm') {
         cmd_code = CMD_INFO;
     }
+    else if (*prompt_buf == 'a') {
+        cmd_code = CMD_ASM;
+    }
     else
         cmd_code = CMD_UNKNOWN;
 }
 
+#pragma code-name (push, "OVERLAY1")
+#pragma rodata-name (push, "OVERLAY1")
+
+const char ovl_sighelp[] = __DATE__ " " __TIME__;
+
+// Usage help.
+const char * const helptext[39] =
+{
+    "\n\r",
+    " b : set buffers (bank #-s) for source code and for output\n\r",
+    "     and the bank of symbol table (default 6)\n\r",
+    "     b <src_bank#> [out_bank#] [symb_bank#]\n\r",
+    "     NOTE: contents of symbol table bank is erased by 'a'.\n\r",
+    "           bank 3 is reserved for overlays (asm6502_ovl.txt).\n\r",
+    " l : List buffer contents.\n\r",
+    "     l <src | out> <all | from_line#>[-to_line# | -end] [n]\n\r",
+    "      src - source code buffer\n\r",
+    "      out - output buffer (machine code: its address range)\n\r",
+    "      n - show line numbers\n\r",
+    "      all - list all content\n\r",
+    " a : assembly (compile) source code.\n\r",
+    "     a [1] [m] [l] [b] [i] [o]\n\r",
+    "      1 - single pass, forward references are patched at the end\n\r",
+    "      m - machine code to output bank (replaces text in it)\n\r",
+    "          code for $8000-$BFFF at its address, other at $8000+\n\r",
+    "      l - list assembled code with cycles of instructions\n\r",
+    "      b - branch out of range to inverted branch over jmp\n\r",
+    "      i - incremental, with m: assemble from the 1-st line\n\r",
+    "          changed since the last 'a m' (keep the symbol bank)\n\r",
+    "      o - optimize: redundant lda, jsr+rts, unreachable nop,\n\r",
+    "          branch over jmp (not with 1)\n\r",
+    "     source: .include bank#, .macro name [par, ...] ... .endm\n\r",
+    "             call: name [arg, ...], '@' in macro - call#\n\r",
+    "     NOTE: output will be appended at the end of output buffer.\n\r",
+    "           This way it is possible to compile multiple source code\n\r",
+    "           buffers into single output buffer.\n\r",
+    " x : exit program, leave contents in buffers.\n\r",
+    " e : erase output buffer.\n\r",
+    " m : show memory information and symbol table statistics.\n\r",
+    "NOTE:\n\r",
+    "   Default to_line# is the same as from_line#.\n\r",
+    "   Arguments are <mandatory> OR [optional].\n\r",
+    "   For range arguments, SPACE can be used instead of '-'.\n\r",
+    "   'end' - last line of text.\n\r",
+    "\n\r",
+    "@EOH"
+};
+
 /* print help */
 void prn_help(void)
 {
@@ -647,6 +1728,33 @@ void prn_help(void)
     }
 }
 
+#pragma rodata-name (pop)
+#pragma code-name (pop)
+
+/*
+ * Copy overlay ovl from its slot in OVL_BANK to the overlay area, unless
+ * it is there already. Return non-zero if the overlay can be run.
+ * Overlay functions may call resident functions, but not each other.
+ */
+int ovl_load(unsigned char ovl)
+{
+    unsigned char bank = *RAMBANKNUM;
+
+    if (ovl != ovl_curr) {
+        sel_bank(OVL_BANK);
+        memcpy(ovl_run[ovl], (const void *)(START_BRAM + ovl * OVL_SLOT),
+               (unsigned)ovl_size[ovl]);
+        sel_bank(bank);
+        ovl_curr = strcmp(ovl_sigs[ovl], ovl_sig) ? OVL_NONE : ovl;
+    }
+    if (ovl != ovl_curr) {
+        prn_error(ERROR_NOOVL);
+        return 0;
+    }
+
+    return 1;
+}
+
 /*
  * Execute command.
  */
@@ -666,19 +1774,30 @@ int exec_cmd(void)
             ret = 0;
             break;
         case CMD_HELP:
-            prn_help();
+            if (ovl_load(OVL_HELP)) {
+                prn_help();
+            }
             break;
         case CMD_LIST:
-            list_buf();
+            if (ovl_load(OVL_LIST)) {
+                list_buf();
+            }
             break;
         case CMD_ERASE:
             init_buf();
             break;
         case CMD_BANK:
-            set_buffers();
+            if (ovl_load(OVL_INFO)) {
+                set_buffers();
+            }
             break;
         case CMD_INFO:
-            mem_info();
+            if (ovl_load(OVL_INFO)) {
+                mem_info();
+            }
+            break;
+        case CMD_ASM:
+            asm_cmd();
             break;
         default:
             break;
@@ -692,38 +1811,25 @@ int exec_cmd(void)
  */
 void add2output(const char *txt)
 {
-    uint16_t nxtaddr;
-
-    curr_addr = START_BRAM;
-    line_num = 0;
     if (0 == check_buf(out_bank_num)) {
         return;
     }
     // Position current address at the NULL line after text.
-    while (1) {
-        if (isnull_hdr((const char *)curr_addr)) {
-            break; // found null header
-        }
-        line_num = PEEKW(curr_addr) + 1;
-        nxtaddr = PEEKW(curr_addr + 3);
-        curr_addr = nxtaddr;
-        if (isaddr_oor(curr_addr)) {
-            return;
-        }
-    }
-    // create and store null text header at current address
-    strcpy((char *)curr_addr, null_txt_hdr);
+    curr_addr = lastaddr - strlen(null_txt_hdr);
+    line_num = line_count;
     strcpy (CurrLine.text, txt);
     CurrLine.len = strlen(txt);
-    CurrLine.next_ptr = curr_addr + CurrLine.len + 6;
-    if (CurrLine.next_ptr > (END_BRAM - 6)) {
+    CurrLine.next_ptr = curr_addr + CurrLine.len + TBREC_SIZE;
+    if (CurrLine.next_ptr > (END_BRAM - TBREC_SIZE)) {
         // Text buffer full.
         prn_error(ERROR_FULLBUF);
     } else {
-        // update header and text at current address
-        CurrLine.num = line_num;
+        // update header and text at current address, null header follows
         write_text2mem(curr_addr);
-        line_num++;
+        strcpy((char *)CurrLine.next_ptr, null_txt_hdr);
+        line_count++;   // line_num is the added (last) line
+        lastaddr = CurrLine.next_ptr + strlen(null_txt_hdr);
+        tb_putcache(0); // appended, so there is no gap before the tail
         curr_addr = CurrLine.next_ptr;
         if (isaddr_oor(curr_addr)) {
             return;
@@ -732,6 +1838,11 @@ void add2output(const char *txt)
     check_buf(out_bank_num); // update globals after text buffer was altered
 }
 
+#pragma code-name (push, "OVERLAY3")
+#pragma rodata-name (push, "OVERLAY3")
+
+const char ovl_siglist[] = __DATE__ " " __TIME__;
+
 /*
  * List text buffer contents.
  * Command is expected in prompt_buf before calling this function:
@@ -742,7 +1853,7 @@ void list_buf(void)
     int      n0, n;
     uint16_t from_line = line_num;
     uint16_t to_line = line_num;
-    uint16_t addr = START_BRAM;
+    uint16_t addr;
     uint16_t line = 0;
     int      show_num = 0;
 
@@ -764,6 +1875,13 @@ void list_buf(void)
         } else if (0 == strncmp(prompt_buf + n0, "out", 3)) {
 
             bank_num = out_bank_num;
+            if (out_iscode()) {
+                puts("Output bank holds machine code.\n\r");
+                if (ast.bin_top) {
+                    prn_code(ast.bin_base, ast.bin_top);
+                }
+                return;
+            }
 
         } else {
 
@@ -822,11 +1940,13 @@ void list_buf(void)
     // set corresponding buffer's bank number
     __asm__("lda %v", bank_num);
     __asm__("jsr %w", MOS_BANKEDRAMSEL);
+    n = lidx_find(from_line);
+    line = lidx[n].line;
+    addr = lidx[n].addr;
     while (1) {
         if (isnull_hdr((const char *)addr)) {
             break; // EOT, null text header is next
         }
-        line = PEEKW(addr);
         if (line > to_line) {
             break;
         }
@@ -836,10 +1956,11 @@ void list_buf(void)
                 puts(ibuf1);
                 puts(":");
             }
-            puts ((const char *)(addr + 5));
+            puts (TBREC_TXTPTR(addr));
             puts ("\n\r");
         }
-        addr = PEEKW(addr + 3);
+        addr = tb_next(addr);
+        line++;
         if (isaddr_oor(addr)) {
             return;
         }
@@ -848,6 +1969,9 @@ void list_buf(void)
                         // PropTermMK to time out in SaveOutput2FileSD.
 }
 
+#pragma rodata-name (pop)
+#pragma code-name (pop)
+
 /*
  * Position current line at gtl.
  * Return # of next line or 0xFFFF if null header.
@@ -855,24 +1979,26 @@ void list_buf(void)
 uint16_t goto_line(unsigned int gtl)
 {
     unsigned int line;
-    uint16_t nxtaddr;
+    uint16_t nxtaddr, addr;
     unsigned int line_to = gtl;
-    uint16_t addr = START_BRAM;
     uint16_t ret = 0;
 
+    line = lidx_find(gtl);
+    addr = lidx[line].addr;
+    line = lidx[line].line;
     while (1) {
-        line = PEEKW(addr);
-        nxtaddr = PEEKW(addr + 3);
+        nxtaddr = tb_next(addr);
         if (line == line_to
             ||
             isnull_hdr((const char *)nxtaddr)) {
 
             line_num = line;
             curr_addr = addr;
-            ret = PEEKW(nxtaddr);
+            ret = isnull_hdr((const char *)nxtaddr) ? 0xFFFF : line + 1;
             break;
         }
         addr = nxtaddr;
+        line++;
         if (isaddr_oor(addr)) {
             break;
         }
@@ -881,69 +2007,6 @@ uint16_t goto_line(unsigned int gtl)
     return ret;
 }
 
-/*
- * Renumber line numbers in text records starting at address addr.
- * Also, refresh the next record pointers in these text records as this
- * function is called after the text has been relocated in buffer.
- * Return address where the renumbering ended.
- */
-uint16_t renumber(uint16_t addr, int offs)
-{
-    unsigned int lnum;
-    uint16_t nxtaddr;
-
-    while(1) {
-        if (isnull_hdr((const char *)addr)) {
-            break;
-        }
-        lnum = PEEKW(addr) + offs;
-        POKEW(addr, lnum);
-        nxtaddr = addr + PEEK(addr + 2) + 6;
-        if (isaddr_oor(nxtaddr)) {
-            break;
-        }
-        POKEW(addr + 3, nxtaddr);
-        addr = nxtaddr;
-    }
-
-    return addr;
-}
-
-/*
- * Delete text from buffer.
- */
-void delete_text(unsigned int from_line, unsigned int to_line)
-{
-    uint16_t tmpaddr, endaddr;
-    uint16_t addr = START_BRAM;
-
-    if (to_line < from_line) {
-        prn_error (ERROR_BADARG);
-        return;
-    }
-    // the actual delete procedure
-    // 1. Go to the from_line position.
-    goto_line(from_line);
-    tmpaddr = curr_addr; // remember current addr - we shift up to this addr
-    // 2. Find address of the next line after to_line.
-    goto_line(to_line);
-    endaddr = PEEKW(curr_addr + 3);
-    utoa((unsigned int)endaddr, ibuf1, RADIX_HEX);
-    strcat(ibuf1, " ");
-    strcat(ibuf1, utoa((unsigned int)lastaddr, ibuf2, RADIX_HEX));
-    assert(__LINE__, (endaddr <= lastaddr), ibuf1);
-    // 3. Delete lines from_line .. to_line by moving text up in the buffer.
-    memmove((void *)tmpaddr, (void *)endaddr,
-            lastaddr - endaddr + strlen(null_txt_hdr));
-    // renumerate lines and change pointer to next line in each
-    addr = tmpaddr;
-    lastaddr = lastaddr - (endaddr - tmpaddr);  // last address is now closer
-    addr = renumber(addr, (from_line - to_line - 1));
-    if (addr >= lastaddr && 0 == isaddr_oor(addr)) {
-        strcpy((char *)addr, null_txt_hdr);
-    }
-}
-
 /*
  * Initialization and command shell loop.
  */
@@ -960,17 +2023,6 @@ void cmd_shell(void)
     }
 }
 
-void prn_banner(void)
-{
-    pause_sec64(128);
-    while (kbhit()) getc(); // flush RX buffer
-    puts("\n\r");
-    puts("Welcome to MOS 6502 Assembler ");
-    puts(ver);
-    puts("(C) Marek Karcz 2018. All rights reserved.\n\r");
-    puts("Type 'h' for guide.\n\r\n\r");
-}
-
 /*
  * Initialize text buffer by putting null text header 1-st.
  */
@@ -982,16 +2034,42 @@ void init_buf(void)
         bank_num = out_bank_num;
         __asm__("lda %v", bank_num);
         __asm__("jsr %w", MOS_BANKEDRAMSEL);
-        strcpy((char *)START_BRAM, null_txt_hdr);
+        memset((void *)START_BRAM, 0, TBHDR_SIZE);
+        POKE(START_BRAM, TB_MAGIC1);
+        POKE(START_BRAM + 1, TB_MAGIC2);
+        POKE(START_BRAM + 2, TB_VERSION);
+        strcpy((char *)START_TEXT, null_txt_hdr);
         line_num = 0;
-        curr_addr = START_BRAM;
+        curr_addr = START_TEXT;
         last_line = 0;
         line_count = 0;
         lastaddr = curr_addr + strlen(null_txt_hdr);
         bankinit_flags[bank_num] = 1;
+        lidx_count = 0;
+        tb_putcache(0);
+        ast_clear();    // no machine code for incremental assembly
     }
 }
 
+#pragma code-name (push, "OVERLAY2")
+#pragma rodata-name (push, "OVERLAY2")
+
+const char ovl_siginfo[] = __DATE__ " " __TIME__;
+
+/*
+ * Show banner of the program.
+ */
+void prn_banner(void)
+{
+    pause_sec64(128);
+    while (kbhit()) getc(); // flush RX buffer
+    puts("\n\r");
+    puts("Welcome to MOS 6502 Assembler ");
+    puts(ver);
+    puts("(C) Marek Karcz 2018. All rights reserved.\n\r");
+    puts("Type 'h' for guide.\n\r\n\r");
+}
+
 /*
  * Show / set current memory bank.
  * Command is expected in prompt_buf before calling this function:
@@ -1009,6 +2087,11 @@ void set_buffers(void)
         n1 = adv2next_spc(n0);
         if (n1 > n0) {
             out_bank_num = atoi(prompt_buf + n0);
+            n0 = adv2nxt_token(n1);
+            n1 = adv2next_spc(n0);
+            if (n1 > n0) {
+                symb_bank_num = atoi(prompt_buf + n0);
+            }
         }
     } else {
         prn_error(ERROR_BADARG);
@@ -1035,20 +2118,65 @@ void mem_info(void)
     puts(utoa((unsigned int)line_count, ibuf1, RADIX_DEC));
     puts("\n\r");
     puts(divider);
-    check_buf(out_bank_num);
+    if (out_iscode()) {
+        // machine code of the last assembly, not a text buffer
+        puts(divider);
+        puts("Output bank#.............: ");
+        puts(itoa(out_bank_num, ibuf1, RADIX_DEC));
+        puts(" (machine code)\n\r");
+        if (ast.bin_top) {
+            prn_code(ast.bin_base, ast.bin_top);
+        }
+    } else {
+        check_buf(out_bank_num);
+        puts(divider);
+        puts("Output bank#.............: ");
+        puts(itoa(out_bank_num, ibuf1, RADIX_DEC));
+        puts("\n\rNext free memory address.: $");
+        puts(utoa((unsigned int)lastaddr, ibuf1, RADIX_HEX));
+        puts("\n\rLast line#...............: ");
+        puts(utoa((unsigned int)last_line, ibuf1, RADIX_DEC));
+        puts("\n\rLines in buffer..........: ");
+        puts(utoa((unsigned int)line_count, ibuf1, RADIX_DEC));
+        puts("\n\r");
+    }
     puts(divider);
-    puts("Output bank#.............: ");
-    puts(itoa(out_bank_num, ibuf1, RADIX_DEC));
-    puts("\n\rNext free memory address.: $");
-    puts(utoa((unsigned int)lastaddr, ibuf1, RADIX_HEX));
-    puts("\n\rLast line#...............: ");
-    puts(utoa((unsigned int)last_line, ibuf1, RADIX_DEC));
-    puts("\n\rLines in buffer..........: ");
-    puts(utoa((unsigned int)line_count, ibuf1, RADIX_DEC));
-    puts("\n\r");
     puts(divider);
+    symb_stats();
+    puts(divider);
+}
+
+/*
+ * Show symbol table load statistics.
+ */
+void symb_stats(void)
+{
+    puts("Symbol table bank#.......: ");
+    puts(itoa(symb_bank_num, ibuf1, RADIX_DEC));
+    puts("\n\rSymbols..................: ");
+    puts(utoa(symb_count, ibuf1, RADIX_DEC));
+    puts(" of ");
+    puts(utoa(SYMB_MAXCOUNT, ibuf1, RADIX_DEC));
+    puts("\n\rHash table load..........: ");
+    puts(ultoa((unsigned long)symb_count * 100 / SYMB_SLOTS, ibuf1, RADIX_DEC));
+    puts("% of ");
+    puts(utoa(SYMB_SLOTS, ibuf1, RADIX_DEC));
+    puts(" slots\n\rFree memory for names....: ");
+    puts(utoa(symb_free, ibuf1, RADIX_DEC));
+    puts("\n\rSlots probed per lookup..: ");
+    if (symb_lookups) {
+        puts(ultoa(symb_probes / symb_lookups, ibuf1, RADIX_DEC));
+        puts(".");
+        puts(ultoa(symb_probes * 10 / symb_lookups % 10, ibuf1, RADIX_DEC));
+    } else {
+        puts("-");
+    }
+    puts("\n\r");
 }
 
+#pragma rodata-name (pop)
+#pragma code-name (pop)
+
 /*
  * Sanity check.
  * Check the text buffer located in bank# = bank and set global variables.
@@ -1058,23 +2186,42 @@ void mem_info(void)
  */
 int check_buf(int bank)
 {
-    uint16_t addr = START_BRAM;
+    uint16_t addr = START_TEXT;
     uint16_t lcount = MAX_LINES;
+    uint16_t gap = 0;
     int ret = 0;
+    int walk = 1;
 
     if (code_bank_num == out_bank_num) {
         prn_error(ERROR_BANKSEQUAL);
         return ret;
     }
+    if (symb_bank_num == code_bank_num || symb_bank_num == out_bank_num
+        || symb_bank_num < 0 || symb_bank_num > 7) {
+
+        prn_error(ERROR_SYMBBANK);
+        return ret;
+    }
     if (bank < 0 || bank > 7) {
         prn_error(ERROR_BADBANK);
         return ret;
     }
+    if (OVL_BANK == code_bank_num || OVL_BANK == out_bank_num
+        || OVL_BANK == symb_bank_num) {
+
+        prn_error(ERROR_OVLBANK);
+        return ret;
+    }
+    sel_bank(bank);
     if (0 == bankinit_flags[bank]) {
         // Check if the buffer was ever initialized.
         // Several protective measures applied to prevent this loop from
         // looping forever.
         puts("Text buffer sanity check ... ");
+        if (0 == TB_HDROK) {
+            // no header, maybe text buffer format version 1
+            addr = START_BRAM;
+        }
         set_timeout(30); // 30 seconds timeout
         while (lcount > 0 && 0 == is_timeout()) {
 
@@ -1082,39 +2229,56 @@ int check_buf(int bank)
                ret = 1;
                break;
            }
-           addr = PEEKW(addr + 3);
+           addr = PEEKW(addr + (TB_HDROK ? TBREC_NEXT : 3));
            if (isaddr_oor(addr)) {
                break;
            }
            lcount--;
         }
         puts("done.\n\r");
+        if (ret && 0 == TB_HDROK) {
+            prn_error(ERROR_OLDFMT);
+            return 0;
+        }
     } else {
         ret = 1;
+        walk = (0 == tb_cacheok());
     }
     if (ret) {
         bankinit_flags[bank] = 1;   // set the flag, buffer is sane
-        addr = START_BRAM;
-        line_count = 0;
-        // Find last line (pointing to null_txt_hdr) and line count.
-        ret = 0;
-        set_timeout(30);   // 30 seconds timeout
-        lcount = MAX_LINES;
-        while (lcount > 0 && 0 == is_timeout()) {
-            if (isnull_hdr((const char *)addr)) {
-                ret = 1;
-                break;  // found last line
-            }
-            last_line = PEEKW(addr);
-            addr = PEEKW(addr + 3);
-            if (isaddr_oor(addr)) {
-                break;
+        if (walk) {
+            addr = START_TEXT;
+            line_count = 0;
+            // Find last line (pointing to null_txt_hdr) and line count.
+            ret = 0;
+            set_timeout(30);   // 30 seconds timeout
+            lcount = MAX_LINES;
+            while (lcount > 0 && 0 == is_timeout()) {
+                if (isnull_hdr((const char *)addr)) {
+                    ret = 1;
+                    break;  // found last line
+                }
+                if (TBREC_GETLEN(addr) != TBGAP_MARK) {
+                    line_count++;           // not a gap record
+                } else {
+                    gap = addr;
+                }
+                addr = TBREC_GETNXT(addr);
+                if (isaddr_oor(addr)) {
+                    break;
+                }
+                lcount--;
             }
-            line_count++;
-            lcount--;
+        } else {
+            // values cached in buffer header are valid
+            addr = TBHDR_GETW(TBHDR_TAIL);
+            line_count = TBHDR_GETW(TBHDR_LINES);
+            gap = TBHDR_GETW(TBHDR_GAP);
         }
         if (ret) {
+            last_line = line_count ? line_count - 1 : 0;
             lastaddr = addr + strlen(null_txt_hdr);
+            tb_putcache(gap);
             if (line_num > last_line) {
 
                 line_num = last_line;
@@ -1127,12 +2291,12 @@ int check_buf(int bank)
             prn_error(ERROR_TIMEOUT);
             puts("Text buffer may be corrupted.");
             init_buf();
-            ret = isnull_hdr((const char *)START_BRAM);
+            ret = isnull_hdr((const char *)START_TEXT);
         }
     } else {
         prn_error(ERROR_BUFNOTINIT);
         init_buf();
-        ret = isnull_hdr((const char *)START_BRAM);
+        ret = isnull_hdr((const char *)START_TEXT);
     }
 
     return ret;
@@ -1147,18 +2311,25 @@ int main(void)
     code_bank_num = 0;
     out_bank_num = 1;
     bank_num = 0;
-    curr_addr = START_BRAM;
+    curr_addr = START_TEXT;
     last_line = 0;
     line_count = 0;
-    lastaddr = START_BRAM;
-    symb_idx = 0;
+    lastaddr = START_TEXT;
+    symb_bank_num = SYMB_BANK;
+    lidx_count = 0;
 
     // initialize text buffer init flags
     for (i=0; i<8; i++) {
         bankinit_flags[i] = 0;
     }
-    prn_banner();
-    mem_info();
+    symb_count = 0;
+    symb_end = END_BRAM;
+    symb_free = END_BRAM - SYMB_POOL;
+    ovl_curr = OVL_NONE;
+    if (ovl_load(OVL_INFO)) {
+        prn_banner();
+        mem_info();
+    }
     cmd_shell();
     return 0;
 }
@@ -0,0 +1,1914 @@
+/*
+ *
+ * File:	asm6502core.c
+ * Purpose:	Core of MOS 6502 assembler (see asm6502core.h).
+ * Author:	Marek Karcz
+ * Created:	10/18/2026
+ *
+ * Revision history:
+ *
+ * 10/18/2026
+ *  Created. Parsing of source code lines, expressions, addressing modes,
+ *  directives, passes and listing moved here from asm6502.c, so the same
+ *  code builds for MKHBC-8-Rx (cc65) and for host computer (gcc).
+ *
+ * 10/18/2026
+ *  asm_resume() continues multi-pass assembly of some lines with symbol
+ *  values of a previous assembly (incremental assembly in asm6502).
+ *  asm_fwd and asm_def tell if the line uses forward reference or defines
+ *  symbol, asm_narrow that wide line has operand in zero page or short
+ *  branch (resumed assembly can't keep its code, see asm_fwdzp()).
+ *
+ * 10/18/2026
+ *  Peephole optimization with option OPT_PEEP (see peep_ins()).
+ *
+ * 10/18/2026
+ *  Directives .include, .macro, .endm and macro calls with parameters
+ *  (see mac_call(), mac_line()). Error messages show line # and unit set
+ *  by application. FIX_SIZE 320 -> 224, so that macro tables fit in XBSS
+ *  of asm6502.cfg.
+ *
+ *  ..........................................................................
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "asm6502core.h"
+
+// Error messages.
+const char *ga_errmsg[ERROR_UNKNOWN + 1] =
+{
+    "OK.",
+    "Unknown command.",
+    "Check arguments.",
+    "No text in buffer.",
+    "Buffer was never initialized.",
+    "Address out of range.",
+    "Timeout during text buffer search operation.",
+    "Buffer full.",
+    "Invalid RAM bank#. (expected: 0..7)",
+    "Code and output buffers must be in different banks.",
+    "Symbol table full.",
+    "Old text buffer format, open it in texted to convert.",
+    "Symbol table and buffers must be in different banks.",
+    "Syntax error.",
+    "Addressing mode not available for this instruction.",
+    "Undefined symbol.",
+    "Symbol already defined.",
+    "Value out of range.",
+    "Branch out of range.",
+    "Forward reference not allowed here.",
+    "Too many forward references.",
+    "Symbol value differs between passes.",
+    "Too many nested .include or macro calls.",
+    "Bad macro definition or call.",
+    "Too many macros.",
+    "RAM bank is reserved for overlays.",
+    "Overlay is not loaded (asm6502_ovl.txt).",
+    "Unknown."
+};
+
+const struct instr OpCodes[57] = {
+    // aa = Z (8-bit value), aaaa = Address (16-bit value), Acc - accumulator (register)
+    //instr  IMM   ABS   ZPG   IMP   INDAB ABINX ABINY ZPGIX ZPGIY IXIND INDIY REL   ACC
+    //       #Z    A     Z           (A)   A,X   A,Y   Z,X   Z,Y   (Z,X) (Z),Y A     Acc
+    {"adc", {0x69, 0x6D, 0x65, 0x00, 0x00, 0x7D, 0x79, 0x75, 0x00, 0x61, 0x71, 0x00, 0x00, 0x00}},
+    {"and", {0x29, 0x2D, 0x25, 0x00, 0x00, 0x3D, 0x39, 0x35, 0x00, 0x21, 0x31, 0x00, 0x00, 0x00}},
+    {"asl", {0x00, 0x0E, 0x06, 0x00, 0x00, 0x1E, 0x00, 0x16, 0x00, 0x00, 0x00, 0x00, 0x0A, 0x00}},
+    {"bit", {0x00, 0x2C, 0x24, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"bpl", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00}},
+    {"bmi", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00}},
+    {"bvc", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x50, 0x00, 0x00}},
+    {"bvs", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x70, 0x00, 0x00}},
+    {"bcc", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00}},
+    {"bcs", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xB0, 0x00, 0x00}},
+    {"bne", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xD0, 0x00, 0x00}},
+    {"beq", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x00, 0x00}},
+    {"cmp", {0xC9, 0xCD, 0xC5, 0x00, 0x00, 0xDD, 0xD9, 0xD5, 0x00, 0xC1, 0xD1, 0x00, 0x00, 0x00}},
+    {"cpx", {0xE0, 0xEC, 0xE4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"cpy", {0xC0, 0xCC, 0xC4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"dec", {0x00, 0xCE, 0xC6, 0x00, 0x00, 0xDE, 0x00, 0xD6, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"eor", {0x49, 0x4D, 0x45, 0x00, 0x00, 0x5D, 0x59, 0x55, 0x00, 0x41, 0x51, 0x00, 0x00, 0x00}},
+    {"clc", {0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"sec", {0x00, 0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"cli", {0x00, 0x00, 0x00, 0x58, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"sei", {0x00, 0x00, 0x00, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"clv", {0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"cld", {0x00, 0x00, 0x00, 0xD8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"sed", {0x00, 0x00, 0x00, 0xF8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"inc", {0x00, 0xEE, 0xE6, 0x00, 0x00, 0xFE, 0x00, 0xF6, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"jmp", {0x00, 0x4C, 0x00, 0x00, 0x6C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"jsr", {0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"lda", {0xA9, 0xAD, 0xA5, 0x00, 0x00, 0xBD, 0xB9, 0xB5, 0x00, 0xA1, 0xB1, 0x00, 0x00, 0x00}},
+    {"ldx", {0xA2, 0xAE, 0xA6, 0x00, 0x00, 0x00, 0xBE, 0x00, 0xB6, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"ldy", {0xA0, 0xAC, 0xA4, 0x00, 0x00, 0xBC, 0x00, 0xB4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"lsr", {0x00, 0x4E, 0x46, 0x00, 0x00, 0x5E, 0x00, 0x56, 0x00, 0x00, 0x00, 0x00, 0x4A, 0x00}},
+    {"nop", {0x00, 0x00, 0x00, 0xEA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"ora", {0x09, 0x0D, 0x05, 0x00, 0x00, 0x1D, 0x19, 0x15, 0x00, 0x01, 0x11, 0x00, 0x00, 0x00}},
+    {"tax", {0x00, 0x00, 0x00, 0xAA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"txa", {0x00, 0x00, 0x00, 0x8A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"dex", {0x00, 0x00, 0x00, 0xCA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"inx", {0x00, 0x00, 0x00, 0xE8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"tay", {0x00, 0x00, 0x00, 0xA8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"tya", {0x00, 0x00, 0x00, 0x98, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"dey", {0x00, 0x00, 0x00, 0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"iny", {0x00, 0x00, 0x00, 0xC8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    // aa = Z (8-bit value), aaaa = Address (16-bit value), Acc - accumulator (register)
+    //instr  IMM   ABS   ZPG   IMP   INDAB ABINX ABINY ZPGIX ZPGIY IXIND INDIY REL   ACC
+    //       #Z    A     Z           (A)   A,X   A,Y   Z,X   Z,Y   (Z,X) (Z),Y A     Acc
+    {"rol", {0x00, 0x2E, 0x26, 0x00, 0x00, 0x3E, 0x00, 0x36, 0x00, 0x00, 0x00, 0x00, 0x2A, 0x00}},
+    {"ror", {0x00, 0x6E, 0x66, 0x00, 0x00, 0x7E, 0x00, 0x76, 0x00, 0x00, 0x00, 0x00, 0x6A, 0x00}},
+    {"rti", {0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"rts", {0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"sbc", {0xE9, 0xED, 0xE5, 0x00, 0x00, 0xFD, 0xF9, 0xF5, 0x00, 0xE1, 0xF1, 0x00, 0x00, 0x00}},
+    {"sta", {0x00, 0x8D, 0x85, 0x00, 0x00, 0x9D, 0x99, 0x95, 0x00, 0x81, 0x91, 0x00, 0x00, 0x00}},
+    {"txs", {0x00, 0x00, 0x00, 0x9A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"tsx", {0x00, 0x00, 0x00, 0xBA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"pha", {0x00, 0x00, 0x00, 0x48, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"pla", {0x00, 0x00, 0x00, 0x68, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"php", {0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"plp", {0x00, 0x00, 0x00, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"stx", {0x00, 0x8E, 0x86, 0x00, 0x00, 0x00, 0x00, 0x00, 0x96, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"sty", {0x00, 0x8C, 0x84, 0x00, 0x00, 0x00, 0x00, 0x94, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"brk", {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"nnn", {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}}
+};
+
+// # of cycles of instructions in OpCodes indexed by op-code (see CYC_MASK),
+// 0 - op-code not used.
+const unsigned char OpCycles[256] = {
+    //x0    x1    x2    x3    x4    x5    x6    x7    x8    x9    xA    xB    xC    xD    xE    xF
+    0x07, 0x06, 0x00, 0x00, 0x00, 0x03, 0x05, 0x00, 0x03, 0x02, 0x02, 0x00, 0x00, 0x04, 0x06, 0x00,  // 0x
+    0x22, 0x15, 0x00, 0x00, 0x00, 0x04, 0x06, 0x00, 0x02, 0x14, 0x00, 0x00, 0x00, 0x14, 0x07, 0x00,  // 1x
+    0x06, 0x06, 0x00, 0x00, 0x03, 0x03, 0x05, 0x00, 0x04, 0x02, 0x02, 0x00, 0x04, 0x04, 0x06, 0x00,  // 2x
+    0x22, 0x15, 0x00, 0x00, 0x00, 0x04, 0x06, 0x00, 0x02, 0x14, 0x00, 0x00, 0x00, 0x14, 0x07, 0x00,  // 3x
+    0x06, 0x06, 0x00, 0x00, 0x00, 0x03, 0x05, 0x00, 0x03, 0x02, 0x02, 0x00, 0x03, 0x04, 0x06, 0x00,  // 4x
+    0x22, 0x15, 0x00, 0x00, 0x00, 0x04, 0x06, 0x00, 0x02, 0x14, 0x00, 0x00, 0x00, 0x14, 0x07, 0x00,  // 5x
+    0x06, 0x06, 0x00, 0x00, 0x00, 0x03, 0x05, 0x00, 0x04, 0x02, 0x02, 0x00, 0x05, 0x04, 0x06, 0x00,  // 6x
+    0x22, 0x15, 0x00, 0x00, 0x00, 0x04, 0x06, 0x00, 0x02, 0x14, 0x00, 0x00, 0x00, 0x14, 0x07, 0x00,  // 7x
+    0x00, 0x06, 0x00, 0x00, 0x03, 0x03, 0x03, 0x00, 0x02, 0x00, 0x02, 0x00, 0x04, 0x04, 0x04, 0x00,  // 8x
+    0x22, 0x06, 0x00, 0x00, 0x04, 0x04, 0x04, 0x00, 0x02, 0x05, 0x02, 0x00, 0x00, 0x05, 0x00, 0x00,  // 9x
+    0x02, 0x06, 0x02, 0x00, 0x03, 0x03, 0x03, 0x00, 0x02, 0x02, 0x02, 0x00, 0x04, 0x04, 0x04, 0x00,  // Ax
+    0x22, 0x15, 0x00, 0x00, 0x04, 0x04, 0x04, 0x00, 0x02, 0x14, 0x02, 0x00, 0x14, 0x14, 0x14, 0x00,  // Bx
+    0x02, 0x06, 0x00, 0x00, 0x03, 0x03, 0x05, 0x00, 0x02, 0x02, 0x02, 0x00, 0x04, 0x04, 0x06, 0x00,  // Cx
+    0x22, 0x15, 0x00, 0x00, 0x00, 0x04, 0x06, 0x00, 0x02, 0x14, 0x00, 0x00, 0x00, 0x14, 0x07, 0x00,  // Dx
+    0x02, 0x06, 0x00, 0x00, 0x03, 0x03, 0x05, 0x00, 0x02, 0x02, 0x02, 0x00, 0x04, 0x04, 0x06, 0x00,  // Ex
+    0x22, 0x15, 0x00, 0x00, 0x00, 0x04, 0x06, 0x00, 0x02, 0x14, 0x00, 0x00, 0x00, 0x14, 0x07, 0x00  // Fx
+};
+
+// Perfect hash of mnemonics. Letters of mnemonic are folded to 5 bits
+// (c & 31, so the case doesn't matter), hash is
+//  (mnem_asso[c0] + 2 * mnem_asso[c1] + c2) & 127
+// and it is different for each mnemonic in OpCodes. Values in mnem_asso were
+// found by a search run on host computer, mnem_slot is an index of OpCodes
+// entry for each hash value (0xFF - no mnemonic).
+#define MNEM_HASH(s)    ((mnem_asso[(s)[0] & 31] \
+                          + (mnem_asso[(s)[1] & 31] << 1) \
+                          + ((s)[2] & 31)) & 127)
+
+const unsigned char mnem_asso[32] = {
+    0xC5, 0x8A, 0xD4, 0x84, 0x4A, 0xCF, 0x9B, 0xF4,
+    0x06, 0x6F, 0x72, 0x44, 0x47, 0xDA, 0x80, 0x2E,
+    0x13, 0xF9, 0x25, 0xA9, 0xF1, 0x33, 0xB5, 0xDE,
+    0x93, 0xDE, 0xF4, 0xE2, 0x85, 0x1F, 0x07, 0x2F
+};
+
+const unsigned char mnem_slot[128] = {
+    0x23, 0x27, 0xFF, 0x0B, 0xFF, 0xFF, 0x04, 0x24,
+    0x28, 0xFF, 0xFF, 0xFF, 0x2E, 0x29, 0x01, 0xFF,
+    0x2B, 0x05, 0xFF, 0x2A, 0xFF, 0x11, 0x16, 0xFF,
+    0x22, 0xFF, 0x2C, 0x13, 0xFF, 0x21, 0x25, 0xFF,
+    0x31, 0x00, 0x32, 0x35, 0x36, 0xFF, 0xFF, 0xFF,
+    0x15, 0x37, 0x2F, 0x1E, 0xFF, 0xFF, 0x26, 0x33,
+    0xFF, 0x34, 0xFF, 0xFF, 0xFF, 0xFF, 0x19, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x10, 0xFF, 0xFF,
+    0xFF, 0x06, 0x0D, 0x0E, 0xFF, 0xFF, 0x03, 0xFF,
+    0x0C, 0xFF, 0x12, 0x17, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x14, 0x07, 0xFF, 0xFF, 0x2D, 0xFF, 0x1A, 0xFF,
+    0xFF, 0x0A, 0xFF, 0x30, 0x1B, 0xFF, 0xFF, 0x08,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x02, 0xFF, 0xFF, 0x0F, 0x1F, 0xFF, 0xFF, 0x09,
+    0xFF, 0xFF, 0x18, 0x1C, 0x1D, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x20, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+#define PEEP_NONE       0xFFFF  // peep_line: no previous instruction
+#define PEEP_TAIL       1       // peep.type: JSR followed by RTS -> JMP
+#define PEEP_FOLD       2       //            branch over JMP -> inverted
+                                //            branch to target of JMP
+#define PEEP_BLOCKED    0x80    //            folded branch out of range
+#define PEEP_IOSTART    0xC000  // I/O space, loads there are not removed
+#define PEEP_IOEND      0xC7FF
+
+// Optimization decided in a pass for the line of JSR or branch, applied to
+// the line in the following passes.
+struct peep {
+    uint16_t line;          // line of JSR or branch
+    uint16_t sym;           // PEEP_FOLD: target of JMP is value of symbol
+    uint16_t val;           //  sym (0 - none) + val
+    unsigned char type;     // PEEP_TAIL, PEEP_FOLD
+};
+
+// Macro: position of its .macro line. Symbol table keeps index of macro
+// in macros as value of symbol "." + name of macro.
+struct macro {
+    uint16_t pos;
+    unsigned char unit;
+};
+
+// Macro being expanded: arguments of the call and parameters from the
+// .macro line (strings one after another).
+struct mac_frame {
+    char args[ASM_LINESIZE];
+    char params[ASM_LINESIZE];
+    unsigned char nargs;
+    unsigned char nparams;
+    unsigned int num;       // # of the call in pass, replaces '@'
+};
+
+// Fixups, wide line flags, optimizations and macros are large, they are
+// kept in upper RAM (not cleared at start).
+#ifdef __CC65__
+#pragma bss-name (push, "XBSS")
+#endif
+struct fixup fixups[FIX_SIZE];
+unsigned char asm_wide[WIDE_SIZE];  // bit per line of source, see wide_get()
+struct peep peeps[PEEP_SIZE];       // sorted by line, see peep_ins()
+struct macro macros[MAC_SIZE];
+struct mac_frame mac_frames[MAC_DEPTH];
+#ifdef __CC65__
+#pragma bss-name (pop)
+#endif
+
+const char hexdigits[] = "0123456789ABCDEF";
+
+// Op-codes that set N, Z flags from A (besides ORA, AND, EOR, ADC, LDA and
+// SBC) and op-codes that change neither A nor N, Z flags (besides STA), see
+// peep_ins().
+const unsigned char peep_nzaops[] = {
+    0x8A, 0x98, 0x68, 0xAA, 0xA8, 0x0A, 0x4A, 0x2A, 0x6A
+};
+const unsigned char peep_keepops[] = {
+    0x84, 0x86, 0x8C, 0x8E, 0x94, 0x96,
+    0x18, 0x38, 0x58, 0x78, 0xB8, 0xD8, 0xF8, 0xEA
+};
+
+// globals
+char asm_buf[ASM_LINESIZE];     // line of source code being assembled
+char *asm_p;                    // parsing position in asm_buf
+unsigned char asm_code[ASM_LINESIZE];   // machine code of the line
+unsigned char asm_len;          // # of bytes in asm_code
+uint16_t asm_pc;                // address of machine code of the line
+unsigned char asm_pass;         // # of current pass (1, 2, ...)
+unsigned char asm_pass1;        // # of the 1-st pass (1 unless resumed)
+unsigned char asm_passes;       // max. # of passes
+unsigned char asm_emit;         // non-zero in the last pass
+unsigned char asm_opts;         // OPT_BIN, OPT_LIST, OPT_LONGBR
+unsigned char asm_fwd;          // non-zero if the line uses forward reference
+unsigned char asm_def;          // non-zero if the line defines symbol
+unsigned char asm_narrow;       // non-zero if the line is wide, but its
+                                // operand is in zero page / branch is short
+unsigned int asm_changed;       // # of changed symbols and wrong guesses
+unsigned int asm_line, asm_errors, asm_bytes;
+unsigned int fix_count;         // # of fixups
+unsigned int fix_line;          // index of 1-st fixup of current line
+char *asm_label;                // label of the line (in asm_buf) or 0
+unsigned char asm_labellen;     // length of label
+unsigned char asm_ins;          // non-zero if the line is an instruction
+unsigned char asm_mode;         // addressing mode of the instruction
+uint16_t asm_val;               // and value of its operand
+unsigned char asm_peep;         // non-zero if the line was optimized
+unsigned char peep_count;       // # of entries in peeps
+unsigned char peep_next;        // peeps index of line >= the last found
+uint16_t peep_line;             // previous instruction: line or PEEP_NONE,
+uint16_t peep_pc;               //  address,
+uint16_t peep_val;              //  value of operand (not known if
+unsigned char peep_undef;       //  peep_undef is non-zero),
+unsigned char peep_opc;         //  op-code (before optimization),
+unsigned char peep_mode;        //  addressing mode,
+unsigned char peep_len;         //  # of bytes of code,
+unsigned char peep_nza;         //  N, Z flags reflect A after it,
+unsigned char peep_end;         //  code after it is not reachable
+unsigned char peep_label;       // label since previous instruction
+char peep_name[SYMB_NAMELEN];   // operand of previous branch if it is
+unsigned char peep_namelen;     //  a symbol, length of it or 0
+uint16_t peep_fold;             // line of branch over JMP (PEEP_NONE - no)
+uint16_t peep_foldsym;          //  and target of JMP (like in struct peep)
+uint16_t peep_foldval;
+unsigned char peep_folded;      // previous branch was folded
+uint16_t peep_foldto;           //  to this address
+unsigned int peep_lines, peep_bytes, peep_cycles;
+unsigned char asm_unit;         // source unit of the line,
+uint16_t asm_pos;               //  its position in the unit
+unsigned int asm_srcline;       //  and line # (set by application)
+unsigned char asm_main;         // source unit of main source code
+unsigned char asm_include;      // unit to include or SRC_NONE
+unsigned char asm_call;         // non-zero if macro was called,
+unsigned char mac_unit;         //  unit and position of its .macro line
+uint16_t mac_pos;
+unsigned char mac_count;        // # of entries in macros
+unsigned char mac_depth;        // # of entries in mac_frames
+unsigned char mac_def;          // non-zero inside macro definition
+unsigned int mac_calls;         // # of macro calls in pass
+char blk_name[SYMB_NAMELEN + 1];    // listing: label of block of code,
+unsigned int blk_min, blk_max;      // its min. and max. # of cycles
+unsigned int blk_n;                 // and # of instructions
+uint16_t expr_sym;              // expression: last undefined symbol
+uint16_t expr_addend;           // value without < or >
+unsigned char expr_undef;       // # of undefined symbols
+unsigned char expr_fwd;         // non-zero if forward reference used
+unsigned char expr_lin;         // zero if not undefined symbol + constant
+unsigned char expr_part;        // FIX_LO, FIX_HI or 0
+char expr_op;                   // operation applied to term
+
+// function prototypes (not in asm6502core.h)
+void        asm_operand(int opcidx);
+void        asm_directive(void);
+void        asm_define(const char *name, unsigned char len, uint16_t val,
+                       unsigned char fwd);
+void        asm_putval(uint16_t val, unsigned char size);
+void        asm_skipspc(void);
+int         asm_eol(void);
+int         expr_eval(uint16_t *val);
+int         expr_term(uint16_t *val);
+int         fix_add(unsigned char type);
+void        asm_guess(unsigned char type);
+unsigned int fix_check(void);
+unsigned char asm_fwdzp(uint16_t val);
+void        asm_branch(uint16_t val);
+void        list_cycles(char *s);
+void        peep_reset(void);
+struct peep *peep_find(uint16_t line);
+struct peep *peep_add(uint16_t line, unsigned char type);
+void        peep_target(const char *name, unsigned char len);
+void        peep_ins(const char *arg);
+int         mac_isdir(const char *s, const char *dir);
+unsigned char mac_list(char *out, unsigned char params);
+void        mac_define(void);
+void        mac_call(unsigned char len);
+
+////////////////////////////// CODE /////////////////////////////////////
+
+/*
+ * Start assembly of source code. With passes = 1 code is emitted in single
+ * pass and application patches forward references (fixups) at the end.
+ * Otherwise passes is the max. # of passes, see asm_end().
+ * opts - OPT_BIN, OPT_LIST, OPT_LONGBR.
+ */
+void asm_start(unsigned char passes, unsigned char opts)
+{
+    asm_passes = passes;
+    asm_opts = opts;
+    asm_pass = 1;
+    asm_pass1 = 1;
+    asm_emit = (1 == passes);
+    asm_errors = 0;
+    asm_bytes = 0;
+    fix_count = 0;
+    memset(asm_wide, 0, WIDE_SIZE);
+    peep_count = 0;
+    peep_lines = 0;
+    peep_bytes = 0;
+    peep_cycles = 0;
+    mac_count = 0;
+    blk_n = 0;
+    list_block();       // clear block totals
+}
+
+/*
+ * Resume multi-pass assembly, the 1-st pass is pass (2 or more), symbol
+ * table holds values of previous assembly. References to symbols that
+ * are not defined in the 1-st pass are counted as changes, they may be
+ * defined further in the source code (there are no guesses like in pass
+ * 1 of asm_start()).
+ */
+void asm_resume(unsigned char pass, unsigned char opts)
+{
+    asm_start(pass + ASM_MAXPASS - 1, opts);
+    asm_pass = pass;
+    asm_pass1 = pass;
+}
+
+/*
+ * Start pass over the source code.
+ */
+void asm_begin(void)
+{
+    asm_changed = 0;
+    asm_pc = ASM_ORG;
+    asm_line = 0;
+    peep_next = 0;
+    peep_reset();
+    mac_depth = 0;
+    mac_def = 0;
+    mac_calls = 0;
+}
+
+/*
+ * Advance to the next line of source code.
+ */
+void asm_next(void)
+{
+    asm_pc += asm_len;
+    asm_line++;
+}
+
+/*
+ * End pass over the source code, return non-zero if it was the last one.
+ * Symbols are defined in the 1-st pass and passes are repeated until
+ * nothing changes in a pass, code is emitted in the next (last) pass.
+ */
+int asm_end(void)
+{
+    if (mac_def) {
+        asm_error(ERROR_MACRO);     // no .endm
+    }
+    if (asm_emit) {
+        if (asm_opts & OPT_LIST) {
+            list_block();
+        }
+        return 1;
+    }
+    if (1 == asm_pass) {
+        asm_changed += fix_check();
+    }
+    asm_pass++;
+    asm_emit = (0 == asm_changed || asm_pass == asm_passes);
+
+    return 0;
+}
+
+/*
+ * Return index of 6502 instruction with mnemonic s (3 letters, any case) in
+ * OpCodes or -1 if s is not a mnemonic. The perfect hash of s selects the
+ * only possible entry, so just one mnemonic is compared.
+ */
+int opc_find(const char *s)
+{
+    unsigned char i = mnem_slot[MNEM_HASH(s)];
+    const char *mnem;
+
+    if (0xFF == i) {
+        return -1;
+    }
+    mnem = OpCodes[i].mnem;
+    if ((s[0] | 0x20) == mnem[0]
+        && (s[1] | 0x20) == mnem[1]
+        && (s[2] | 0x20) == mnem[2]) {
+
+        return i;
+    }
+
+    return -1;
+}
+
+/*
+ * Write val as digits hexadecimal digits to s (not null terminated).
+ */
+void hex2str(char *s, uint16_t val, unsigned char digits)
+{
+    while (digits > 0) {
+        digits--;
+        s[digits] = hexdigits[val & 15];
+        val >>= 4;
+    }
+}
+
+/*
+ * Report error errnum in current line of source code. Errors are only
+ * reported in the last pass, the other passes find the same errors.
+ * Unit of the line is shown if it is not the main source code.
+ */
+void asm_error(int errnum)
+{
+    char num[12];
+
+    if (asm_emit) {
+        asm_puts("\n\rERROR in line #");
+        asm_puts(utoa(asm_srcline, num, 10));
+        if (asm_unit != asm_main) {
+            asm_puts(" of bank#");
+            asm_puts(utoa(asm_unit, num, 10));
+        }
+        asm_puts(": ");
+        asm_puts(ga_errmsg[errnum]);
+        asm_puts("\n\r");
+        asm_puts(asm_buf);
+        asm_puts("\n\r");
+        asm_errors++;
+    }
+}
+
+/*
+ * Skip spaces and tabs in source code line.
+ */
+void asm_skipspc(void)
+{
+    while (*asm_p == ' ' || *asm_p == '\t') {
+        asm_p++;
+    }
+}
+
+/*
+ * Return non-zero at the end of source code line or at comment.
+ */
+int asm_eol(void)
+{
+    asm_skipspc();
+
+    return (0 == *asm_p || ';' == *asm_p);
+}
+
+/*
+ * Return length of identifier (symbol name) at s, 0 if there is none.
+ * Identifier starts with letter or '_', letters, digits and '_' follow.
+ */
+unsigned char ident_len(const char *s)
+{
+    unsigned char len = 0;
+    char c = *s | 0x20;
+
+    if ((c < 'a' || c > 'z') && *s != '_') {
+        return 0;
+    }
+    while (1) {
+        c = s[len] | 0x20;
+        if ((c < 'a' || c > 'z') && (c < '0' || c > '9') && s[len] != '_') {
+            break;
+        }
+        len++;
+    }
+
+    return len;
+}
+
+/*
+ * Return value of hexadecimal digit c or -1 if c is not a hex digit.
+ */
+int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
+
+/*
+ * Evaluate term of expression at asm_p to val, advance asm_p behind it.
+ * Return 0 if there is no valid term.
+ * term = $hex | %bin | decimal | 'c' | * | symbol
+ */
+int expr_term(uint16_t *val)
+{
+    uint16_t v = 0;
+    uint16_t sym;
+    unsigned char len, flags;
+    int d;
+
+    if ('$' == *asm_p) {
+        asm_p++;
+        if (0 > hex_digit(*asm_p)) {
+            return 0;
+        }
+        while (0 <= (d = hex_digit(*asm_p))) {
+            v = (v << 4) + d;
+            asm_p++;
+        }
+    } else if ('%' == *asm_p) {
+        asm_p++;
+        if (*asm_p != '0' && *asm_p != '1') {
+            return 0;
+        }
+        while (*asm_p == '0' || *asm_p == '1') {
+            v = (v << 1) + (*asm_p - '0');
+            asm_p++;
+        }
+    } else if (*asm_p >= '0' && *asm_p <= '9') {
+        while (*asm_p >= '0' && *asm_p <= '9') {
+            v = v * 10 + (*asm_p - '0');
+            asm_p++;
+        }
+    } else if ('\'' == *asm_p) {
+        asm_p++;
+        if (0 == *asm_p) {
+            return 0;
+        }
+        v = (unsigned char)*asm_p++;
+        if ('\'' == *asm_p) {
+            asm_p++;
+        }
+    } else if ('*' == *asm_p) {
+        asm_p++;
+        v = asm_pc;
+    } else if (0 < (len = ident_len(asm_p))) {
+        // symbols referenced before definition are added to symbol table
+        // in single pass mode and in the 1-st pass, fixups refer to them
+        sym = symb_find(asm_p, len, 1 == asm_passes || 1 == asm_pass);
+        asm_p += len;
+        flags = sym ? symb_read(sym, &v) : 0;
+        if (0 == flags) {
+            v = 0;
+            expr_undef++;
+            expr_sym = sym;
+            expr_fwd = 1;
+            if (expr_op != '+') {
+                expr_lin = 0;   // value is not symbol + constant
+            }
+            if (asm_pass1 == asm_pass && 1 != asm_pass) {
+                asm_changed++;  // resumed assembly, see asm_resume()
+            }
+        } else if ((flags & SYMB_PASSMASK) != asm_pass
+                   || (flags & SYMB_FWD)) {
+
+            expr_fwd = 1;       // not defined yet in this pass
+        }
+        asm_fwd |= expr_fwd;
+    } else {
+        return 0;
+    }
+    *val = v;
+
+    return 1;
+}
+
+/*
+ * Evaluate expression at asm_p to val, advance asm_p behind it.
+ * Return 0 if there is no valid expression.
+ * expr = [< | >] [-]term [op [-]term ...]
+ * Binary operators + - * / & | ^ are evaluated from left to right,
+ * < (low byte) and > (high byte) apply to the whole expression.
+ * Undefined symbols have value 0, expr_undef is # of them, expr_addend
+ * is the value of expression without < or >.
+ */
+int expr_eval(uint16_t *val)
+{
+    uint16_t v = 0;
+    uint16_t t;
+    char op = '+';
+    unsigned char neg;
+
+    expr_undef = 0;
+    expr_sym = 0;
+    expr_fwd = 0;
+    expr_lin = 1;
+    expr_part = 0;
+    asm_skipspc();
+    if ('<' == *asm_p) {
+        expr_part = FIX_LO;
+        asm_p++;
+    } else if ('>' == *asm_p) {
+        expr_part = FIX_HI;
+        asm_p++;
+    }
+    while (1) {
+        asm_skipspc();
+        neg = ('-' == *asm_p);
+        if (neg) {
+            asm_p++;
+        }
+        // expr_term() checks operation applied to undefined symbol
+        expr_op = neg ? '-' : op;
+        if (0 == expr_term(&t)) {
+            return 0;
+        }
+        if (neg) {
+            t = -t;
+        }
+        switch (op) {
+            case '+': v += t; break;
+            case '-': v -= t; break;
+            case '*': v *= t; break;
+            case '/': v = t ? v / t : 0; break;
+            case '&': v &= t; break;
+            case '|': v |= t; break;
+            default:  v ^= t; break;
+        }
+        asm_skipspc();
+        if (0 == *asm_p || 0 == strchr("+-*/&|^", *asm_p)) {
+            break;
+        }
+        op = *asm_p++;
+        if (expr_undef && op != '+' && op != '-') {
+            expr_lin = 0;
+        }
+    }
+    if (expr_undef > 1) {
+        expr_lin = 0;
+    }
+    expr_addend = v;
+    if (FIX_LO == expr_part) {
+        v &= 0xFF;
+    } else if (FIX_HI == expr_part) {
+        v >>= 8;
+    }
+    *val = v;
+
+    return 1;
+}
+
+/*
+ * Record fixup of type for the value of the last expression at the current
+ * position in asm_code. Return 0 if it is not possible.
+ */
+int fix_add(unsigned char type)
+{
+    struct fixup *f;
+
+    if (0 == expr_sym) {
+        asm_error(ERROR_SYMBFULL);
+        return 0;
+    }
+    if (0 == expr_lin) {
+        asm_error(ERROR_FWDREF);
+        return 0;
+    }
+    if (fix_count >= FIX_SIZE) {
+        asm_error(ERROR_FIXFULL);
+        return 0;
+    }
+    f = &fixups[fix_count++];
+    f->sym = expr_sym;
+    f->addend = expr_addend;
+    f->type = type;
+    f->col = asm_len;   // offset in asm_code, column is set by emit_code()
+    f->line = asm_srcline;
+    f->unit = asm_unit;
+    if (FIX_REL == type) {
+        f->addend -= asm_pc + 2;
+    }
+
+    return 1;
+}
+
+/*
+ * Size of code for a forward reference in the last expression was guessed
+ * in the 1-st pass of multi-pass assembly. The guess is recorded in fixup
+ * table and checked by fix_check() at the end of the pass. If it can't be
+ * recorded, another pass is needed.
+ */
+void asm_guess(unsigned char type)
+{
+    struct fixup *f;
+
+    if (0 == expr_sym || 0 == expr_lin || fix_count >= FIX_SIZE) {
+        asm_changed++;
+        return;
+    }
+    f = &fixups[fix_count++];
+    f->sym = expr_sym;
+    f->addend = expr_addend;
+    f->type = type;
+    if (FIX_REL == type) {
+        f->addend -= asm_pc + 2;
+    }
+}
+
+/*
+ * Return # of guesses recorded in the 1-st pass that turned out wrong:
+ * absolute operands (FIX_WORD) below $100 and short branches (FIX_REL)
+ * out of range. Fixup table is emptied.
+ */
+unsigned int fix_check(void)
+{
+    struct fixup *f = fixups;
+    unsigned int i;
+    unsigned int n = 0;
+    uint16_t val;
+
+    for (i = 0; i < fix_count; i++, f++) {
+        if (0 == symb_read(f->sym, &val)) {
+            continue;   // undefined symbol, reported in the last pass
+        }
+        val += f->addend;
+        if (FIX_REL == f->type) {
+            if (val >= 0x80 && val < 0xFF80) {
+                n++;
+            }
+        } else if (val < 0x100) {
+            n++;
+        }
+    }
+    fix_count = 0;
+
+    return n;
+}
+
+/*
+ * Return non-zero if line asm_line is wide: its operand is absolute even
+ * if it is below $100 or its branch is long. Lines only become wide, so
+ * the size of code of each line changes at most twice and the passes
+ * converge. Lines beyond asm_wide are never wide.
+ */
+unsigned char wide_get(void)
+{
+    if (asm_line >= WIDE_SIZE * 8) {
+        return 0;
+    }
+
+    return asm_wide[asm_line >> 3] & (1 << (asm_line & 7));
+}
+
+/*
+ * Make line asm_line wide.
+ */
+void wide_set(void)
+{
+    if (asm_line < WIDE_SIZE * 8) {
+        asm_wide[asm_line >> 3] |= 1 << (asm_line & 7);
+    }
+}
+
+/*
+ * Return non-zero if operand with value val of the last expression, that
+ * is a forward reference, is in zero page. The value comes from the
+ * previous pass. In the 1-st pass it is not known, absolute operand is
+ * guessed. Operand found to be $100 or more makes the line wide, wide line
+ * with operand below $100 sets asm_narrow.
+ */
+unsigned char asm_fwdzp(uint16_t val)
+{
+    if (1 == asm_passes) {
+        return 0;
+    }
+    if (wide_get()) {
+        asm_narrow = (0 == expr_undef && val < 0x100);
+        return 0;
+    }
+    if (1 == asm_pass) {
+        asm_guess(FIX_WORD);
+        return 0;
+    }
+    if (expr_undef) {
+        return 0;
+    }
+    if (val < 0x100) {
+        return 1;
+    }
+    wide_set();
+
+    return 0;
+}
+
+/*
+ * Put value val of the last expression (size 1 or 2 bytes) to asm_code.
+ * Value of expression with undefined symbol is patched at the end of
+ * single pass assembly, in the last pass of multi-pass assembly such
+ * expression is an error.
+ */
+void asm_putval(uint16_t val, unsigned char size)
+{
+    unsigned char type = (2 == size) ? FIX_WORD : FIX_BYTE;
+
+    if (expr_part) {
+        type = expr_part;
+    }
+    if (expr_undef) {
+        if (1 == asm_passes) {
+            fix_add(type);
+        } else {
+            asm_error(ERROR_UNDEFSYMB);
+        }
+    } else if (FIX_BYTE == type && val > 0xFF && val < 0xFF80) {
+        asm_error(ERROR_RANGE);
+    }
+    asm_code[asm_len++] = (unsigned char)val;
+    if (2 == size) {
+        asm_code[asm_len++] = (FIX_WORD == type) ? (unsigned char)(val >> 8)
+                                                 : 0;
+    }
+}
+
+/*
+ * Define symbol name (len characters) with value val in current pass.
+ * fwd is SYMB_FWD if the value depends on a forward reference.
+ */
+void asm_define(const char *name, unsigned char len, uint16_t val,
+                unsigned char fwd)
+{
+    uint16_t sym = symb_find(name, len, 1);
+    uint16_t old;
+    unsigned char flags;
+
+    asm_def = 1;
+    if (0 == sym) {
+        asm_error(ERROR_SYMBFULL);
+        return;
+    }
+    flags = symb_read(sym, &old);
+    if ((flags & SYMB_PASSMASK) == asm_pass) {
+        asm_error(ERROR_DUPSYMB);
+        return;
+    }
+    if (flags && old != val) {
+        // value differs from previous pass, another pass is needed
+        // unless this is the last one
+        asm_error(ERROR_PHASE);
+        asm_changed++;
+    } else if (fwd && asm_pass1 == asm_pass) {
+        asm_changed++;  // value might be wrong, see it in the next pass
+    }
+    symb_write(sym, val, asm_pass | fwd | (flags & SYMB_FWD));
+}
+
+/*
+ * Assemble operand of instruction OpCodes[opcidx] at asm_p to asm_code.
+ * Addressing mode is derived from the operand syntax, zero page mode is
+ * used if the value is below $100 (see asm_fwdzp() for forward references,
+ * they are absolute in single pass mode).
+ */
+void asm_operand(int opcidx)
+{
+    const unsigned char *opc = OpCodes[opcidx].opcode;
+    unsigned char mode, zpmode;
+    unsigned char zp = 0;
+    unsigned char size = 2;
+    uint16_t val = 0;
+
+    if (asm_eol()) {
+        mode = (opc[IMP] || OPCIDX_BRK == opcidx) ? IMP : ACC;
+        size = 0;
+    } else if ('a' == (*asm_p | 0x20) && 1 == ident_len(asm_p)
+               && opc[ACC]) {
+
+        asm_p++;
+        mode = ACC;
+        size = 0;
+    } else if ('#' == *asm_p) {
+        asm_p++;
+        mode = IMM;
+        size = 1;
+    } else if ('(' == *asm_p) {
+        asm_p++;
+        mode = INDABS;
+    } else if (opc[REL]) {
+        mode = REL;
+        size = 1;
+    } else {
+        mode = ABS;
+    }
+    if (size && 0 == expr_eval(&val)) {
+        asm_error(ERROR_SYNTAX);
+        return;
+    }
+    asm_skipspc();
+    if (INDABS == mode) {
+        if (',' == *asm_p) {
+            // (aa,X)
+            asm_p++;
+            asm_skipspc();
+            mode = 0xFF;
+            if ('x' == (*asm_p | 0x20)) {
+                asm_p++;
+                asm_skipspc();
+                if (')' == *asm_p) {
+                    asm_p++;
+                    mode = INXIND;
+                    size = 1;
+                }
+            }
+        } else if (')' == *asm_p) {
+            // (aaaa) or (aa),Y
+            asm_p++;
+            asm_skipspc();
+            if (',' == *asm_p) {
+                asm_p++;
+                asm_skipspc();
+                mode = 0xFF;
+                if ('y' == (*asm_p | 0x20)) {
+                    asm_p++;
+                    mode = INDINY;
+                    size = 1;
+                }
+            }
+        } else {
+            mode = 0xFF;
+        }
+    } else if (ABS == mode && ',' == *asm_p) {
+        asm_p++;
+        asm_skipspc();
+        if ('x' == (*asm_p | 0x20)) {
+            mode = ABSINX;
+            asm_p++;
+        } else if ('y' == (*asm_p | 0x20)) {
+            mode = ABSINY;
+            asm_p++;
+        } else {
+            mode = 0xFF;
+        }
+    }
+    if (0xFF == mode || 0 == asm_eol()) {
+        asm_error(ERROR_SYNTAX);
+        return;
+    }
+    if (ABS == mode || ABSINX == mode || ABSINY == mode) {
+        zpmode = (ABS == mode) ? ZPG : ((ABSINX == mode) ? ZPGINX : ZPGINY);
+        if (opc[zpmode] && opc[mode] && 0 == expr_part && expr_fwd) {
+            zp = asm_fwdzp(val);
+        }
+        if (opc[zpmode]
+            && (expr_part || (0 == expr_fwd && val < 0x100) || zp
+                || 0 == opc[mode])) {
+
+            mode = zpmode;      // zero page or zero page only instruction
+            size = 1;
+        }
+    }
+    if (0 == opc[mode] && (IMP != mode || OPCIDX_BRK != opcidx)) {
+        asm_error(ERROR_BADMODE);
+        return;
+    }
+    asm_mode = mode;
+    asm_val = val;
+    asm_code[asm_len++] = opc[mode];
+    if (REL == mode) {
+        asm_branch(val);
+    } else if (size) {
+        asm_putval(val, size);
+    }
+}
+
+/*
+ * Assemble offset of branch (op-code is in asm_code) to address val.
+ * With option 'b' branch out of range is replaced with inverted branch
+ * over JMP, e.g. BNE far -> BEQ *+5, JMP far. Such line is wide, so the
+ * branch stays long in the following passes. Forward branches are short
+ * in single pass mode.
+ */
+void asm_branch(uint16_t val)
+{
+    uint16_t ofs = val - (asm_pc + 2);
+    unsigned char far = (ofs >= 0x80 && ofs < 0xFF80);
+
+    if (expr_undef) {
+        far = 0;
+        if (1 == asm_passes) {
+            fix_add(FIX_REL);
+        } else {
+            if (1 == asm_pass && (asm_opts & OPT_LONGBR)) {
+                asm_guess(FIX_REL);
+            }
+            asm_error(ERROR_UNDEFSYMB);
+        }
+    } else if (far && 0 == (asm_opts & OPT_LONGBR)) {
+        asm_error(ERROR_BRANCH);
+    } else if (far) {
+        wide_set();
+    } else if (wide_get()) {
+        asm_narrow = 1;
+    }
+    if ((asm_opts & OPT_LONGBR) && (far || wide_get())) {
+        asm_code[0] ^= 0x20;    // inverted condition
+        asm_code[1] = 3;
+        asm_code[2] = 0x4C;     // JMP val
+        asm_code[3] = (unsigned char)val;
+        asm_code[4] = (unsigned char)(val >> 8);
+        asm_len = 5;
+        return;
+    }
+    asm_code[asm_len++] = (unsigned char)ofs;
+}
+
+/*
+ * Forget the previous instruction, the next one can't be optimized with
+ * it (label, directive or error between them).
+ */
+void peep_reset(void)
+{
+    peep_line = PEEP_NONE;
+    peep_nza = 0;
+    peep_end = 0;
+    peep_label = 0;
+    peep_fold = PEEP_NONE;
+}
+
+/*
+ * Return entry of peeps for line or 0. Lines are searched in ascending
+ * order in a pass (from peep_next).
+ */
+struct peep *peep_find(uint16_t line)
+{
+    while (peep_next < peep_count && peeps[peep_next].line < line) {
+        peep_next++;
+    }
+    if (peep_next < peep_count && peeps[peep_next].line == line) {
+        return &peeps[peep_next];
+    }
+
+    return 0;
+}
+
+/*
+ * Add entry to peeps for line (before asm_line), return it or 0 if peeps
+ * is full.
+ */
+struct peep *peep_add(uint16_t line, unsigned char type)
+{
+    unsigned char i = peep_count;
+    struct peep *p;
+
+    if (peep_count >= PEEP_SIZE) {
+        return 0;
+    }
+    while (i > 0 && peeps[i - 1].line > line) {
+        i--;
+    }
+    memmove(&peeps[i + 1], &peeps[i], (peep_count - i) * sizeof(struct peep));
+    if (i <= peep_next) {
+        peep_next++;
+    }
+    peep_count++;
+    p = &peeps[i];
+    p->line = line;
+    p->type = type;
+
+    return p;
+}
+
+/*
+ * Label name (len characters) is defined in the line. N, Z flags are not
+ * known after it, code jumping to the label may have set them. If it is
+ * the target of branch over JMP just before it, the branch is folded in
+ * the next pass (see peep_ins()).
+ */
+void peep_target(const char *name, unsigned char len)
+{
+    struct peep *p;
+
+    peep_label = 1;
+    peep_nza = 0;
+    if (PEEP_NONE != peep_fold && len == peep_namelen
+        && 0 == memcmp(name, peep_name, len) && 0 == asm_emit
+        && (p = peep_add(peep_fold, PEEP_FOLD))) {
+
+        p->sym = peep_foldsym;
+        p->val = peep_foldval;
+        asm_changed++;
+    }
+    peep_fold = PEEP_NONE;
+}
+
+/*
+ * Optimize instruction assembled to asm_code with the previous one
+ * (option 'o' of multi-pass assembly), arg is its operand in asm_buf:
+ *  - LDA x after STA x is removed if N, Z flags already reflect A (the
+ *    instruction before STA set them from A, no label between it and
+ *    LDA), x is not in I/O space,
+ *  - JSR x followed by RTS becomes JMP x, RTS is removed,
+ *  - NOP after JMP, RTS or RTI is removed (not reachable),
+ *  - Bcc L, JMP x, L: becomes Bcc' x (inverted condition) if x is in range.
+ * Line with label (or after label) is never removed, so the labels keep
+ * their meaning and get addresses of the optimized code.
+ * JSR and branch are assembled before it is known what follows them, so
+ * the change is recorded in peeps and applied in the following passes.
+ * The patterns don't depend on values, so they are found in the 1-st pass.
+ * Folded branch found out of range isn't folded again, so the passes
+ * converge. Bytes and cycles saved are counted in the last pass (cycles
+ * of removed instructions that were executed, 3 for JSR -> JMP).
+ */
+void peep_ins(const char *arg)
+{
+    unsigned char opc = asm_code[0];
+    unsigned char len = asm_len;
+    unsigned char label = peep_label;
+    unsigned char folded = peep_folded;
+    unsigned char chg = 0;
+    unsigned char cyc = 0;
+    struct peep *prev = 0;
+    struct peep *p;
+    uint16_t ofs;
+
+    peep_label = 0;
+    peep_fold = PEEP_NONE;
+    peep_folded = 0;
+    if (PEEP_NONE != peep_line) {
+        prev = peep_find(peep_line);
+    }
+    p = peep_find(asm_line);
+    if (p && PEEP_TAIL == p->type) {
+        asm_code[0] = 0x4C;     // JMP
+        chg = 1;
+        cyc = 3;
+    } else if (p && PEEP_FOLD == p->type) {
+        // target of JMP from the previous pass, if it's known
+        peep_foldto = p->val;
+        if (0 == p->sym || symb_read(p->sym, &ofs)) {
+            peep_foldto += p->sym ? ofs : 0;
+            ofs = peep_foldto - (asm_pc + 2);
+            if (2 == asm_len && (ofs < 0x80 || ofs >= 0xFF80)) {
+                asm_code[0] ^= 0x20;    // inverted condition
+                asm_code[1] = (unsigned char)ofs;
+                peep_folded = 1;
+                chg = 1;
+            } else {
+                p->type |= PEEP_BLOCKED;
+                asm_changed++;
+            }
+        }
+    } else if (prev && PEEP_FOLD == prev->type) {
+        // JMP after branch to be folded
+        if (label || 0x4C != opc) {
+            prev->type |= PEEP_BLOCKED;
+            asm_changed++;
+        } else if (folded) {
+            if (0 == prev->sym && prev->val != asm_val) {
+                prev->val = asm_val;    // target moved
+                asm_changed++;
+            }
+            asm_len = 0;
+            cyc = 3;
+        }
+    } else if (PEEP_NONE == peep_line || (label && 0x60 != opc)) {
+        // nothing to optimize
+    } else if (0x4C == opc && 0 == prev && 2 == peep_len && peep_namelen
+               && (OpCycles[peep_opc] & CYC_BRANCH)
+               && (expr_undef ? (expr_sym && expr_lin && 0 == expr_part)
+                   : ((ofs = asm_val - (peep_pc + 2)) < 0x80
+                      || ofs >= 0xFF80))) {
+
+        // branch over JMP if the next label is its target
+        peep_fold = peep_line;
+        peep_foldsym = 0;
+        peep_foldval = asm_val;
+        if (expr_undef) {
+            peep_foldsym = expr_sym;
+            peep_foldval = expr_addend;
+        }
+    } else if (0x60 == opc && 0x20 == peep_opc) {
+        if (0 == prev && 0 == asm_emit) {
+            prev = peep_add(peep_line, PEEP_TAIL);
+        }
+        if (prev && PEEP_TAIL == prev->type && 0 == label) {
+            asm_len = 0;
+            cyc = 6;
+        }
+    } else if (0xEA == opc && peep_end) {
+        asm_len = 0;
+    } else if (0xA1 == (opc & 0xE3) && 0x81 == (peep_opc & 0xE3)
+               && asm_mode == peep_mode && asm_val == peep_val
+               && 0 == expr_undef && 0 == peep_undef && peep_nza
+               && (ZPG == asm_mode || ZPGINX == asm_mode
+                   || (ABS == asm_mode
+                       && (asm_val < PEEP_IOSTART || asm_val > PEEP_IOEND))
+                   || ((ABSINX == asm_mode || ABSINY == asm_mode)
+                       && (asm_val < PEEP_IOSTART - 0xFF
+                           || asm_val > PEEP_IOEND)))) {
+
+        asm_len = 0;
+        cyc = OpCycles[opc] & CYC_MASK;
+    }
+    if (chg || asm_len != len) {
+        asm_peep = 1;
+        if (asm_emit) {
+            peep_lines++;
+            peep_bytes += len - asm_len;
+            peep_cycles += cyc;
+        }
+    }
+    // code after JMP, RTS, RTI (kept or removed) and removed NOP is not
+    // reachable until the next label
+    if (asm_len) {
+        peep_end = (0x4C == asm_code[0] || 0x6C == asm_code[0]
+                    || 0x60 == opc || 0x40 == opc);
+    } else {
+        peep_end = (0x60 == opc || 0xEA == opc);
+    }
+    if ((1 == (opc & 3) && 0x81 != (opc & 0xE3) && 0xC1 != (opc & 0xE3))
+        || memchr(peep_nzaops, opc, sizeof(peep_nzaops))) {
+
+        peep_nza = 1;
+    } else if (0x81 != (opc & 0xE3)     // STA
+               && 0 == memchr(peep_keepops, opc, sizeof(peep_keepops))) {
+        peep_nza = 0;
+    }
+    // operand of branch that is a symbol (kept for peep_target())
+    if (OpCycles[opc] & CYC_BRANCH) {
+        while (' ' == *arg || '\t' == *arg) {
+            arg++;
+        }
+        len = ident_len(arg);
+        asm_p = (char *)arg + len;
+        peep_namelen = 0;
+        if (len <= SYMB_NAMELEN && asm_eol()) {
+            memcpy(peep_name, arg, len);
+            peep_namelen = len;
+        }
+    } else if (PEEP_NONE == peep_fold) {
+        peep_namelen = 0;
+    }
+    peep_line = asm_line;
+    peep_pc = asm_pc;
+    peep_val = asm_val;
+    peep_undef = expr_undef;
+    peep_opc = opc;
+    peep_mode = asm_mode;
+    peep_len = asm_len;
+}
+
+/*
+ * Return non-zero if line s is directive dir (without '.').
+ */
+int mac_isdir(const char *s, const char *dir)
+{
+    unsigned char len = strlen(dir);
+
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+
+    return ('.' == *s && len == ident_len(s + 1)
+            && 0 == strncmp(s + 1, dir, len));
+}
+
+/*
+ * Copy list of items separated by commas at asm_p to out (strings one
+ * after another), return # of items or 0xFF if the list is not valid.
+ * Items are parameters (identifiers) or arguments of macro call (any text,
+ * commas in parentheses or quotes don't separate arguments).
+ */
+unsigned char mac_list(char *out, unsigned char params)
+{
+    unsigned char n = 0;
+    unsigned char len, paren, quote;
+
+    if (asm_eol()) {
+        return 0;
+    }
+    while (1) {
+        asm_skipspc();
+        if (params) {
+            len = ident_len(asm_p);
+            if (0 == len) {
+                return 0xFF;
+            }
+        } else {
+            paren = 0;
+            quote = 0;
+            for (len = 0; asm_p[len]; len++) {
+                if (quote) {
+                    quote = ('"' != asm_p[len]);
+                } else if ('"' == asm_p[len]) {
+                    quote = 1;
+                } else if ('\'' == asm_p[len]) {
+                    len += (0 != asm_p[len + 1]);     // 'c'
+                    len += ('\'' == asm_p[len + 1]);
+                } else if ('(' == asm_p[len]) {
+                    paren++;
+                } else if (')' == asm_p[len] && paren) {
+                    paren--;
+                } else if ((',' == asm_p[len] && 0 == paren)
+                           || ';' == asm_p[len]) {
+                    break;
+                }
+            }
+            while (len && (' ' == asm_p[len - 1] || '\t' == asm_p[len - 1])) {
+                len--;
+            }
+        }
+        memcpy(out, asm_p, len);
+        out[len] = 0;
+        out += len + 1;
+        asm_p += len;
+        n++;
+        asm_skipspc();
+        if (',' != *asm_p) {
+            break;
+        }
+        asm_p++;
+    }
+
+    return asm_eol() ? n : 0xFF;
+}
+
+/*
+ * Define macro: .macro name [param[, param ...]]
+ * Lines up to .endm are the body of macro, they are skipped now and read
+ * again by application for each call (see mac_line()).
+ */
+void mac_define(void)
+{
+    char name[SYMB_NAMELEN + 1];
+    unsigned char len, flags;
+    uint16_t sym, idx;
+
+    if (mac_depth) {
+        asm_error(ERROR_MACRO);     // definition in macro
+        return;
+    }
+    mac_def = 1;
+    asm_skipspc();
+    len = ident_len(asm_p);
+    if (0 == len || (3 == len && 0 <= opc_find(asm_p))) {
+        asm_error(ERROR_MACRO);
+        return;
+    }
+    if (len > SYMB_NAMELEN) {
+        len = SYMB_NAMELEN;
+    }
+    name[0] = '.';
+    memcpy(name + 1, asm_p, len);
+    asm_p += len;
+    // parameters are only checked (no macro is being expanded)
+    if (0xFF == mac_list(mac_frames[0].params, 1)) {
+        asm_error(ERROR_MACRO);
+        return;
+    }
+    sym = symb_find(name, len + 1, 1);
+    if (0 == sym) {
+        asm_error(ERROR_SYMBFULL);
+        return;
+    }
+    flags = symb_read(sym, &idx);
+    if ((flags & SYMB_PASSMASK) == asm_pass) {
+        asm_error(ERROR_DUPSYMB);
+        return;
+    }
+    if (0 == flags) {
+        if (MAC_SIZE == mac_count) {
+            asm_error(ERROR_MACROFULL);
+            return;
+        }
+        idx = mac_count++;
+    }
+    macros[idx].unit = asm_unit;
+    macros[idx].pos = asm_pos;
+    symb_write(sym, idx, asm_pass);
+}
+
+/*
+ * Call macro name (len characters at asm_p) defined earlier in the pass:
+ *  name [arg[, arg ...]]
+ * Arguments are kept for mac_line(), asm_call tells application to read
+ * the macro from unit mac_unit, position mac_pos.
+ */
+void mac_call(unsigned char len)
+{
+    char name[SYMB_NAMELEN + 1];
+    struct mac_frame *m = &mac_frames[mac_depth];
+    uint16_t sym, idx;
+
+    if (len > SYMB_NAMELEN) {
+        len = SYMB_NAMELEN;
+    }
+    name[0] = '.';
+    memcpy(name + 1, asm_p, len);
+    sym = symb_find(name, len + 1, 0);
+    if (0 == sym || (symb_read(sym, &idx) & SYMB_PASSMASK) != asm_pass) {
+        asm_error(ERROR_SYNTAX);
+        return;
+    }
+    if (MAC_DEPTH == mac_depth) {
+        asm_error(ERROR_NESTING);
+        return;
+    }
+    asm_p += ident_len(asm_p);
+    m->nargs = mac_list(m->args, 0);
+    if (0xFF == m->nargs) {
+        asm_error(ERROR_SYNTAX);
+        return;
+    }
+    m->nparams = 0xFF;     // see mac_line()
+    m->num = ++mac_calls;
+    mac_depth++;
+    mac_unit = macros[idx].unit;
+    mac_pos = macros[idx].pos;
+    asm_call = 1;
+}
+
+/*
+ * Prepare line of macro being expanded in buf for asm6502(). The 1-st
+ * line is the .macro line (parameters are taken from it), MAC_SKIP is
+ * returned. Parameters in the other lines are replaced by arguments of the
+ * call, '@' by # of the call (unique labels: loop@) and MAC_LINE is
+ * returned. MAC_END is returned at .endm, application continues after the
+ * call then.
+ */
+unsigned char mac_line(char *buf)
+{
+    struct mac_frame *m = &mac_frames[mac_depth - 1];
+    char out[ASM_LINESIZE];
+    char num[8];
+    const char *p = buf;
+    const char *s;
+    unsigned char n = 0;
+    unsigned char len, skip, i;
+    unsigned char quote = 0;
+
+    if (0xFF == m->nparams) {
+        asm_p = strchr(buf, '.') + 6;
+        asm_skipspc();
+        asm_p += ident_len(asm_p);
+        m->nparams = mac_list(m->params, 1);
+        if (m->nargs > m->nparams) {
+            asm_error(ERROR_MACRO);
+        }
+        return MAC_SKIP;
+    }
+    if (mac_isdir(buf, "endm")) {
+        mac_depth--;
+        return MAC_END;
+    }
+    while (*p) {
+        // len characters at s replace skip characters at p
+        s = p;
+        len = 1;
+        skip = 0;                           // same as len
+        if (quote) {
+            quote = ('"' != *p);
+        } else if ('"' == *p) {
+            quote = 1;
+        } else if ('\'' == *p) {
+            len += (0 != p[1]);             // 'c'
+            len += (len > 1 && '\'' == p[2]);
+        } else if (';' == *p) {
+            len = strlen(p);
+        } else if ('$' == *p || '%' == *p || (*p >= '0' && *p <= '9')) {
+            while (0 <= hex_digit(p[len])) {
+                len++;                      // not a parameter in number
+            }
+        } else if ('@' == *p) {
+            s = utoa(m->num, num, 10);
+            len = strlen(s);
+            skip = 1;
+        } else if (0 < (len = ident_len(p))) {
+            for (i = 0, s = m->params; i < m->nparams; i++) {
+                if (len == strlen(s) && 0 == strncmp(p, s, len)) {
+                    break;
+                }
+                s += strlen(s) + 1;
+            }
+            if (i < m->nparams) {
+                // parameter -> argument, missing argument is empty
+                skip = len;
+                len = 0;
+                if (i < m->nargs) {
+                    for (s = m->args; i > 0; i--) {
+                        s += strlen(s) + 1;
+                    }
+                    len = strlen(s);
+                }
+            } else {
+                s = p;
+            }
+        } else {
+            len = 1;
+        }
+        if (0 == skip) {
+            skip = len;
+        }
+        if (n + len >= ASM_LINESIZE) {
+            asm_error(ERROR_MACRO);         // line too long
+            break;
+        }
+        memcpy(out + n, s, len);
+        n += len;
+        p += skip;
+    }
+    out[n] = 0;
+    strcpy(buf, out);
+
+    return MAC_LINE;
+}
+
+/*
+ * End expansion of the innermost macro before its .endm (application
+ * reached the end of source unit).
+ */
+void mac_exit(void)
+{
+    if (mac_depth) {
+        mac_depth--;
+    }
+}
+
+/*
+ * Assemble directive .org, .byte, .word, .include, .macro or .endm at
+ * asm_p.
+ *  .include expr - assemble source unit expr (RAM bank# in asm6502) here
+ */
+void asm_directive(void)
+{
+    unsigned char len = ident_len(++asm_p);
+    char *dir = asm_p;
+    uint16_t val;
+    unsigned char size = 0;
+
+    asm_p += len;
+    if (3 == len && 0 == strncmp(dir, "org", 3)) {
+        if (0 == expr_eval(&val) || 0 == asm_eol()) {
+            asm_error(ERROR_SYNTAX);
+        } else if (expr_fwd) {
+            asm_error(ERROR_FWDREF);
+        } else {
+            asm_pc = val;
+        }
+        return;
+    }
+    if (7 == len && 0 == strncmp(dir, "include", 7)) {
+        if (0 == expr_eval(&val) || 0 == asm_eol()) {
+            asm_error(ERROR_SYNTAX);
+        } else if (expr_undef) {
+            asm_error(ERROR_FWDREF);
+        } else if (val >= SRC_NONE) {
+            asm_error(ERROR_RANGE);
+        } else {
+            asm_include = (unsigned char)val;
+        }
+        return;
+    }
+    if (5 == len && 0 == strncmp(dir, "macro", 5)) {
+        mac_define();
+        return;
+    }
+    if (4 == len && 0 == strncmp(dir, "byte", 4)) {
+        size = 1;
+    } else if (4 == len && 0 == strncmp(dir, "word", 4)) {
+        size = 2;
+    } else {
+        asm_error(ERROR_SYNTAX);
+        return;
+    }
+    // list of expressions (or strings after .byte) separated by commas
+    do {
+        asm_skipspc();
+        if (1 == size && '"' == *asm_p) {
+            asm_p++;
+            while (*asm_p && '"' != *asm_p) {
+                asm_code[asm_len++] = *asm_p++;
+            }
+            if ('"' != *asm_p++) {
+                asm_error(ERROR_SYNTAX);
+                return;
+            }
+        } else if (expr_eval(&val)) {
+            asm_putval(val, size);
+        } else {
+            asm_error(ERROR_SYNTAX);
+            return;
+        }
+        asm_skipspc();
+    } while (',' == *asm_p++);
+    asm_p--;
+    if (0 == asm_eol()) {
+        asm_error(ERROR_SYNTAX);
+    }
+}
+
+/*
+ * Assemble single line of source code in buf, machine code is put to
+ * asm_code (asm_len bytes) to be emitted at address asm_pc.
+ *
+ * line = [label:] [instruction | directive | macro call] [; comment]
+ *        | name = expr [; comment]
+ * directive = .org expr | .byte item[, item ...] | .word expr[, expr ...]
+ *             | .include expr | .macro name [param[, param ...]] | .endm
+ * item = expr | "string"
+ * macro call = name [arg[, arg ...]]
+ * instruction = mnemonic [operand]
+ * operand = A | #expr | expr | expr,X | expr,Y | (expr) | (expr,X)
+ *           | (expr),Y
+ * See expr_eval() for syntax of expressions.
+ */
+void asm6502(char *buf)
+{
+    unsigned char len;
+    char *name;
+    uint16_t val;
+    int opcidx = -1;
+
+    asm_p = buf;
+    asm_len = 0;
+    fix_line = fix_count;
+    asm_label = 0;
+    asm_ins = 0;
+    asm_peep = 0;
+    asm_fwd = 0;
+    asm_def = 0;
+    asm_narrow = 0;
+    asm_include = SRC_NONE;
+    asm_call = 0;
+    if (mac_def) {
+        // body of macro is assembled when it is called
+        mac_def = (0 == mac_isdir(buf, "endm"));
+        return;
+    }
+    if (asm_eol()) {
+        return;
+    }
+    len = ident_len(asm_p);
+    if (len) {
+        name = asm_p;
+        asm_p += len;
+        if (':' == *asm_p) {
+            // label
+            asm_p++;
+            asm_label = name;
+            asm_labellen = len;
+            asm_define(name, len, asm_pc, 0);
+            peep_target(name, len);
+            if (asm_eol()) {
+                return;
+            }
+            len = ident_len(asm_p);
+        } else {
+            asm_skipspc();
+            if ('=' == *asm_p) {
+                // name = expr
+                asm_p++;
+                if (0 == expr_eval(&val) || 0 == asm_eol()) {
+                    asm_error(ERROR_SYNTAX);
+                } else if (expr_undef && 1 == asm_passes) {
+                    asm_error(ERROR_FWDREF);
+                } else {
+                    if (expr_undef) {
+                        asm_error(ERROR_UNDEFSYMB);
+                    }
+                    asm_define(name, len, val, expr_fwd ? SYMB_FWD : 0);
+                }
+                return;
+            }
+            asm_p = name;
+        }
+    }
+    if ('.' == *asm_p) {
+        asm_directive();
+        peep_reset();
+        return;
+    }
+    if (3 == len) {
+        opcidx = opc_find(asm_p);
+    }
+    if (0 > opcidx) {
+        if (len) {
+            mac_call(len);
+        } else {
+            asm_error(ERROR_SYNTAX);
+        }
+        peep_reset();
+        return;
+    }
+    asm_p += 3;
+    asm_ins = 1;
+    name = asm_p;
+    asm_operand(opcidx);
+    if (0 == asm_len) {
+        peep_reset();   // error
+    } else if (asm_opts & OPT_PEEP) {
+        peep_ins(name);
+    }
+}
+
+/*
+ * Write # of cycles of instruction in asm_code to s (5 characters) and add
+ * it to totals of the block of code. Format:
+ *  n   - n cycles,
+ *  n+  - n, +1 if indexing crosses page boundary,
+ *  n/m - branch not taken / taken, m* - taken branch crosses page boundary,
+ *        m+ - target is not known yet, +1 if it is on another page.
+ * Long branch (see asm_branch()) is shown the same way, cycles of JMP
+ * are included.
+ */
+void list_cycles(char *s)
+{
+    unsigned char c = OpCycles[asm_code[0]];
+    unsigned char min = c & CYC_MASK;
+    unsigned char max = min;
+    unsigned char known = (fix_line == fix_count);  // no fixup in line
+    char mark = ' ';
+    char *p;
+
+    if (c & CYC_BRANCH) {
+        if (5 == asm_len) {
+            // inverted branch to *+5 taken / not taken + JMP
+            min++;
+            if (((asm_pc + 2) ^ (asm_pc + 5)) & 0xFF00) {
+                min++;
+                mark = '*';
+            }
+            max = 5;
+        } else {
+            max++;
+            if (0 == known) {
+                mark = '+';
+            } else if (((asm_pc + 2)
+                        ^ (asm_pc + 2 + (signed char)asm_code[1])) & 0xFF00) {
+                max++;
+                mark = '*';
+            }
+        }
+    } else if ((c & CYC_PAGE) && (0 == known || 3 != asm_len || asm_code[1])) {
+        mark = '+';     // page is not crossed if indexed address is $xx00
+    }
+    utoa(min, s, 10);
+    p = s + strlen(s);
+    if (c & CYC_BRANCH) {
+        *p++ = '/';
+        *p++ = '0' + max;
+    }
+    *p++ = mark;
+    if ('+' == mark) {
+        max++;
+    }
+    while (p < s + 5) {
+        *p++ = ' ';
+    }
+    *p = 0;
+    if (0 == blk_name[0]) {
+        blk_name[0] = '$';
+        hex2str(blk_name + 1, asm_pc, 4);
+        blk_name[5] = 0;
+    }
+    blk_min += min;
+    blk_max += max;
+    blk_n++;
+}
+
+/*
+ * List cycle totals of the block of code listed since the last label.
+ */
+void list_block(void)
+{
+    char num[12];
+
+    if (blk_n) {
+        asm_puts("               ; ");
+        asm_puts(blk_name);
+        asm_puts(": ");
+        asm_puts(utoa(blk_min, num, 10));
+        if (blk_max != blk_min) {
+            asm_puts(" - ");
+            asm_puts(utoa(blk_max, num, 10));
+        }
+        asm_puts(" cycles\n\r");
+    }
+    blk_name[0] = 0;
+    blk_min = 0;
+    blk_max = 0;
+    blk_n = 0;
+}
+
+/*
+ * List assembled line: address, up to 3 bytes of code per line, cycles
+ * (see list_cycles()) and source. Bytes patched at the end of single pass
+ * assembly are shown as '??'. Instruction removed by optimization (see
+ * peep_ins()) is shown with 'del' instead of cycles. Cycle totals of the
+ * block of code before label are listed before the line with the label.
+ */
+void list_line(void)
+{
+    unsigned int f = fix_line;
+    unsigned char i = 0;
+    unsigned char j;
+    char hex[5];
+    char cyc[8];
+
+    if (asm_label) {
+        list_block();
+        j = (asm_labellen > SYMB_NAMELEN) ? SYMB_NAMELEN : asm_labellen;
+        memcpy(blk_name, asm_label, j);
+        blk_name[j] = 0;
+    }
+    strcpy(cyc, "     ");
+    if (asm_ins && asm_len) {
+        list_cycles(cyc);
+    } else if (asm_peep) {
+        strcpy(cyc, "del  ");
+    }
+    do {
+        if (i < asm_len) {
+            hex2str(hex, asm_pc + i, 4);
+            hex[4] = 0;
+            asm_puts(hex);
+        } else {
+            asm_puts("    ");
+        }
+        for (j = 0; j < 3; j++, i++) {
+            while (f < fix_count && fixups[f].col + (FIX_WORD == fixups[f].type)
+                                    < i) {
+                f++;
+            }
+            if (i >= asm_len) {
+                asm_puts("   ");
+            } else if (f < fix_count && fixups[f].col <= i) {
+                asm_puts(" ??");
+            } else {
+                hex[0] = ' ';
+                hex2str(hex + 1, asm_code[i], 2);
+                hex[3] = 0;
+                asm_puts(hex);
+            }
+        }
+        if (3 == i) {
+            asm_puts(" ");
+            asm_puts(cyc);
+            asm_puts(" ");
+            asm_puts(asm_buf);
+        }
+        asm_puts("\n\r");
+    } while (i < asm_len);
+}
@@ -0,0 +1,233 @@
+/*
+ * File:	asm6502core.h
+ * Purpose:	Core of MOS 6502 assembler - parsing of source code lines and
+ *          encoding of instructions, shared by asm6502 (runs on MKHBC-8-Rx)
+ *          and xasm6502 (runs on host computer).
+ * Author:	Marek Karcz
+ * Created:	10/18/2026
+ *
+ * Revision history:
+ *
+ * 10/18/2026
+ *  Created. Split from asm6502.c, the core doesn't access memory banks,
+ *  text buffers or console directly. Application implements the symbol
+ *  table (symb_find(), symb_read(), symb_write()), output of text
+ *  (asm_puts()) and output of machine code in asm_code.
+ *
+ * 10/18/2026
+ *  Peephole optimization (OPT_PEEP) in multi-pass assembly, see peep_ins().
+ *
+ * 10/18/2026
+ *  Directives .include, .macro and .endm, macro calls. Application reads
+ *  lines of other source units (.include) and of macro definitions again
+ *  (see mac_line()) instead of copying them to the source code.
+ *
+ *  ..........................................................................
+ *  Application assembles the source code this way:
+ *
+ *      asm_start(passes, opts);
+ *      do {
+ *          asm_begin();
+ *          for each line of source code {
+ *              copy line to asm_buf;
+ *              asm6502(asm_buf);
+ *              if (asm_emit) {
+ *                  list_line() if listing is wanted,
+ *                  emit asm_len bytes of asm_code at address asm_pc and
+ *                  set loc of fixups fix_line .. fix_count-1 (their col
+ *                  is an offset in asm_code);
+ *              }
+ *              asm_next();
+ *          }
+ *      } while (0 == asm_end());
+ *      patch fixups 0 .. fix_count-1 (single pass assembly).
+ *
+ *  Lines may come from several source units (e.g.: RAM banks), application
+ *  sets asm_unit, asm_pos and asm_srcline before each line (asm_main is
+ *  the unit of the main source code). Line with .include sets asm_include,
+ *  application then assembles lines of that unit and continues after the
+ *  .include line. Macro call sets asm_call, application then reads lines
+ *  from unit mac_unit, position mac_pos (the .macro line) and passes each
+ *  of them to mac_line() before asm6502(), up to the line mac_line()
+ *  returns MAC_END for.
+ *
+ *  Multi-pass assembly may be resumed with asm_resume() instead of
+ *  asm_start() when the symbol table holds values of a previous assembly.
+ *  Application then passes only some lines to asm6502() (it sets asm_line
+ *  and asm_pc of each of them), the passes start at the given pass# and
+ *  symbols of lines it doesn't pass must be read as defined in the current
+ *  pass (see asm6502.c).
+ *  ..........................................................................
+ */
+#ifndef ASM6502CORE_H
+#define ASM6502CORE_H
+
+#define ASM_LINESIZE    80      // max. length of source code line + 1
+#define ASM_ORG         0x0B00  // default code start address
+#define ASM_MAXPASS     16      // max. # of passes
+#define ASM_MAXLINES    4096    // lines in 16 kB bank (4 bytes per line min.)
+#define FIX_SIZE        224     // max. # of fixups (forward references)
+#define WIDE_SIZE       (ASM_MAXLINES/8)    // bytes of wide line flags
+#define PEEP_SIZE       64      // max. # of optimized JSRs and branches
+#define MAC_SIZE        32      // max. # of macros
+#define MAC_DEPTH       4       // max. # of nested macro calls
+#define MAC_END         0       // mac_line(): end of macro (.endm),
+#define MAC_LINE        1       //  line to assemble,
+#define MAC_SKIP        2       //  line not assembled (.macro)
+#define SRC_NONE        0xFF    // asm_include: no source unit
+#define OPCIDX_BRK      55      // index of BRK in OpCodes (op-code 0)
+#define OPT_BIN         0x01    // options of 'a': machine code output
+#define OPT_LIST        0x02    //                 listing
+#define OPT_LONGBR      0x04    //                 long branches
+#define OPT_INC         0x08    //                 incremental (asm6502)
+#define OPT_PEEP        0x10    //                 peephole optimization
+#define SYMB_PASSMASK   0x7F    // flags: # of pass that defined symbol,
+                                // 0 - undefined
+#define SYMB_FWD        0x80    // flags: value depends on forward reference
+#define SYMB_NAMELEN    32      // max. length of symbol name
+#define CYC_MASK        0x0F    // OpCycles: # of cycles,
+#define CYC_PAGE        0x10    //  +1 if indexing crosses page boundary,
+#define CYC_BRANCH      0x20    //  branch: +1 if taken, +1 more if taken
+                                //  to another page
+
+// error codes
+enum eErrors {
+    ERROR_OK = 0,
+    ERROR_BADCMD,
+    ERROR_BADARG,
+    ERROR_NOTEXT,
+    ERROR_BUFNOTINIT,
+    ERROR_ADDROOR,
+    ERROR_TIMEOUT,
+    ERROR_FULLBUF,
+    ERROR_BADBANK,
+    ERROR_BANKSEQUAL,
+    ERROR_SYMBFULL,
+    ERROR_OLDFMT,
+    ERROR_SYMBBANK,
+    ERROR_SYNTAX,
+    ERROR_BADMODE,
+    ERROR_UNDEFSYMB,
+    ERROR_DUPSYMB,
+    ERROR_RANGE,
+    ERROR_BRANCH,
+    ERROR_FWDREF,
+    ERROR_FIXFULL,
+    ERROR_PHASE,
+    ERROR_NESTING,
+    ERROR_MACRO,
+    ERROR_MACROFULL,
+    ERROR_OVLBANK,
+    ERROR_NOOVL,
+    //------------------
+    ERROR_UNKNOWN
+};
+
+enum eAddrModes {
+    IMM = 0,    // #aa
+    ABS,        // aaaa
+    ZPG,        // aa
+    IMP,
+    INDABS,     // (aaaa)
+    ABSINX,     // aaaa,X
+    ABSINY,     // aaaa,Y
+    ZPGINX,     // aa,X
+    ZPGINY,     // aa,Y
+    INXIND,     // (aa,X)
+    INDINY,     // (aa),Y
+    REL,        // aaaa
+    ACC         // Acc
+};
+
+// Types of fixups (values patched at the end of single pass assembly).
+enum eFixTypes {
+    FIX_BYTE = 0,   // aa
+    FIX_LO,         // <aaaa
+    FIX_HI,         // >aaaa
+    FIX_WORD,       // aaaa
+    FIX_REL         // branch offset
+};
+
+// Fixup: value of symbol sym + addend is written to the output at column
+// col of text record at address loc (machine code output: to address loc
+// in output bank, xasm6502: to offset loc of the image). Line and unit of
+// the source code are kept for errors found when the fixup is resolved.
+struct fixup {
+    uint16_t sym;
+    uint16_t addend;
+    uint16_t loc;
+    uint16_t line;
+    unsigned char col;
+    unsigned char type;
+    unsigned char unit;
+};
+
+struct instr {
+    char mnem[4];   // assembly mnemonic of the instruction
+    unsigned char opcode[14];   // op-codes for each addressing mode
+};
+
+extern const char *ga_errmsg[];
+extern const struct instr OpCodes[];
+extern const unsigned char OpCycles[];
+extern struct fixup fixups[];
+
+extern char asm_buf[];                  // line of source code
+extern unsigned char asm_code[];        // machine code of the line
+extern unsigned char asm_len;           // # of bytes in asm_code
+extern uint16_t asm_pc;                 // address of the code
+extern unsigned char asm_pass;          // # of current pass (1, 2, ...)
+extern unsigned char asm_pass1;         // # of the 1-st pass
+extern unsigned char asm_passes;        // max. # of passes
+extern unsigned char asm_emit;          // non-zero in the last pass
+extern unsigned char asm_opts;          // OPT_BIN, OPT_LIST, OPT_LONGBR, ...
+extern unsigned char asm_fwd;           // line uses forward reference
+extern unsigned char asm_def;           // line defines symbol
+extern unsigned char asm_narrow;        // wide line, zero page operand
+extern unsigned char asm_peep;          // line changed by optimization
+extern unsigned int peep_lines;         // # of optimized lines,
+extern unsigned int peep_bytes;         // bytes and cycles saved
+extern unsigned int peep_cycles;        // (counted in the last pass)
+extern unsigned int asm_line, asm_errors, asm_bytes;
+extern unsigned int fix_count;          // # of fixups
+extern unsigned int fix_line;           // index of 1-st fixup of the line
+extern unsigned char asm_unit;          // source unit of the line,
+extern uint16_t asm_pos;                //  its position in the unit
+extern unsigned int asm_srcline;        //  and line # (set by application)
+extern unsigned char asm_main;          // source unit of main source code
+extern unsigned char asm_include;       // .include: unit or SRC_NONE
+extern unsigned char asm_call;          // non-zero if macro was called,
+extern unsigned char mac_unit;          //  unit and position of its
+extern uint16_t mac_pos;                //  .macro line
+extern unsigned char mac_count;         // # of defined macros
+
+// core
+void        asm_start(unsigned char passes, unsigned char opts);
+void        asm_resume(unsigned char pass, unsigned char opts);
+void        asm_begin(void);
+void        asm_next(void);
+int         asm_end(void);
+void        asm6502(char *buf);
+void        asm_error(int errnum);
+void        list_line(void);
+void        list_block(void);
+unsigned char mac_line(char *buf);
+void        mac_exit(void);
+unsigned char wide_get(void);
+void        wide_set(void);
+int         opc_find(const char *s);
+void        hex2str(char *s, uint16_t val, unsigned char digits);
+unsigned char ident_len(const char *s);
+int         hex_digit(char c);
+
+// implemented by application
+uint16_t    symb_find(const char *name, unsigned char len, unsigned char add);
+unsigned char symb_read(uint16_t sym, uint16_t *val);
+void        symb_write(uint16_t sym, uint16_t val, unsigned char flags);
+void        asm_puts(const char *s);
+
+#ifndef __CC65__
+char        *utoa(unsigned val, char *buf, int radix);
+#endif
+
+#endif
@@ -12,6 +12,9 @@
  * 2/25/2018
  *  Refactoring due to ROM library introduction.
  *
+ * 10/18/2026
+ *  clock_version() uses mos_printf(), string buffers removed.
+ *
  *  ..........................................................................
  *
  *  BUGS:
@@ -28,9 +31,6 @@
 #include "mkhbcos_ml.h"
 #include "romlib.h"
 
-#define IBUF1_SIZE      30
-#define IBUF2_SIZE      30
-#define IBUF3_SIZE      30
 #define RADIX_DEC       10
 #define RADIX_HEX       16
 #define RADIX_BIN       2
@@ -39,8 +39,6 @@ const int ver_major = 1;
 const int ver_minor = 1;
 const int ver_build = 1;
 
-char ibuf1[IBUF1_SIZE], ibuf2[IBUF2_SIZE], ibuf3[IBUF3_SIZE];
-
 void clock_version(void);
 void clock_show(void);
 void clock_banner(void);
@@ -48,13 +46,7 @@ void pause_sec64(uint16_t delay);
 
 void clock_version(void)
 {
-    itoa(ver_major, ibuf1, RADIX_DEC);
-    strcat(ibuf1, ".");
-    strcat(ibuf1, itoa(ver_minor, ibuf3, RADIX_DEC));
-    strcat(ibuf1, ".");
-    strcat(ibuf1, itoa(ver_build, ibuf3, RADIX_DEC));
-    strcat(ibuf1, ".\n\r");
-    puts(ibuf1);
+    mos_printf("%d.%d.%d.\n\r", ver_major, ver_minor, ver_build);
 }
 
 /*
@@ -29,6 +29,14 @@
  * 2/25/2018
  *  Refactoring related to ROM library introduction.
  *
+ * 10/18/2026
+ *  enhmon_rnv() prints numbers with puthex0() / putudec() (ROM number
+ *  formatting kernel) instead of itoa() / puts() / strlen() padding.
+ *
+ * 10/18/2026
+ *  enhmon_version() and enhmon_ctr() print with mos_printf() (formatted
+ *  output in ROM) instead of building the line with strcpy() / strcat().
+ *
  *  ..........................................................................
  *
  *  BUGS:
@@ -370,13 +378,7 @@ void enhmon_setdt(void)
 
 void enhmon_version(void)
 {
-    strcpy(ibuf1, itoa(ver_major, ibuf3, RADIX_DEC));
-    strcat(ibuf1, ".");
-    strcat(ibuf1, itoa(ver_minor, ibuf3, RADIX_DEC));
-    strcat(ibuf1, ".");
-    strcat(ibuf1, itoa(ver_build, ibuf3, RADIX_DEC));
-    strcat(ibuf1, ".\n\r");
-    puts(ibuf1);
+    mos_printf("%d.%d.%d.\n\r", ver_major, ver_minor, ver_build);
 }
 
 /*
@@ -460,7 +462,7 @@ int hex2int(const char *hexstr)
  */
 void enhmon_rnv(void)
 {
-    int i, len;
+    int len;
     unsigned char b     = 0x00;
     unsigned char bank  = 0;
     unsigned char offs  = 0;
@@ -490,22 +492,15 @@ void enhmon_rnv(void)
         adv2nextspc(offs2);
         ramaddr = hex2int(prompt_buf+offs2);
         puts("RAM copy address: ");
-        puts(itoa(ramaddr, ibuf3, RADIX_HEX));
+        puthex(ramaddr);
         puts("\n\r");
     }
     puts("RTC NV Bank #: ");
-    puts(itoa(bank, ibuf3, RADIX_DEC));
+    putudec(bank);
     puts("\n\r");
     for ( ; addr<0x0080; addr+=16)
     {
-        itoa(addr,ibuf1,RADIX_HEX);
-        if (strlen(ibuf1) < 2)
-        {
-            for (i=2-strlen(ibuf1); i>0; i--) {
-                putchar('0');
-            }
-        }
-        puts(ibuf1);
+        puthex0(2, addr);
         puts(" : ");
         for (offs=0; offs<16 && (addr+offs)<0x0080; offs++)
         {
@@ -513,8 +508,7 @@ void enhmon_rnv(void)
             if (optarg) {
                 POKE(ramaddr++, b);
             }
-            if (b < 16) putchar('0');
-            puts(itoa(b,ibuf3,RADIX_HEX));
+            puthex0(2, b);
             putchar(' ');
         }
         puts(" : ");
@@ -815,14 +809,10 @@ void enhmon_ctr(void)
 {
     unsigned long tmr64 = *TIMER64HZ;
 
-    //tmr64 = *TIMER64HZ;
-    strcpy(ibuf1, ultoa(tmr64, ibuf3, RADIX_DEC));
-    strcat(ibuf1, " $");
-    strcat(ibuf1, ultoa(tmr64, ibuf3, RADIX_HEX));
-    strcat(ibuf1, " %");
-    strcat(ibuf1, ultoa(tmr64, ibuf3, RADIX_BIN));
-    strcat(ibuf1, "\n\r");
-    puts(ibuf1);
+    // FmtOut takes 16-bit arguments only, 32-bit value is converted with
+    // ultoa() and the line is put together by mos_printf()
+    mos_printf("%s $%s %%%s\n\r", ultoa(tmr64, ibuf1, RADIX_DEC),
+               ultoa(tmr64, ibuf2, RADIX_HEX), ultoa(tmr64, ibuf3, RADIX_BIN));
 }
 
 int main(void)
@@ -14,6 +14,12 @@
  * GVIM
  * set tabstop=4 shiftwidth=4 expandtab
  *
+ * Revision history:
+ *
+ * 10/18/2026
+ *    Added test_speed_fmt() - compares strcat() / itoa() chain with
+ *    mos_sprintf() building the same output.
+ *
  */
 
 #include <stdlib.h>
@@ -22,11 +28,13 @@
 #include "mkhbcos_lcd.h"
 #include "mkhbcos_serialio.h"
 #include "mkhbcos_ansi.h"
+#include "mkhbcos_ml.h"
 
 char hello[] = "Hello World!\n\r";
 char buf[256];
 char b2[20];
 char s1[20]; //,s2[20],s3[20];
+char fmtbuf[40];
 uint16_t n = UINT16_MAX;
 
 void my_puts (char *s)
@@ -57,6 +65,46 @@ void test_speed_lcd(uint16_t n)
 	puts("                                \r\n");
 }
 
+/*
+ * Build the same line n times with strcpy() / strcat() / itoa() chain
+ * and with mos_sprintf(), show time taken by each method in 1/64 s
+ * (MOS timer, RTC required).
+ */
+void test_speed_fmt(uint16_t n)
+{
+	uint16_t i;
+	unsigned long t1, t2;
+	unsigned char h = 9, m = 5, sec = 42;
+
+	t1 = *TIMER64HZ;
+	for (i=0; i<n; i++)
+	{
+		strcpy(buf, "Time: ");
+		if (h < 10) strcat(buf, "0");
+		strcat(buf, itoa(h,s1,10));
+		strcat(buf, " : ");
+		if (m < 10) strcat(buf, "0");
+		strcat(buf, itoa(m,s1,10));
+		strcat(buf, " : ");
+		if (sec < 10) strcat(buf, "0");
+		strcat(buf, itoa(sec,s1,10));
+		strcat(buf, "\r\n");
+	}
+	t1 = *TIMER64HZ - t1;
+	t2 = *TIMER64HZ;
+	for (i=0; i<n; i++)
+	{
+		mos_sprintf(fmtbuf, "Time: %02d : %02d : %02d\r\n", h, m, sec);
+	}
+	t2 = *TIMER64HZ - t2;
+	puts(buf);
+	puts(fmtbuf);
+	mos_printf("strcat/itoa: %u/64 s, mos_sprintf: %u/64 s, %u iterations.\r\n",
+	           (unsigned)t1, (unsigned)t2, n);
+	if (strcmp(buf, fmtbuf))
+		puts("Outputs differ!\r\n");
+}
+
 void my_delay(int n)
 {
 	int i,j;
@@ -136,6 +184,7 @@ int main (void)
 	ansi_boldon();
 	lcd_cursorctrl(0,0);	// turn off cursor on LCD
 	test_speed_lcd(iter);
+	test_speed_fmt(iter);
 	puts("Demo finished.");
 	putchar('\n');
 	putchar('\r');
@@ -19,7 +19,7 @@ echo Building application "clock" ...
 rem
 rem build clock app.
 rem
-cl65 -t none --cpu 6502 -I ..\system --config mkhbcoslib.cfg -l -m clock.map clock.c mkhbcos.lib
+cl65 -t none --cpu 6502 -I ..\system --config mkhbcoslib.cfg -l -m clock.map clock.c mkhbcosrt.lib mkhbcos.lib
 rem
 
 echo Generating terminal program loading script "clock_prg.txt" ...
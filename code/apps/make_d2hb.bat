@@ -19,7 +19,7 @@ echo Building application "d2hb" ...
 rem
 rem build d2hb app.
 rem
-cl65 -t none --cpu 6502 -I ..\system --config mkhbcoslib.cfg -l -o d2hb -m d2hb.map d2hexbin.c mkhbcos.lib
+cl65 -t none --cpu 6502 -I ..\system --config mkhbcoslib.cfg -l -o d2hb -m d2hb.map d2hexbin.c mkhbcosrt.lib mkhbcos.lib
 rem
 
 echo Generating terminal program loading script "d2hb_prg.txt" ...
@@ -19,7 +19,7 @@ echo Building application "enhmon" ...
 rem
 rem build enhmon app.
 rem
-cl65 -t none --cpu 6502 -I ..\system --config mkhbcoslib.cfg -l -m enhmon.map enhmon.c mkhbcos.lib
+cl65 -t none --cpu 6502 -I ..\system --config mkhbcoslib.cfg -l -m enhmon.map enhmon.c mkhbcosrt.lib mkhbcos.lib
 rem
 
 echo Generating terminal program loading script "enhmon_prg.txt" ...
@@ -42,6 +42,13 @@ rem 2/18/2018
 rem
 rem     Added deleting generated assembly files after compilation.
 rem
+rem 10/18/2026
+rem
+rem     Added mkhbcos_romlib.s (ROM library fast call gate wrappers).
+rem     Added library mkhbcosrt.lib (mkhbcos_romrt.s - stubs of C runtime
+rem     routines resident in ROM library). Applications link it before
+rem     mkhbcos.lib.
+rem
 
 echo Building library "mkhbcos.lib" ...
 rem
@@ -51,6 +58,7 @@ rem
 echo      Delete objects ...
 rem del crt0.o mkhbcos_serialio.o mkhbcos_lcd.o mkhbcos_ds1685.o
 del mkhbcos_init.o mkhbcos_serialio.o mkhbcos_lcd.o mkhbcos_ds1685.o
+del mkhbcos_romlib.o
 echo      Assemble/compile source code ...
 cc65 -t none --cpu 6502 -I ..\system ..\system\mkhbcos_lcd1602.c -o mkhbcos_lcd1602.s
 cc65 -t none --cpu 6502 -I ..\system ..\system\mkhbcos_ansi.c -o mkhbcos_ansi.s
@@ -64,16 +72,22 @@ ca65 -I ..\system ..\system\mkhbcos_serialio.s -o mkhbcos_serialio.o
 ca65 -I ..\system ..\system\mkhbcos_lcd.s -o mkhbcos_lcd.o
 ca65 -I ..\system ..\system\mkhbcos_ds1685.s -l -o mkhbcos_ds1685.o
 move /Y ..\system\mkhbcos_ds1685.lst .
+ca65 -I ..\system ..\system\mkhbcos_romlib.s -o mkhbcos_romlib.o
 echo      Update library ...
 rem ar65 a mkhbcos.lib crt0.o mkhbcos_serialio.o mkhbcos_lcd.o mkhbcos_lcd1602.o mkhbcos_ansi.o mkhbcos_ds1685.o
-ar65 a mkhbcos.lib mkhbcos_init.o mkhbcos_serialio.o mkhbcos_lcd.o mkhbcos_lcd1602.o mkhbcos_ansi.o mkhbcos_ds1685.o
+ar65 a mkhbcos.lib mkhbcos_init.o mkhbcos_serialio.o mkhbcos_lcd.o mkhbcos_lcd1602.o mkhbcos_ansi.o mkhbcos_ds1685.o mkhbcos_romlib.o
+
+echo Building library "mkhbcosrt.lib" ...
+del mkhbcos_romrt.o
+ca65 -I ..\system ..\system\mkhbcos_romrt.s -o mkhbcos_romrt.o
+ar65 a mkhbcosrt.lib mkhbcos_romrt.o
 
 
 echo Building application "hello" ...
 rem
 rem build hello app.
 rem
-cl65 -t none --cpu 6502 -I ..\system --config mkhbcoslib.cfg -l -m hello.map hello.c mkhbcos.lib
+cl65 -t none --cpu 6502 -I ..\system --config mkhbcoslib.cfg -l -m hello.map hello.c mkhbcosrt.lib mkhbcos.lib
 rem
 
 rem OBSOLETE section, to be removed
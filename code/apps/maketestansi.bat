@@ -15,7 +15,7 @@ echo Building application "testansi" ...
 rem
 rem build testansi app.
 rem
-cl65 -t none --cpu 6502 --config mkhbcoslib.cfg -l -m testansi.map testansi.c mkhbcos.lib
+cl65 -t none --cpu 6502 --config mkhbcoslib.cfg -l -m testansi.map testansi.c mkhbcosrt.lib mkhbcos.lib
 rem
 
 echo Generating terminal program loading script "testansi_prg.txt" ...
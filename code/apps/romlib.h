@@ -3,6 +3,12 @@
  * Purpose:	Declarations and definitions for MKHBCOS API located in romlib.
  * Author:	Marek Karcz
  * Created:	2/25/2018
+ *
+ * Revision history:
+ *
+ * 10/18/2026
+ *  Added ROM library fast call gate (register based ABI).
+ *  Added jump table entries of C runtime routines resident in ROM.
  */
 #ifndef ROMLIB_H
 #define ROMLIB_H
@@ -46,4 +52,49 @@ extern uint16_t _BRAM_START__, _BRAM_SIZE__;
  */
 void (*romlibfunc)(void) = (void *)ROMLIBFUNC;
 
+/*
+ * ROM library fast call gate.
+ * Jump table of direct entry points at fixed ROM addresses. Arguments are
+ * passed in registers (A, X, Y) and zero page registers ROMLIBARG1..3.
+ * The C runtime of ROM library is not re-initialized, therefore these calls
+ * are much faster than calling the library via single entry point.
+ * Use C wrappers below (implemented in mkhbcos.lib) or call the entry
+ * points directly from assembly code (see mkhbcos_ml.inc).
+ */
+#define ROMLIBARG1          ((uint16_t *)0x00D2)
+#define ROMLIBARG2          ((uint16_t *)0x00D4)
+#define ROMLIBARG3          ((uint16_t *)0x00D6)
+
+#define ROMLIBJT_LIBCALL    0xFF77  // A - func. code, X/Y - args pointer
+#define ROMLIBJT_PUTS       0xFF7A  // A/X - string
+#define ROMLIBJT_MEMCPY     0xFF7D  // ARG1 - dst, ARG2 - src, A/X - size
+#define ROMLIBJT_MEMINIT    0xFF80  // ARG1 - dst, A/X - size, Y - value
+
+/*
+ * C runtime routines resident in ROM. ARG1 - pointer to arguments on
+ * caller's C stack, Y - size of these arguments, A/X - last argument.
+ * Applications don't call these directly, strcpy() etc. are redirected
+ * here by stubs in mkhbcosrt.lib.
+ */
+#define ROMLIBJT_STRCPY     0xFF83
+#define ROMLIBJT_STRCAT     0xFF86
+#define ROMLIBJT_ITOA       0xFF89
+#define ROMLIBJT_UTOA       0xFF8C
+#define ROMLIBJT_MEMSET     0xFF8F
+#define ROMLIBJT_ATOI       0xFF92
+#define ROMLIBJT_ATOL       0xFF95  // high word of result in ARG2
+
+/*
+ * Usage example:
+ *    romlib_memcpy((void *)0x8000, (void *)0x0B00, 0x1000);
+ * is equivalent of:
+ *    EXCHRAM[0] = ROMLIBFUNC_MEMCPY;
+ *    (set up arguments and ARGPTR)
+ *    (*romlibfunc)();
+ */
+void  __fastcall__ romlib_call(unsigned char func_code, void *args);
+void  __fastcall__ romlib_puts(const char *s);
+void* __fastcall__ romlib_memcpy(void *dst, const void *src, size_t n);
+void* __fastcall__ romlib_meminit(void *dst, unsigned char val, size_t n);
+
 #endif
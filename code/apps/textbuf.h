@@ -0,0 +1,89 @@
+/*
+ * File:	textbuf.h
+ * Purpose:	Text buffer format shared by texted and asm6502.
+ * Author:	Marek Karcz
+ * Created:	10/18/2026
+ *
+ * Revision history:
+ *
+ * 10/18/2026
+ *  Created. Format version 2 - buffer header, records without line numbers.
+ *  Tail address, line count, free space and gap address cached in header.
+ *  Links to previous / next RAM bank of a document spanning several banks.
+ *
+ *  ..........................................................................
+ *  Text buffer occupies one 16 kB bank of banked RAM:
+ *
+ *  START_BRAM: buffer header (TBHDR_SIZE bytes)
+ *      +0  'T', 'B' - magic
+ *      +2  format version (TB_VERSION)
+ *      +3  address of null header (tail)
+ *      +5  # of text lines
+ *      +7  # of free bytes
+ *      +9  address of gap record, 0 - no gap
+ *      +11 RAM bank# + 1 of the next part of document, 0 - last part
+ *      +12 RAM bank# + 1 of the previous part of document, 0 - 1-st part
+ *      +13 reserved (0) up to TBHDR_SIZE
+ *  Fields +3 .. +10 are a cache maintained by applications modifying text,
+ *  so appending text doesn't have to walk the whole chain. The cache is
+ *  only trusted after it was validated against the buffer, zero tail means
+ *  the cache is not valid.
+ *  START_TEXT: text records, chained by next pointers:
+ *      +0  length of text
+ *      +1  address of next record (16-bit)
+ *      +3  text, null terminated
+ *  Line numbers are not stored, line# of a record is its position in
+ *  the chain. The chain ends with null header ($FF $FF $FF $00).
+ *  Text editor may leave a gap in the chain, starting with gap record:
+ *      +0  TBGAP_MARK
+ *      +1  address of 1-st text record after the gap (not $FFFF)
+ *      +3  0
+ *
+ *  Document (file) may span several RAM banks. Each bank holds a complete
+ *  text buffer (part of document) with its own header and null header,
+ *  the text of the document is the text of its parts in the order of links.
+ *
+ *  Format version 1 (no buffer header, records at START_BRAM with line#
+ *  in 1-st 2 bytes, length at +2, next pointer at +3 and text at +5) is
+ *  converted by texted when loaded.
+ *  ..........................................................................
+ */
+#ifndef TEXTBUF_H
+#define TEXTBUF_H
+
+#define TB_MAGIC1       'T'
+#define TB_MAGIC2       'B'
+#define TB_VERSION      2
+#define TBHDR_SIZE      16
+#define START_TEXT      (START_BRAM + TBHDR_SIZE)
+
+#define TBHDR_TAIL      3       // offsets of cached values in buffer header
+#define TBHDR_LINES     5
+#define TBHDR_FREE      7
+#define TBHDR_GAP       9
+#define TBHDR_NXTBANK   11
+#define TBHDR_PRVBANK   12
+
+// buffer header cache access
+#define TBHDR_GETW(ofs)         PEEKW(START_BRAM + (ofs))
+#define TBHDR_PUTW(ofs, val)    POKEW(START_BRAM + (ofs), (val))
+#define TBHDR_GETB(ofs)         PEEK(START_BRAM + (ofs))
+#define TBHDR_PUTB(ofs, val)    POKE(START_BRAM + (ofs), (val))
+
+#define TBREC_LEN       0       // offsets in text record
+#define TBREC_NEXT      1
+#define TBREC_TEXT      3
+#define TBREC_SIZE      4       // record size without text
+#define TBGAP_MARK      0xFF    // length of gap record (and null header)
+
+// text record access
+#define TBREC_GETLEN(addr)  PEEK((addr) + TBREC_LEN)
+#define TBREC_GETNXT(addr)  PEEKW((addr) + TBREC_NEXT)
+#define TBREC_TXTPTR(addr)  ((char *)((addr) + TBREC_TEXT))
+
+// non-zero if the text buffer in current bank has current format header
+#define TB_HDROK    (PEEK(START_BRAM) == TB_MAGIC1 \
+                     && PEEK(START_BRAM + 1) == TB_MAGIC2 \
+                     && PEEK(START_BRAM + 2) == TB_VERSION)
+
+#endif
@@ -71,19 +71,105 @@
  *  Added checking the consistency of RAM bank setup - this detects memory
  *  management malfunctions.
  *
+ * 10/18/2026
+ *  Date / time line is built with mos_sprintf() (formatted output in ROM)
+ *  in one pass instead of strcpy() / strcat() / itoa() chain.
+ *
+ * 10/18/2026
+ *  Added line index - sparse table of text record addresses (anchor every
+ *  LIDX_STEP lines) kept in upper RAM (XBSS). goto_line(), listing and
+ *  copying to clipboard start from the nearest anchor instead of walking
+ *  the whole text buffer. Index is updated incrementally by add, insert,
+ *  delete and cut operations and rebuilt lazily when invalidated.
+ *
+ * 10/18/2026
+ *  Text buffer is now a gap buffer. Free space is kept as a gap at the last
+ *  edit position, text after the gap is packed at the end of the bank.
+ *  The gap is marked with a gap record (len = GAP_MARK, next pointer to the
+ *  1-st record after the gap, line# field holds the line# offset of records
+ *  after the gap, which are renumbered lazily). Inserting and deleting only
+ *  moves the text between the old and new gap position instead of all the
+ *  text below. Text records are walked with tb_first() / tb_next().
+ *  The gap is closed when leaving the editor or switching RAM bank.
+ *
+ * 10/18/2026
+ *  Text buffer format version 2 (see textbuf.h): buffer header, records
+ *  without line numbers. Line# of a record is derived from its position,
+ *  line numbers are looked up via line index. Nothing has to be renumbered
+ *  after insert / delete. Buffers in old format are converted in checkbuf().
+ *
+ * 10/18/2026
+ *  Tail address, line count, free space and gap address are cached in text
+ *  buffer header. Once the buffer was checked, checkbuf() validates and uses
+ *  the cached values instead of walking the whole text, so adding text
+ *  no longer takes time proportional to the size of the text.
+ *
+ * 10/18/2026
+ *  Documents spanning several RAM banks. Text buffers in linked banks are
+ *  parts of one document (see textbuf.h), command 'k' links a new bank to
+ *  the end of the document. Text records are walked across parts with
+ *  doc_first() / doc_next(), line index anchors carry the part, so going
+ *  to a line selects the bank only once. When text is inserted into a full
+ *  part, text records of the part are moved to the neighbour parts.
+ *  Program didn't fit in memory anymore. Linked with its own configuration
+ *  texted.cfg: code and read-only data share one memory area, rarely used
+ *  commands ('h', 't', 'f') are overlays linked to run at the same address.
+ *  Overlays are loaded to RAM bank OVL_BANK (file texted_ovl.txt) before
+ *  the program, ovl_load() copies the one needed to the overlay area.
+ *  Line index reduced to 512 anchors (8192 lines) to fit in upper RAM.
+ *
+ * 10/18/2026
+ *  Find uses Boyer-Moore-Horspool search (skip table built once per search)
+ *  directly on the text of records, across all parts of the document.
+ *  'f all' finds all lines with the text in one pass, found lines can be
+ *  listed with 'l fnd' and visited with 'g fnd'.
+ *
+ * 10/18/2026
+ *  Added command 'r' - replace text in the whole document. Text records are
+ *  rewritten in one pass through the gap: the gap is moved to the beginning
+ *  of each part, each record after the gap is replaced by its new version
+ *  written at the gap start, so the cost doesn't depend on the number of
+ *  replacements.
+ *
+ * 10/18/2026
+ *  Clipboard moved from 3.5 kB buffer in RAM to its own RAM bank
+ *  (CLIPBRD_BANK), text is kept there in text buffer format. Selected text
+ *  records are copied to the clipboard and pasted from it as one block per
+ *  part of document, clipboard can hold a whole RAM bank of text.
+ *  Clipboard is in RAM bank 4 (can be set with -DCLIPBRD_BANK=n), bank 7
+ *  is used by floader. Clipboard RAM bank is not cleared at start, only by
+ *  the first copy to clipboard. Clipboard RAM bank can't be selected with
+ *  'b' nor linked with 'k'.
+ *
+ * 10/18/2026
+ *  Added command 'u' - upload (ingest) text at the end of buffer. Text is
+ *  taken straight from UART RX queue without echo and written directly
+ *  into text records at the gap, sender is paused with XON/XOFF. Number of
+ *  lines, lines per second and dropped / truncated lines are reported.
+ *  'u' is an overlay (OVERLAY3).
+ *
+ * 10/18/2026
+ *  Added commands 'w' (export) and 'u bin' (import). Text records are sent
+ *  to host as they are in RAM banks, in frames with CRC-16. Host tool
+ *  tbconv converts the data to a text file and back. Imported records are
+ *  written directly at the gap as in 'u'. Both commands are in the 'u'
+ *  overlay.
+ *
+ * 10/18/2026
+ *  Added command 'v' - full screen (visual) editing on ANSI terminal.
+ *  Shadow copy of the screen is kept in RAM, only the characters that
+ *  differ from it are sent. Lines are scrolled in by the terminal (scroll
+ *  region), inserted / deleted lines are scrolled in a scroll region
+ *  starting at their row, so screen is repainted only for page up / down.
+ *  Edited line is written back to the text buffer through the gap when
+ *  the cursor leaves it. 'v' is an overlay (OVERLAY4).
+ *
  *  ..........................................................................
  *  TO DO:
  *
  *  ..........................................................................
  *  BUGS:
  *
- *  1) When clipboard size is 4 kB, program malfunctions. I am not sure if this
- *     is a cc65 issue or bug in my code. Wher I reduce the size to 3.5 kB all
- *     is good again. Compilation / linking doesn't warn about any memory
- *     segments overlapping and I examined carefully listing and map files and
- *     found no reason for this problem. For now the issue is averted by
- *     reducing the size of the clipboard buffer.
- *
  *  ..........................................................................
  */
 
@@ -92,9 +178,11 @@
 #include <string.h>
 #include <peekpoke.h>
 #include "mkhbcos_serialio.h"
+#include "mkhbcos_ansi.h"
 #include "mkhbcos_ml.h"
 #include "mkhbcos_ds1685.h"
 #include "romlib.h"
+#include "textbuf.h"
 
 #define IBUF1_SIZE      20
 #define IBUF2_SIZE      20
@@ -104,8 +192,67 @@
 #define RADIX_DEC       10
 #define RADIX_HEX       16
 #define RADIX_BIN       2
-#define MAX_LINES       ((END_BRAM-START_BRAM)/6)
-#define CLIPBRDBUF_SIZE 512*7   // 3.5 kB, don't go above it
+#define MAX_LINES       ((END_BRAM-START_TEXT)/TBREC_SIZE)
+#define LIDX_STEP       16      // line index: anchor every 16 lines
+#define LIDX_SIZE       512     // max. anchors, lines after the last one
+                                // are found by counting from it
+#define DOC_MAXPARTS    8       // document can span all RAM banks
+#define XFERBUF_SIZE    256     // buffer to move text between RAM banks
+#define OVL_BANK        5       // RAM bank reserved for overlays
+#define OVL_SLOT        0x1000  // overlay# n is at START_BRAM + n * OVL_SLOT
+#define OVL_MISC        0       // overlay of 'h', 't' (OVERLAY1)
+#define OVL_FIND        1       // overlay of 'f', 'r' (OVERLAY2)
+#define OVL_XFER        2       // overlay of 'u', 'u bin', 'w' (OVERLAY3)
+#define OVL_VISUAL      3       // overlay of 'v' (OVERLAY4)
+#define OVL_COUNT       4
+#define OVL_NONE        0xFF    // no valid overlay in the overlay area
+#define FIND_MAXHITS    256     // max. # of found lines kept by 'f all'
+#ifndef CLIPBRD_BANK
+#define CLIPBRD_BANK    4       // RAM bank reserved for the clipboard
+#endif
+#define INGEST_ROOM     (TBREC_SIZE + TEXTLINE_SIZE)    // room for a line
+#define RXQ_HIWATER     192     // send XOFF when RX queue is this full
+#define RXQ_LOWATER     64      // send XON when RX queue drained to this
+#define XON             0x11
+#define XOFF            0x13
+#define SCR_ROWS        23      // rows of text on the screen in 'v' mode
+#define SCR_COLS        80
+#define SCR_STATUS      SCR_ROWS    // status line, below the scroll region
+#define SCR_CHR(c)      ((unsigned char)(c) < ' ' ? ' ' : (c))
+#define BEL             0x07
+#define KEY_CTRLB       0x02    // keys in 'v' mode
+#define KEY_CTRLF       0x06
+#define KEY_BS          0x08
+#define KEY_CR          0x0D
+#define KEY_CTRLX       0x18
+#define KEY_CTRLY       0x19
+#define KEY_DEL         0x7F
+#define KEY_UP          0x100   // keys sent as ESC sequences
+#define KEY_DOWN        0x101
+#define KEY_RIGHT       0x102
+#define KEY_LEFT        0x103
+#define KEY_PGUP        0x104
+#define KEY_PGDN        0x105
+// Export / import of text: stream of frames
+//  XFER_SOH, type, length of data (2 bytes, LSB 1-st), data,
+//  CRC-16 (XMODEM) of type, length and data (2 bytes, MSB 1-st).
+// All bytes after XFER_SOH equal to XFER_SOH, XFER_DLE, XON or XOFF are
+// sent as XFER_DLE, byte ^ XFER_ESCXOR. Frame types:
+//  XFER_RECORDS - text records of a part of document (next pointers are
+//                 not used),
+//  XFER_END     - the last frame, data is # of lines (2 bytes, LSB 1-st).
+#define XFER_SOH        0x01
+#define XFER_DLE        0x10
+#define XFER_ESCXOR     0x20
+#define XFER_RECORDS    'R'
+#define XFER_END        'E'
+#define XFER_TIMEOUT    3       // seconds to wait for the next byte
+#define XFER_WAIT       30      // seconds to wait for the 1-st frame
+#define XFER_ERRTMO     1       // xfer_err: timeout
+#define XFER_ERRSOH     2       // xfer_err: start of (next) frame received
+#define CRC_ADD(b)      { crc_idx = crc_hi ^ (b); \
+                          crc_hi = crc_lo ^ crc_tabhi[crc_idx]; \
+                          crc_lo = crc_tablo[crc_idx]; }
 
 // command codes
 enum cmdcodes
@@ -126,6 +273,12 @@ enum cmdcodes
     CMD_INSERT,
     CMD_CUTSEL,
     CMD_FIND,
+    CMD_LINK,
+    CMD_REPLACE,
+    CMD_INGEST,
+    CMD_EXPORT,
+    CMD_IMPORT,
+    CMD_VISUAL,
 	//-------------
 	CMD_UNKNOWN
 };
@@ -134,7 +287,7 @@ const char *ver = "1.3.9.\n\r";
 
 // next pointer in last line's header in text buffer should point to
 // such content in memory
-const char null_txt_hdr[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00};
+const char null_txt_hdr[] = {0xFF, 0xFF, 0xFF, 0x00};
 // this string is entered by operator to end text adding / insertion
 const char *eot_str = "@EOT";
 
@@ -143,37 +296,26 @@ const char *eot_str = "@EOT";
 const char *divider = "--------------------------------------------\n\r";
 const char *unk3q = "???";
 const char *unk2q = "??";
-const char *spcolosp = " : ";
-const char *zerochr = "0";
-const char *spcchr = " ";
-const char *commspc = ", ";
 
-// Calendar constants.
-const char *daysofweek[8] =
+// Overlays. Signature of each overlay must match ovl_sig, so an overlay
+// left in OVL_BANK by another build of the program is not run.
+extern uint16_t _OVERLAY1_LOAD__, _OVERLAY1_SIZE__;
+extern uint16_t _OVERLAY2_LOAD__, _OVERLAY2_SIZE__;
+extern uint16_t _OVERLAY3_LOAD__, _OVERLAY3_SIZE__;
+extern uint16_t _OVERLAY4_LOAD__, _OVERLAY4_SIZE__;
+extern const char ovl_sigmisc[], ovl_sigfind[], ovl_sigxfer[], ovl_sigvisual[];
+const char ovl_sig[] = __DATE__ " " __TIME__;
+uint16_t * const ovl_run[OVL_COUNT] =
 {
-    "Sunday",
-    "Monday",
-    "Tuesday",
-    "Wednesday",
-    "Thursday",
-    "Friday",
-    "Saturday"
+    &_OVERLAY1_LOAD__, &_OVERLAY2_LOAD__, &_OVERLAY3_LOAD__, &_OVERLAY4_LOAD__
 };
-
-const char *monthnames[13] =
+uint16_t * const ovl_size[OVL_COUNT] =
 {
-    "January",
-    "February",
-    "March",
-    "April",
-    "May",
-    "June",
-    "July",
-    "August",
-    "September",
-    "October",
-    "November",
-    "December"
+    &_OVERLAY1_SIZE__, &_OVERLAY2_SIZE__, &_OVERLAY3_SIZE__, &_OVERLAY4_SIZE__
+};
+const char * const ovl_sigs[OVL_COUNT] =
+{
+    ovl_sigmisc, ovl_sigfind, ovl_sigxfer, ovl_sigvisual
 };
 
 // error codes
@@ -189,12 +331,15 @@ enum eErrors {
     ERROR_CLIPBRDOVF,
     ERROR_EMPTYCLIPBRD,
     ERROR_END,
+    ERROR_DOCFULL,
+    ERROR_RSVBANK,
+    ERROR_NOOVL,
     //------------------
     ERROR_UNKNOWN
 };
 
 // Error messages.
-const char *ga_errmsg[13] =
+const char *ga_errmsg[16] =
 {
     "OK.",
     "Unknown command.",
@@ -207,77 +352,81 @@ const char *ga_errmsg[13] =
     "Clipboard buffer overflow.",
     "Clipboard is empty.",
     "Search reached the end of text.",
+    "Document already spans all RAM banks.",
+    "RAM bank is reserved for the clipboard / overlays.",
+    "Overlay is not loaded (texted_ovl.txt).",
     "Unknown."
 };
 
-// Usage help.
-const char *helptext[43] =
-{
-    "\n\r",
-    " b : select / show current file # (bank #).\n\r",
-    "     b [00..07]\n\r",
-    " l : List text buffer contents.\n\r",
-    "     l all [n] | sel [n] | clb | [from_line#[-to_line# | -end]] [n]\n\r",
-    "      n - show line numbers\n\r",
-    "      all - list all content\n\r",
-    "      sel - list only selected content\n\r",
-    "      clb - list clipboard contents\n\r",
-    " a : start adding text at the end of buffer.\n\r",
-    " i : start inserting text at line# (or current line).\n\r",
-    "     i [line#]\n\r",
-    "     NOTE: 'a' and 'i' functions - type '@EOT' in a new line\n\r",
-    "           and press ENTER to finish and exit to command prompt.\n\r",
-    " g : go to specified line in text buffer.\n\r",
-    "     g start | end | [line#]\n\r",
-    " d : delete text.\n\r",
-    "     d [from_line#[-to_line# | -end]]\n\r",
-    " s : select text. (copies to clipboard)\n\r",
-    "     s [from_line#[-to_line# | -end]]\n\r",
-    " c : delete (cut) selection.\n\r",
-    " p : copy selected text.\n\r",
-    "     p [line#]\n\r",
-    " x : exit editor, leave text in buffer.\n\r",
-    " e : erase all text.\n\r",
-    " t : insert current date / time.\n\r",
-    " m : show file and memory information.\n\r",
-    "     Current file # (memory bank #).\n\r",
-    "     # of lines in file.\n\r",
-    "     Next free address (hex) in buffer.\n\r",
-    "     Free memory in current buffer.\n\r",
-    " f : find a text, search starts in next line from current.\n\r",
-    "     Move cursor to the line of occurrence if found.\n\r",
-    "     f [text]\n\r",
-    "NOTE:\n\r",
-    "   Default line#, from_line#, to_line# is the current line.\n\r",
-    "   Arguments are <mandatory> OR [optional].\n\r",
-    "   When range is provided, SPACE can be used instead of '-'.\n\r",
-    "   Argument 'text' can contain spaces.\n\r",
-    "   'start' - 1-st line of text, 'end' - last line of text.\n\r",
-    "\n\r",
-    "@EOH"
-};
 
 // Buffer for current text record.
 struct text_line {
-    unsigned int num;
     unsigned char len;
     uint16_t next_ptr;
     char text[TEXTLINE_SIZE];
 } CurrLine;
 
+// Line index anchor: address of the text record of line# line in the part
+// of document.
+struct lidx_anchor {
+    unsigned int line;
+    uint16_t addr;
+    unsigned char part;
+};
+
 // RTC data buffer.
 struct ds1685_clkdata	clkdata;
 
+// Line index, sorted by line#. 1-st anchor is always line #0.
+// Table is large, so it is kept in upper RAM (not cleared at start).
+#pragma bss-name (push, "XBSS")
+struct lidx_anchor lidx[LIDX_SIZE];
+char xferbuf[XFERBUF_SIZE];
+char find_text[TEXTLINE_SIZE];          // text to find
+unsigned char find_skip[256];           // Horspool skip table of find_text
+unsigned int find_lines[FIND_MAXHITS];  // line# of lines found by 'f all'
+unsigned char crc_tabhi[256];           // CRC-16 lookup tables
+unsigned char crc_tablo[256];
+#pragma bss-name (pop)
+
 // globals
 int  cmd_code = CMD_NULL;
 char prompt_buf[PROMPTBUF_SIZE];
 char ibuf1[IBUF1_SIZE], ibuf2[IBUF2_SIZE], ibuf3[IBUF3_SIZE];
-char clipbrd[CLIPBRDBUF_SIZE];
 char bankinit_flags[8];
 unsigned int line_num, sel_begin, sel_end, last_line, line_count;
 uint16_t curr_addr, lastaddr;
 int bank_num;
 unsigned long tmr64;
+unsigned int lidx_count;    // # of anchors in line index, 0 - not valid
+unsigned char lidx_bank;    // 1-st RAM bank# of document the index is for
+// Document: parts in linked RAM banks.
+unsigned char doc_banks[DOC_MAXPARTS];  // RAM bank# of each part
+unsigned int doc_nlines[DOC_MAXPARTS];  // # of lines in each part
+unsigned char doc_nparts;   // # of parts, doc_banks[0] is the 1-st one
+unsigned char doc_curr;     // part in currently selected RAM bank
+unsigned char find_len;     // length of find_text
+unsigned int find_count;    // # of lines in find_lines
+unsigned char find_bank;    // 1-st RAM bank# of document find_lines is for
+uint16_t gap_start;         // address of gap record, 0 - no gap
+uint16_t gap_end;           // address of 1-st text record after the gap
+uint16_t clip_tail;         // address of null header in clipboard bank
+unsigned int clip_lines;    // # of lines in clipboard
+unsigned char rx_xoff;      // sender was paused with XOFF
+unsigned char rx_qfull;     // RX queue was full
+unsigned int rx_overflows;  // # of times RX queue was full
+unsigned char xfer_err;     // error receiving frame
+unsigned char crc_hi, crc_lo, crc_idx;  // CRC-16 of frame
+// Screen editor ('v'): what is on the screen (text rows and status line).
+char scr_shadow[SCR_ROWS + 1][SCR_COLS];
+char scr_edit[TEXTLINE_SIZE];   // text of the line being edited
+unsigned char scr_dirty;        // scr_edit was changed
+unsigned char scr_crow;         // terminal cursor row, 0xFF - not known
+unsigned char scr_ccol;         // terminal cursor column
+unsigned char scr_col;          // cursor column in the edited line
+unsigned int scr_top;           // line# in the 1-st row of the screen
+unsigned int scr_line;          // line# of the edited line
+unsigned char ovl_curr;     // overlay in the overlay area
 
 // Functions prototypes.
 void        getline(void);
@@ -291,6 +440,31 @@ int         adv2nextspc(int idx);
 void        texted_prndt(void);
 int         exec_cmd(void);
 void        texted_add(void);
+void        texted_ingest(void);
+void        texted_export(void);
+void        texted_import(void);
+void        texted_visual(void);
+void        scr_gotoxy(unsigned char row, unsigned char col);
+void        scr_putrow(unsigned char row, const char *text);
+void        scr_scroll(unsigned char row, unsigned char up);
+void        scr_fill(unsigned char row);
+void        scr_show(void);
+void        scr_status(const char *msg);
+void        scr_getline(void);
+int         scr_putline(void);
+int         scr_getkey(void);
+int         rx_getc(int secs);
+void        rx_pause(void);
+void        ingest_init(void);
+int         ingest_room(uint16_t need);
+void        ingest_putrec(unsigned char len);
+void        ingest_done(void);
+void        crc_init(void);
+void        xfer_putc(unsigned char b);
+void        xfer_putmem(uint16_t addr, uint16_t n);
+void        xfer_begin(unsigned char type, uint16_t len);
+void        xfer_end(void);
+unsigned char xfer_getc(void);
 void        texted_list(void);
 void        texted_goto(void);
 void        texted_delete(void);
@@ -311,12 +485,60 @@ int         is_timeout(void);
 void        write_text2mem(uint16_t addr);
 int         copy2clipbrd(unsigned int from_line, unsigned int to_line);
 void        texted_copy(void);
-uint16_t    renumber(uint16_t addr, int offs);
+uint16_t    relink(uint16_t addr, uint16_t end);
 void        list_clipbrd(void);
+void        clip_clear(void);
+void        clip_putend(void);
+unsigned int clip_paste(uint16_t addr);
 void        texted_find(void);
+void        find_init(void);
+int         find_match(const char *txt, unsigned char len);
+int         repl_line(const char *txt, unsigned char len,
+                      const char *repl, unsigned char rlen);
+void        texted_replace(void);
+void        list_found(int show_num);
 void        texted_insdttm(void);
 void        texted_assert(uint16_t line, int cond, const char *msg);
 void        prninfo_addtext(void);
+void        lidx_build(void);
+unsigned int lidx_search(unsigned int line);
+unsigned int lidx_find(unsigned int line);
+uint16_t    lidx_addr(unsigned int line);
+void        lidx_append(unsigned int line, uint16_t addr);
+void        lidx_insert(unsigned int line);
+void        lidx_delete(unsigned int from_line, unsigned int to_line);
+void        lidx_move(uint16_t from, uint16_t to, uint16_t offs);
+int         isgap_hdr(uint16_t addr);
+uint16_t    tb_first(void);
+uint16_t    tb_next(uint16_t addr);
+uint16_t    tb_free(void);
+void        tb_putgap(void);
+void        tb_fixgap(void);
+void        tb_movegap(uint16_t addr);
+void        tb_closegap(void);
+uint16_t    tb_insert(uint16_t addr);
+void        tb_puthdr(void);
+void        tb_putcache(void);
+void        tb_getcache(void);
+int         tb_cacheok(void);
+int         tb_convert(void);
+int         tb_check(void);
+int         tb_spillnext(uint16_t addr, uint16_t extra);
+int         tb_spillprev(uint16_t addr, uint16_t extra);
+void        texted_link(void);
+void        doc_selbank(int bank);
+void        doc_xfer(int from_bank, uint16_t src,
+                     int to_bank, uint16_t dst, uint16_t n);
+void        doc_select(unsigned char part);
+uint16_t    doc_skip(uint16_t addr);
+uint16_t    doc_next(uint16_t addr);
+uint16_t    doc_first(void);
+int         doc_room(uint16_t addr, uint16_t need);
+uint16_t    doc_insert(uint16_t addr);
+int         doc_putline(unsigned int line);
+void        doc_closegap(void);
+void        doc_head(void);
+int         ovl_load(unsigned char ovl);
 
 ////////////////////////////// CODE /////////////////////////////////////
 
@@ -347,166 +569,261 @@ void texted_assert(uint16_t line, int cond, const char *msg)
     }
 }
 
+#pragma code-name (push, "OVERLAY1")
+#pragma rodata-name (push, "OVERLAY1")
+
+// Calendar constants.
+const char * const daysofweek[8] =
+{
+    "Sunday",
+    "Monday",
+    "Tuesday",
+    "Wednesday",
+    "Thursday",
+    "Friday",
+    "Saturday"
+};
+
+const char * const monthnames[13] =
+{
+    "January",
+    "February",
+    "March",
+    "April",
+    "May",
+    "June",
+    "July",
+    "August",
+    "September",
+    "October",
+    "November",
+    "December"
+};
+
 /*
  * Read date/time from DS1685 IC and insert it into current line.
  * Format: "DayOfWeek, Month Day, Year, at hh : mm"
  */
 void texted_insdttm(void)
 {
-    if (RTCDETECTED) {
-
-        ds1685_rdclock (&clkdata);
+    uint16_t addr;
+    int adding;
+    const char *dow, *mon;
+    char *p;
 
-        memset(ibuf3, 0, IBUF3_SIZE);
-        memset(&CurrLine, 0, sizeof (struct text_line));
+    if (RTCDETECTED) {
 
-        if (clkdata.dayofweek > 0 && clkdata.dayofweek < 8)	{
-           strcpy(CurrLine.text, daysofweek[clkdata.dayofweek-1]);
-        } else {
-            strcpy(CurrLine.text, unk3q);
+        if (0 == checkbuf()) {
+            return;
         }
 
-        strcat(CurrLine.text, commspc);
-
-        if (clkdata.month > 0 && clkdata.month < 13)
-            strcat(CurrLine.text, monthnames[clkdata.month-1]);
-        else
-            strcat(CurrLine.text, unk3q);
-
-        strcat(CurrLine.text, spcchr);
-
-        strcat(CurrLine.text, itoa(clkdata.date, ibuf3, RADIX_DEC));
+        ds1685_rdclock (&clkdata);
 
-        strcat(CurrLine.text, commspc);
+        memset(&CurrLine, 0, sizeof (struct text_line));
 
-        if (clkdata.century < 100)
-            strcat(CurrLine.text, itoa(clkdata.century, ibuf3, RADIX_DEC));
+        if (clkdata.dayofweek > 0 && clkdata.dayofweek < 8)
+            dow = daysofweek[clkdata.dayofweek-1];
         else
-            strcat(CurrLine.text, unk2q);
-        if(clkdata.year < 100)
-        {
-            if (clkdata.year < 10)
-                strcat(CurrLine.text, zerochr);
-            strcat(CurrLine.text, itoa(clkdata.year, ibuf3, RADIX_DEC));
-        }
+            dow = unk3q;
+        if (clkdata.month > 0 && clkdata.month < 13)
+            mon = monthnames[clkdata.month-1];
         else
-            strcat(CurrLine.text, unk2q);
+            mon = unk3q;
 
-        strcat(CurrLine.text, commspc);
-        strcat(CurrLine.text, "at ");
+        // one pass formatting in ROM, each call appends to the previous one
+        p = mos_sprintf(CurrLine.text, "%s, %s %d, ", dow, mon, clkdata.date);
+        p = mos_sprintf(p, (clkdata.century < 100) ? "%d" : unk2q,
+                        clkdata.century);
+        p = mos_sprintf(p, (clkdata.year < 100) ? "%02d" : unk2q,
+                        clkdata.year);
+        mos_sprintf(p, ", at %02d : %02d", clkdata.hours, clkdata.minutes);
 
-        if (clkdata.hours < 10)
-            strcat(CurrLine.text, zerochr);
-        strcat(CurrLine.text, itoa(clkdata.hours, ibuf3, RADIX_DEC));
-        strcat(CurrLine.text, spcolosp);
-        if (clkdata.minutes < 10)
-            strcat(CurrLine.text, zerochr);
-        strcat(CurrLine.text, itoa(clkdata.minutes, ibuf3, RADIX_DEC));
-
-        CurrLine.num = line_num;
         CurrLine.len = strlen(CurrLine.text);
-        CurrLine.next_ptr = curr_addr + CurrLine.len + 6;
 
-        if (isnull_hdr((const char *)curr_addr)) { // add at the end
-                if (0 == isaddr_oor(CurrLine.next_ptr + 6)) {
-                    CurrLine.num++;
-                    write_text2mem(curr_addr);
-                    strcpy((char *)CurrLine.next_ptr, null_txt_hdr);
-                } else {
-                    prnerror(ERROR_FULLBUF);
-                }
-        } else {    // insert in the middle
-            if (END_BRAM > (lastaddr + CurrLine.len + 6)) {
-                // there is space for new line, so continue...
-                // 1. Move text down
-                memmove((void *)CurrLine.next_ptr,
-                        (const void *)curr_addr,
-                        (size_t)(lastaddr - curr_addr + 1));
-                // 2. Insert newly entered line
-                write_text2mem(curr_addr);
-                // 3. Renumber following lines
-                renumber(CurrLine.next_ptr, 1);
-            } else {
-                // buffer full, end here
-                prnerror(ERROR_FULLBUF);
+        adding = (0 == line_count);
+        addr = doc_insert(curr_addr);
+        if (addr) {
+            if (adding) {   // 1-st line of empty buffer
+                lidx_append(0, addr);
+            } else {        // inserted in the middle
+                lidx_insert(line_num);
             }
+            curr_addr = addr;
+        } else {
+            prnerror(ERROR_FULLBUF);
         }
         checkbuf();
     }
 }
 
+#pragma rodata-name (pop)
+#pragma code-name (pop)
+
 /*
  * List clipboard contents.
  */
 void list_clipbrd(void)
 {
-    unsigned int llen;
-    char *s = clipbrd;
+    unsigned int i;
+    uint16_t addr = START_TEXT;
 
-    set_timeout(5);
-    while(0 == is_timeout()) {
-        if (isnull_hdr((const char *)s)) {
-            break;
+    doc_selbank(CLIPBRD_BANK);
+    for (i = 0; i < clip_lines; i++) {
+        puts(TBREC_TXTPTR(addr));
+        puts("\n\r");
+        addr = TBREC_GETNXT(addr);
+    }
+    doc_selbank(doc_banks[doc_curr]);
+}
+
+/*
+ * Make the clipboard empty text buffer.
+ * Clipboard RAM bank is left selected.
+ */
+void clip_clear(void)
+{
+    doc_selbank(CLIPBRD_BANK);
+    tb_puthdr();
+    clip_tail = START_TEXT;
+    clip_lines = 0;
+    clip_putend();
+}
+
+/*
+ * Put null header at the end of text in clipboard and update the header
+ * cache of clipboard text buffer. Clipboard RAM bank must be selected.
+ */
+void clip_putend(void)
+{
+    strcpy((char *)clip_tail, null_txt_hdr);
+    TBHDR_PUTW(TBHDR_TAIL, clip_tail);
+    TBHDR_PUTW(TBHDR_LINES, clip_lines);
+    TBHDR_PUTW(TBHDR_FREE, END_BRAM - clip_tail - strlen(null_txt_hdr) - 1);
+}
+
+/*
+ * List lines found by 'f all'.
+ */
+void list_found(int show_num)
+{
+    unsigned int i;
+    uint16_t addr;
+
+    for (i = 0; i < find_count; i++) {
+        addr = lidx_addr(find_lines[i]);
+        if (show_num) {
+            puts(utoa(find_lines[i], ibuf1, RADIX_DEC));
+            puts(":");
         }
-        puts(s);
+        puts(TBREC_TXTPTR(addr));
         puts("\n\r");
-        llen = strlen(s);
-        s += (llen + 1);
     }
 }
 
 /*
  * Copy selected block of text to the clipboard.
- * To save space, only text is copied, not the headers.
+ * Text records are kept in the clipboard RAM bank in text buffer format.
+ * Selected records of each part of document are copied as one block
+ * (the gap is moved out of the way first if it splits the selection).
  * In case the selected block is too big for the clipboard, error is printed
- * and only the amount of text that can fit in the clipboard is copied.
+ * and only the lines that can fit in the clipboard are copied.
  * Return # of lines copied.
  */
 int copy2clipbrd(unsigned int from_line, unsigned int to_line)
 {
-    unsigned int line, llen;
-    uint16_t addr = START_BRAM;
-    int clipbrd_index = 0;
-    int ret = 0, i = 0;
+    unsigned int line = from_line;
+    unsigned int lines;
+    uint16_t addr, end, n, reclen;
+    int ovf = 0;
 
-    // clear the clipboard
-    for ( ; i < CLIPBRDBUF_SIZE; i++) {
-        clipbrd[i] = 0;
-    }
-    strcpy(clipbrd, null_txt_hdr);
-    // copy selected text to clipboard
-    while(addr < END_BRAM) {
-        if (isnull_hdr((const char *)addr)) {
-            break;  // end of text buffer reached
-        }
-        line = PEEKW(addr);
-        if (line > to_line) {
-            break;  // all selected lines copied
-        }
-        if (line >= from_line) { // copy text from record in buffer to clipbrd
-            llen = PEEK(addr + 2);
-            if ((clipbrd_index + llen + strlen(null_txt_hdr))
-                   < CLIPBRDBUF_SIZE) {
-
-                *(clipbrd + clipbrd_index) = 0;
-                strcpy((char *)(clipbrd + clipbrd_index),
-                       (const char *)(addr + 5));
-                clipbrd_index += (llen + 1);
-                // put null header at the end
-                strcpy((char *)(clipbrd + clipbrd_index), null_txt_hdr);
-                ret++;
-            } else { // clipboard buffer overflow
-                prnerror(ERROR_CLIPBRDOVF);
+    clip_clear();
+    addr = lidx_addr(from_line);
+    while (0 == ovf && line <= to_line
+           && 0 == isnull_hdr((const char *)addr)) {
+        // selected records of current part that fit in clipboard
+        n = 0;
+        lines = 0;
+        end = addr;
+        while (line <= to_line && 0 == isnull_hdr((const char *)end)) {
+            reclen = TBREC_GETLEN(end) + TBREC_SIZE;
+            if (clip_tail + n + reclen + strlen(null_txt_hdr) >= END_BRAM) {
+                ovf = 1;
                 break;
             }
+            n += reclen;
+            lines++;
+            line++;
+            end = tb_next(end);
         }
-        addr = PEEKW(addr + 3); // next text record
-        if (isaddr_oor(addr)) {
-            break;  // address out of range
+        if (gap_start && addr < gap_start && end >= gap_end) {
+            tb_movegap(end);    // records addr .. end-1 are contiguous now
+            tb_fixgap();
         }
+        doc_xfer(doc_banks[doc_curr], addr, CLIPBRD_BANK, clip_tail, n);
+        relink(clip_tail, clip_tail + n);
+        clip_tail += n;
+        clip_lines += lines;
+        clip_putend();
+        doc_selbank(doc_banks[doc_curr]);
+        addr = doc_skip(end);
+    }
+    if (ovf) { // clipboard buffer overflow
+        prnerror(ERROR_CLIPBRDOVF);
     }
 
-    return ret;
+    return clip_lines;
+}
+
+/*
+ * Insert text from clipboard before the text record at addr (or null
+ * header) in current part.
+ * If there is room for all of it in the gap (possibly after moving text
+ * records to the neighbour parts), it is copied as one block. Otherwise
+ * the records are inserted one by one, so they can go to several parts.
+ * Return # of lines inserted.
+ */
+unsigned int clip_paste(uint16_t addr)
+{
+    uint16_t n = clip_tail - START_TEXT;
+    uint16_t src = START_TEXT;
+    unsigned int i;
+
+    if (doc_room(addr, n)) {
+        doc_xfer(CLIPBRD_BANK, START_TEXT, doc_banks[doc_curr], gap_start, n);
+        relink(gap_start, gap_start + n);
+        gap_start += n;
+        tb_fixgap();
+        line_count += clip_lines;
+        last_line = line_count - 1;
+        doc_nlines[doc_curr] += clip_lines;
+        tb_putcache();
+        lidx_count = 0;
+        find_count = 0;
+
+        return clip_lines;
+    }
+    // the gap is at addr now, leave the gap record valid
+    addr = gap_start;
+    tb_fixgap();
+    if (gap_start) {
+        addr = gap_end;
+    }
+    for (i = 0; i < clip_lines; i++) {
+        doc_selbank(CLIPBRD_BANK);
+        CurrLine.len = TBREC_GETLEN(src);
+        strcpy(CurrLine.text, TBREC_TXTPTR(src));
+        src = TBREC_GETNXT(src);
+        doc_selbank(doc_banks[doc_curr]);
+        addr = doc_insert(addr);
+        if (0 == addr) {
+            break;  // buffer full
+        }
+        addr = tb_next(addr);
+    }
+    lidx_count = 0;
+    find_count = 0;
+
+    return i;
 }
 
 /*
@@ -514,379 +831,2184 @@ int copy2clipbrd(unsigned int from_line, unsigned int to_line)
  */
 void write_text2mem(uint16_t addr)
 {
-    POKEW(addr, CurrLine.num);
-    POKE(addr + 2, CurrLine.len);
-    POKEW(addr + 3, CurrLine.next_ptr);
-    strcpy((char *)(addr + 5), CurrLine.text);
+    POKE(addr + TBREC_LEN, CurrLine.len);
+    POKEW(addr + TBREC_NEXT, CurrLine.next_ptr);
+    strcpy(TBREC_TXTPTR(addr), CurrLine.text);
 }
 
 /*
- *  Return non-zero if addr is out of range START_BRAM .. END_BRAM.
+ * Build line index of the document. Parts are walked in order, so each
+ * RAM bank is selected once.
  */
-int isaddr_oor(uint16_t addr)
+void lidx_build(void)
 {
-    if (addr < START_BRAM || addr >= END_BRAM)
-    {
-        prnerror(ERROR_ADDROOR);
-        puts("addr = $");
-        puts(utoa(addr, ibuf1, RADIX_HEX));
-        puts("\n\r");
+    uint16_t addr = doc_first();
+    unsigned int line = 0;
 
-        return 1;
+    lidx_count = 0;
+    lidx_bank = doc_banks[0];
+    while (lidx_count < LIDX_SIZE) {
+        if (isnull_hdr((const char *)addr)) {
+            break;
+        }
+        if (0 == (line % LIDX_STEP)) {
+            lidx[lidx_count].line = line;
+            lidx[lidx_count].addr = addr;
+            lidx[lidx_count].part = doc_curr;
+            lidx_count++;
+        }
+        line++;
+        addr = doc_next(addr);
+        if (isaddr_oor(addr)) {
+            lidx_count = 0;
+            break;
+        }
+    }
+    if (0 == lidx_count) {  // empty buffer
+        lidx[0].line = 0;
+        lidx[0].addr = doc_first();
+        lidx[0].part = doc_curr;
+        lidx_count = 1;
     }
-
-    return 0;
 }
 
 /*
- * Return non-zero if the text record header pointed by hdr is a null header.
+ * Return index of the last anchor with line# not greater than line
+ * (binary search). Line index must be valid.
  */
-int isnull_hdr(const char *hdr)
+unsigned int lidx_search(unsigned int line)
 {
-    int i = 1;
-    int ret = 1;
+    unsigned int lo = 0, mid;
+    unsigned int hi = lidx_count - 1;
 
-    if (hdr == NULL
-        || hdr[0] != null_txt_hdr[0]
-        || strlen(hdr) < strlen(null_txt_hdr)) {
-        ret = 0;
-    } else {
-        while(hdr[i] != 0 && null_txt_hdr[i] != 0) {
-            if (hdr[i] != null_txt_hdr[i]) {
-                ret = 0;
-                break;
-            }
-            i++;
+    while (lo < hi) {
+        mid = (lo + hi + 1) >> 1;
+        if (lidx[mid].line <= line) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
         }
     }
 
-    return ret;
+    return lo;
 }
 
 /*
- * Pause specified # of 1/64-ths of a second.
+ * Return index of the nearest anchor at or before the line.
+ * Index is rebuilt if not valid.
  */
-void pause_sec64(uint16_t delay)
+unsigned int lidx_find(unsigned int line)
 {
-    // current timer + desired delay in 1/64 sec intervals
-    // will be the number we wait for in a loop
-    unsigned long t64hz = *TIMER64HZ + delay;
-
-    if (RTCDETECTED) {
-        while (*TIMER64HZ < t64hz) {
-            // Intentionally EMPTY
-        }
+    if (0 == lidx_count || lidx_bank != doc_banks[0]) {
+        lidx_build();
     }
+
+    return lidx_search(line);
 }
 
 /*
- * Set global variable tmr64 to a value that will be reached by system timer
- * after certain # of seconds (secs).
+ * Return address of the text record of line# line (or null header at the
+ * end of text). RAM bank of its part is selected, current line is not
+ * changed.
  */
-void set_timeout(int secs)
+uint16_t lidx_addr(unsigned int line)
 {
-    if (RTCDETECTED) {
-        tmr64 = *TIMER64HZ + (secs * 64);
+    unsigned int i = lidx_find(line);
+    unsigned int l = lidx[i].line;
+    uint16_t addr = lidx[i].addr;
+
+    doc_select(lidx[i].part);
+    while (l < line && 0 == isnull_hdr((const char *)addr)) {
+        addr = doc_next(addr);
+        l++;
     }
+
+    return addr;
 }
 
 /*
- * Return 1 if the timeout set by set_timeout() function has expired.
+ * Text record of line# line was added at the end of text at address addr.
  */
-int is_timeout(void)
+void lidx_append(unsigned int line, uint16_t addr)
 {
-    int ret = 0;
+    if (0 == line) {    // 1-st line of empty buffer
+        lidx[0].line = 0;
+        lidx[0].addr = addr;
+        lidx[0].part = doc_curr;
+        lidx_count = 1;
+        lidx_bank = doc_banks[0];
+    } else if (lidx_count > 0
+        && lidx_count < LIDX_SIZE
+        && line == lidx[lidx_count-1].line + LIDX_STEP) {
 
-    if (RTCDETECTED) {
-        if (tmr64 < *TIMER64HZ) {
-            ret = 1;
-        }
+        lidx[lidx_count].line = line;
+        lidx[lidx_count].addr = addr;
+        lidx[lidx_count].part = doc_curr;
+        lidx_count++;
     }
-
-    return ret;
 }
 
-// Command parsing helpers.
 /*
- * Advance index to next token.
+ * New text record was inserted as line# line in the gap. Records that
+ * follow were not moved, only their line numbers are 1 greater now.
  */
-int adv2nxttoken(int idx)
+void lidx_insert(unsigned int line)
 {
-    while (prompt_buf[idx] == 32) {
-        idx++;
-    }
+    unsigned int i;
 
-    return idx;
+    find_count = 0;     // found lines moved
+    if (0 == lidx_count) {
+        return;
+    }
+    i = lidx_search(line);
+    if (lidx[i].line < line) {
+        i++;
+    }
+    if (0 == i  // 1-st anchor must be line #0
+        || (i < lidx_count && lidx[i].line - lidx[i-1].line >= 2 * LIDX_STEP)
+        || (i == lidx_count && line - lidx[i-1].line >= 2 * LIDX_STEP)) {
+        lidx_count = 0;     // rebuild when needed
+        return;
+    }
+    for ( ; i < lidx_count; i++) {
+        lidx[i].line++;
+    }
 }
 
 /*
- * Advance index to next space.
+ * Lines from_line .. to_line were deleted (added to the gap). Records that
+ * follow were not moved, their line numbers are n less now.
  */
-int adv2nextspc(int idx)
+void lidx_delete(unsigned int from_line, unsigned int to_line)
+{
+    unsigned int i, j;
+    unsigned int n = to_line - from_line + 1;
+
+    find_count = 0;     // found lines moved
+    if (0 == lidx_count) {
+        return;
+    }
+    i = lidx_search(from_line);
+    if (lidx[i].line < from_line) {
+        i++;
+    }
+    if (0 == i) {
+        lidx_count = 0;     // line #0 deleted, rebuild when needed
+        return;
+    }
+    // drop anchors of deleted lines
+    for (j = i; j < lidx_count && lidx[j].line <= to_line; j++)
+        ;
+    for ( ; j < lidx_count; i++, j++) {
+        lidx[i].line = lidx[j].line - n;
+        lidx[i].addr = lidx[j].addr;
+        lidx[i].part = lidx[j].part;
+    }
+    lidx_count = i;
+}
+
+/*
+ * Text in address range from .. to-1 of current part was moved by offs
+ * bytes. Update line index and current line address.
+ */
+void lidx_move(uint16_t from, uint16_t to, uint16_t offs)
+{
+    unsigned int i;
+
+    for (i = 0; i < lidx_count; i++) {
+        if (lidx[i].part == doc_curr
+            && lidx[i].addr >= from && lidx[i].addr < to) {
+            lidx[i].addr += offs;
+        }
+    }
+    if (curr_addr >= from && curr_addr < to) {
+        curr_addr += offs;
+    }
+}
+
+/*
+ * Return non-zero if the text record at addr is the gap record.
+ * Gap record has length TBGAP_MARK (as null header), but its next pointer
+ * points to the text after the gap.
+ */
+int isgap_hdr(uint16_t addr)
+{
+    return (TBREC_GETLEN(addr) == TBGAP_MARK
+            && TBREC_GETNXT(addr) != 0xFFFF);
+}
+
+/*
+ * Return address of the 1-st text record (or null header if no text).
+ */
+uint16_t tb_first(void)
+{
+    return (START_TEXT == gap_start) ? gap_end : START_TEXT;
+}
+
+/*
+ * Return address of the text record following the one at addr.
+ * The gap is skipped.
+ */
+uint16_t tb_next(uint16_t addr)
+{
+    addr = TBREC_GETNXT(addr);
+
+    return (addr == gap_start) ? gap_end : addr;
+}
+
+/*
+ * Return # of free bytes in text buffer.
+ */
+uint16_t tb_free(void)
+{
+    return gap_start ? (gap_end - gap_start) : (END_BRAM - lastaddr - 1);
+}
+
+/*
+ * Write the gap record at gap_start.
+ */
+void tb_putgap(void)
+{
+    POKE(gap_start + TBREC_LEN, TBGAP_MARK);
+    POKEW(gap_start + TBREC_NEXT, gap_end);
+    POKE(gap_start + TBREC_TEXT, 0);
+}
+
+/*
+ * Write the gap record after the gap was moved or resized, or close the gap
+ * if there is no room left for the gap record.
+ */
+void tb_fixgap(void)
+{
+    if (gap_end - gap_start < TBREC_SIZE) {
+        tb_closegap();
+    } else {
+        tb_putgap();
+    }
+}
+
+/*
+ * Move the gap in text buffer, so text record at addr (or null header)
+ * is the 1-st one after the gap. If there is no gap, it is opened by moving
+ * the text from addr to the end of bank.
+ * Only the text between old and new gap position is moved.
+ * Gap record is not written, caller must call tb_putgap().
+ */
+void tb_movegap(uint16_t addr)
+{
+    uint16_t n;
+
+    if (0 == gap_start) {
+        n = lastaddr - addr + 1;
+        memmove((void *)(END_BRAM - n), (const void *)addr, n);
+        lidx_move(addr, lastaddr, END_BRAM - lastaddr - 1);
+        gap_start = addr;
+        gap_end = END_BRAM - n;
+        lastaddr = END_BRAM - 1;
+        relink(gap_end, END_BRAM);
+    } else if (addr < gap_start) {
+        // text gap_start-n .. gap_start-1 goes after the gap
+        n = gap_start - addr;
+        memmove((void *)(gap_end - n), (const void *)addr, n);
+        lidx_move(addr, gap_start, gap_end - gap_start);
+        gap_start = addr;
+        gap_end -= n;
+        relink(gap_end, gap_end + n);
+    } else if (addr > gap_end) {
+        // text gap_end .. addr-1 goes before the gap
+        n = addr - gap_end;
+        memmove((void *)gap_start, (const void *)gap_end, n);
+        lidx_move(gap_end, addr, gap_start - gap_end);
+        relink(gap_start, gap_start + n);
+        gap_start += n;
+        gap_end = addr;
+    }
+}
+
+/*
+ * Close the gap - move text after the gap back, right after the text
+ * before the gap, so the text buffer is contiguous.
+ */
+void tb_closegap(void)
+{
+    uint16_t n;
+
+    if (gap_start) {
+        n = lastaddr - gap_end + 1;
+        memmove((void *)gap_start, (const void *)gap_end, n);
+        lidx_move(gap_end, lastaddr, gap_start - gap_end);
+        relink(gap_start, gap_start + n);
+        lastaddr = gap_start + n - 1;
+        gap_start = 0;
+        tb_putcache();
+    }
+}
+
+/*
+ * Insert text record from CurrLine (text and len must be set)
+ * before the text record at addr (or null header).
+ * Return address of the new text record or 0 if text buffer is full.
+ */
+uint16_t tb_insert(uint16_t addr)
+{
+    uint16_t ret;
+
+    if (tb_free() < CurrLine.len + TBREC_SIZE) {
+        return 0;
+    }
+    tb_movegap(addr);
+    ret = gap_start;
+    CurrLine.next_ptr = ret + CurrLine.len + TBREC_SIZE;
+    write_text2mem(ret);
+    gap_start = CurrLine.next_ptr;
+    if (gap_end - gap_start < TBREC_SIZE) {
+        tb_closegap();  // no room left for the gap record
+    } else {
+        tb_putgap();
+    }
+    line_count++;
+    last_line = line_count - 1;
+    doc_nlines[doc_curr]++;
+    tb_putcache();
+
+    return ret;
+}
+
+/*
+ * Write text buffer header (current format) at the beginning of the bank.
+ */
+void tb_puthdr(void)
+{
+    memset((void *)START_BRAM, 0, TBHDR_SIZE);
+    POKE(START_BRAM, TB_MAGIC1);
+    POKE(START_BRAM + 1, TB_MAGIC2);
+    POKE(START_BRAM + 2, TB_VERSION);
+}
+
+/*
+ * Store tail address, line count, free space and gap address in text buffer
+ * header. Must be called after text buffer was altered.
+ */
+void tb_putcache(void)
+{
+    TBHDR_PUTW(TBHDR_TAIL, lastaddr - strlen(null_txt_hdr));
+    TBHDR_PUTW(TBHDR_LINES, doc_nlines[doc_curr]);
+    TBHDR_PUTW(TBHDR_FREE, tb_free());
+    TBHDR_PUTW(TBHDR_GAP, gap_start);
+}
+
+/*
+ * Set text buffer state from values cached in text buffer header.
+ */
+void tb_getcache(void)
+{
+    lastaddr = TBHDR_GETW(TBHDR_TAIL) + strlen(null_txt_hdr);
+    gap_start = TBHDR_GETW(TBHDR_GAP);
+    if (gap_start) {
+        gap_end = TBREC_GETNXT(gap_start);
+    }
+}
+
+/*
+ * Validate values cached in text buffer header against the text buffer.
+ * Return non-zero if they can be used.
+ */
+int tb_cacheok(void)
+{
+    uint16_t tail = TBHDR_GETW(TBHDR_TAIL);
+    uint16_t gap = TBHDR_GETW(TBHDR_GAP);
+    uint16_t nfree;
+
+    if (0 == TB_HDROK
+        || tail < START_TEXT
+        || tail > END_BRAM - sizeof(null_txt_hdr)
+        || 0 == isnull_hdr((const char *)tail)
+        || TBHDR_GETW(TBHDR_LINES) > MAX_LINES) {
+
+        return 0;
+    }
+    if (gap) {
+        if (gap < START_TEXT || gap >= tail || 0 == isgap_hdr(gap)
+            || TBREC_GETNXT(gap) > tail) {
+
+            return 0;
+        }
+        nfree = TBREC_GETNXT(gap) - gap;
+    } else {
+        nfree = END_BRAM - tail - sizeof(null_txt_hdr);
+    }
+
+    return (TBHDR_GETW(TBHDR_FREE) == nfree);
+}
+
+/*
+ * Convert text buffer in format version 1 (line# in each record, no buffer
+ * header) to current format in one pass. Records are compacted in place
+ * (gap is dropped), then the text is moved up to make room for the header.
+ * Buffer must be checked for sanity before calling this function.
+ * Return 0 if there is not enough room for the header.
+ */
+int tb_convert(void)
+{
+    uint16_t src = START_BRAM;
+    uint16_t dst = START_BRAM;
+    uint16_t nxtaddr;
+    unsigned char len;
+
+    while (0 == isnull_hdr((const char *)src)) {
+        len = PEEK(src + 2);
+        nxtaddr = PEEKW(src + 3);
+        if (len != TBGAP_MARK) {  // skip the gap
+            POKE(dst + TBREC_LEN, len);
+            // next pointer as it will be after the text is moved up
+            POKEW(dst + TBREC_NEXT, dst + len + TBREC_SIZE + TBHDR_SIZE);
+            memmove(TBREC_TXTPTR(dst), (const void *)(src + 5), len + 1);
+            dst += len + TBREC_SIZE;
+        }
+        src = nxtaddr;
+    }
+    if (dst + TBHDR_SIZE + sizeof(null_txt_hdr) > END_BRAM) {
+        return 0;
+    }
+    memmove((void *)START_TEXT, (const void *)START_BRAM, dst - START_BRAM);
+    strcpy((char *)(dst + TBHDR_SIZE), null_txt_hdr);
+    tb_puthdr();
+
+    return 1;
+}
+
+/*
+ * Move text records from addr (after the gap) to the end of text in current
+ * part to the beginning of the next part. Room for them (and extra bytes)
+ * is made in the next part with doc_room(), so the following parts may
+ * spill their text as well.
+ * Text between the gap and addr is moved up, the gap grows by the size of
+ * moved records. Gap record is not written when there is no room.
+ * Return 0 if there is not enough room in the following parts.
+ */
+int tb_spillnext(uint16_t addr, uint16_t extra)
+{
+    uint16_t gs = gap_start, ge = gap_end, la = lastaddr;
+    uint16_t src = addr, dst, n;
+    unsigned int lines = 0;
+    unsigned char part = doc_curr;
+    int ret;
+
+    n = lastaddr - strlen(null_txt_hdr) - src;
+    while (0 == isnull_hdr((const char *)addr)) {
+        addr = TBREC_GETNXT(addr);
+        lines++;
+    }
+    // records go to the gap opened at the beginning of next part
+    doc_curr = part + 1;
+    doc_selbank(doc_banks[doc_curr]);
+    tb_getcache();
+    ret = doc_room(tb_first(), n + extra);
+    if (ret) {
+        dst = gap_start;
+        doc_xfer(doc_banks[part], src, doc_banks[doc_curr], dst, n);
+        gap_start = dst + n;
+        relink(dst, gap_start);
+        doc_nlines[doc_curr] += lines;
+    }
+    tb_fixgap();
+    tb_putcache();
+    // back in current part
+    doc_curr = part;
+    doc_selbank(doc_banks[part]);
+    gap_start = gs;
+    gap_end = ge;
+    lastaddr = la;
+    if (ret) {
+        // text after the gap is moved up to the end
+        memmove((void *)(gap_end + n), (const void *)gap_end, src - gap_end);
+        lidx_move(gap_end, src, n);
+        relink(gap_end + n, src + n);
+        gap_end += n;
+        doc_nlines[part] -= lines;
+        lidx_count = 0; // records moved, rebuild line index when needed
+    }
+
+    return ret;
+}
+
+/*
+ * Move text records from the 1-st one up to addr (before the gap) in current
+ * part to the end of text in the previous part. Room for them (and extra
+ * bytes) is made in the previous part with doc_room(), so the preceding
+ * parts may spill their text as well.
+ * Text between addr and the gap is moved down, the gap grows by the size of
+ * moved records. Gap record is not written when there is no room.
+ * Return 0 if there is not enough room in the preceding parts.
+ */
+int tb_spillprev(uint16_t addr, uint16_t extra)
+{
+    uint16_t gs = gap_start, ge = gap_end, la = lastaddr;
+    uint16_t src = START_TEXT, dst, n;
+    unsigned int lines = 0;
+    unsigned char part = doc_curr;
+    int ret;
+
+    n = addr - src;
+    while (src != addr) {
+        src = TBREC_GETNXT(src);
+        lines++;
+    }
+    src = START_TEXT;
+    // records go to the gap opened at the end of previous part
+    doc_curr = part - 1;
+    doc_selbank(doc_banks[doc_curr]);
+    tb_getcache();
+    ret = doc_room(lastaddr - strlen(null_txt_hdr), n + extra);
+    if (ret) {
+        dst = gap_start;
+        doc_xfer(doc_banks[part], src, doc_banks[doc_curr], dst, n);
+        gap_start = dst + n;
+        relink(dst, gap_start);
+        doc_nlines[doc_curr] += lines;
+    }
+    tb_fixgap();
+    tb_putcache();
+    // back in current part
+    doc_curr = part;
+    doc_selbank(doc_banks[part]);
+    gap_start = gs;
+    gap_end = ge;
+    lastaddr = la;
+    if (ret) {
+        // text before the gap is moved down to the beginning
+        memmove((void *)src, (const void *)addr, gap_start - addr);
+        lidx_move(addr, gap_start, 0 - n);
+        gap_start -= n;
+        relink(src, gap_start);
+        doc_nlines[part] -= lines;
+        lidx_count = 0; // records moved, rebuild line index when needed
+    }
+
+    return ret;
+}
+
+/*
+ * Select RAM bank. Text buffer state is not saved nor loaded.
+ */
+void doc_selbank(int bank)
+{
+    bank_num = bank;
+    __asm__("lda %v", bank_num);
+    __asm__("jsr %w", MOS_BANKEDRAMSEL);
+}
+
+/*
+ * Copy n bytes from address src in RAM bank from_bank to address dst in
+ * RAM bank to_bank. Text goes through xferbuf in chunks, so RAM banks are
+ * switched twice per chunk, not per text record. RAM bank to_bank is left
+ * selected, text buffer state is not saved nor loaded.
+ */
+void doc_xfer(int from_bank, uint16_t src,
+              int to_bank, uint16_t dst, uint16_t n)
+{
+    uint16_t i, chunk;
+
+    for (i = 0; i < n; i += chunk) {
+        chunk = (n - i < XFERBUF_SIZE) ? n - i : XFERBUF_SIZE;
+        doc_selbank(from_bank);
+        memcpy(xferbuf, (const void *)(src + i), chunk);
+        doc_selbank(to_bank);
+        memcpy((void *)(dst + i), xferbuf, chunk);
+    }
+    doc_selbank(to_bank);
+}
+
+/*
+ * Select RAM bank of the part of document. State of the text buffer in
+ * current part is stored in its header, state of the selected part is
+ * loaded from its header.
+ */
+void doc_select(unsigned char part)
+{
+    if (bank_num != doc_banks[part]) {
+        tb_putcache();
+        doc_selbank(doc_banks[part]);
+        tb_getcache();
+    }
+    doc_curr = part;
+}
+
+/*
+ * If addr is the null header at the end of text in current part, select
+ * the next part with text and return address of its 1-st text record.
+ * Empty parts are skipped without selecting their RAM banks.
+ * At the end of document the null header is returned.
+ */
+uint16_t doc_skip(uint16_t addr)
+{
+    unsigned char part = doc_curr + 1;
+
+    if (isnull_hdr((const char *)addr)) {
+        while (part < doc_nparts && 0 == doc_nlines[part]) {
+            part++;
+        }
+        if (part < doc_nparts) {
+            doc_select(part);
+            addr = tb_first();
+        }
+    }
+
+    return addr;
+}
+
+/*
+ * Return address of the text record following the one at addr in the
+ * document. RAM bank of the next part is selected if needed.
+ */
+uint16_t doc_next(uint16_t addr)
+{
+    return doc_skip(tb_next(addr));
+}
+
+/*
+ * Return address of the 1-st text record of the document (or null header
+ * if no text). RAM bank of the part is selected.
+ */
+uint16_t doc_first(void)
+{
+    doc_select(0);
+
+    return doc_skip(tb_first());
+}
+
+/*
+ * Move the gap in current part to addr and make at least need bytes free
+ * in it by moving just enough of the last text records of the part to the
+ * following parts, or of the 1-st text records to the preceding parts.
+ * Gap record is not written.
+ * Return 0 if it is not possible.
+ */
+int doc_room(uint16_t addr, uint16_t need)
+{
+    uint16_t nul;
+
+    tb_movegap(addr);
+    if (tb_free() >= need) {
+        return 1;
+    }
+    need -= tb_free();
+    // move the last records to the next part
+    nul = lastaddr - strlen(null_txt_hdr);
+    addr = gap_end;
+    if (doc_curr + 1 < doc_nparts && nul - addr >= need) {
+        while (nul - TBREC_GETNXT(addr) >= need) {
+            addr = TBREC_GETNXT(addr);
+        }
+        if (tb_spillnext(addr, 0)) {
+            return 1;
+        }
+    }
+    // move the 1-st records to the previous part
+    addr = START_TEXT;
+    if (doc_curr > 0 && gap_start - addr >= need) {
+        while (addr - START_TEXT < need) {
+            addr = TBREC_GETNXT(addr);
+        }
+        return tb_spillprev(addr, 0);
+    }
+
+    return 0;
+}
+
+/*
+ * Insert text record from CurrLine (text and len must be set) before the
+ * text record at addr (or null header) in current part.
+ * If the part is full, room is made by moving text records of the part to
+ * the neighbour parts. If there is not enough text after addr, the new
+ * record goes to the beginning of the next part, after the following
+ * records of current part were moved there.
+ * Return address of the new text record (its part is selected) or 0 if
+ * there is no room.
+ */
+uint16_t doc_insert(uint16_t addr)
+{
+    uint16_t ret = tb_insert(addr);
+    uint16_t need = CurrLine.len + TBREC_SIZE;
+
+    if (ret) {
+        return ret;
+    }
+    if (doc_room(addr, need)) {
+        ret = tb_insert(gap_end);
+    } else if (doc_curr + 1 < doc_nparts && tb_spillnext(gap_end, need)) {
+        tb_fixgap();
+        doc_select(doc_curr + 1);
+        ret = tb_insert(tb_first());
+    }
+    if (0 == ret) {
+        tb_fixgap();    // no room, leave the gap record valid
+    }
+
+    return ret;
+}
+
+/*
+ * Replace text of line# line with text record from CurrLine (text and len
+ * must be set). The old record goes to the gap, the new one is written at
+ * the gap start. Room for longer text is made in the neighbour parts.
+ * Return 0 if there is no room (the line is not changed).
+ */
+int doc_putline(unsigned int line)
+{
+    uint16_t rec;
+    uint16_t need = CurrLine.len + TBREC_SIZE;
+
+    goto_line(line);
+    tb_movegap(curr_addr);
+    rec = gap_end;
+    gap_end = TBREC_GETNXT(rec);    // record goes to the gap
+    if (tb_free() < need && 0 == doc_room(gap_end, need)) {
+        gap_end = rec;              // it is still there
+        tb_fixgap();
+        return 0;
+    }
+    CurrLine.next_ptr = gap_start + need;
+    write_text2mem(gap_start);
+    lidx_move(rec, rec + 1, gap_start - rec);   // anchor of the line
+    gap_start = CurrLine.next_ptr;
+    tb_fixgap();
+    tb_putcache();
+    find_count = 0;
+
+    return 1;
+}
+
+/*
+ * Close the gap in all parts of document.
+ */
+void doc_closegap(void)
+{
+    unsigned char part;
+
+    for (part = 0; part < doc_nparts; part++) {
+        doc_select(part);
+        tb_closegap();
+    }
+}
+
+/*
+ * Select RAM bank of the 1-st part of document the text buffer in current
+ * RAM bank belongs to and make it the only known part of document.
+ * Other parts are found by checkbuf().
+ */
+void doc_head(void)
+{
+    int bank, prev;
+    unsigned char i;
+
+    bank_num = *RAMBANKNUM;
+    for (i = 0; i < DOC_MAXPARTS && TB_HDROK; i++) {
+        bank = TBHDR_GETB(TBHDR_PRVBANK) - 1;
+        if (bank < 0 || bank > 7) {
+            break;
+        }
+        prev = bank_num;
+        doc_selbank(bank);
+        if (0 == TB_HDROK || TBHDR_GETB(TBHDR_NXTBANK) != prev + 1) {
+            doc_selbank(prev);  // links don't match, stay in this bank
+            break;
+        }
+    }
+    doc_banks[0] = bank_num;
+    doc_nlines[0] = 0;
+    doc_nparts = 1;
+    doc_curr = 0;
+}
+
+/*
+ *  Return non-zero if addr is out of range START_BRAM .. END_BRAM.
+ */
+int isaddr_oor(uint16_t addr)
+{
+    if (addr < START_BRAM || addr >= END_BRAM)
+    {
+        prnerror(ERROR_ADDROOR);
+        puts("addr = $");
+        puts(utoa(addr, ibuf1, RADIX_HEX));
+        puts("\n\r");
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Return non-zero if the text record header pointed by hdr is a null header.
+ */
+int isnull_hdr(const char *hdr)
+{
+    int i = 1;
+    int ret = 1;
+
+    if (hdr == NULL
+        || hdr[0] != null_txt_hdr[0]
+        || strlen(hdr) < strlen(null_txt_hdr)) {
+        ret = 0;
+    } else {
+        while(hdr[i] != 0 && null_txt_hdr[i] != 0) {
+            if (hdr[i] != null_txt_hdr[i]) {
+                ret = 0;
+                break;
+            }
+            i++;
+        }
+    }
+
+    return ret;
+}
+
+/*
+ * Pause specified # of 1/64-ths of a second.
+ */
+void pause_sec64(uint16_t delay)
+{
+    // current timer + desired delay in 1/64 sec intervals
+    // will be the number we wait for in a loop
+    unsigned long t64hz = *TIMER64HZ + delay;
+
+    if (RTCDETECTED) {
+        while (*TIMER64HZ < t64hz) {
+            // Intentionally EMPTY
+        }
+    }
+}
+
+/*
+ * Set global variable tmr64 to a value that will be reached by system timer
+ * after certain # of seconds (secs).
+ */
+void set_timeout(int secs)
+{
+    if (RTCDETECTED) {
+        tmr64 = *TIMER64HZ + (secs * 64);
+    }
+}
+
+/*
+ * Return 1 if the timeout set by set_timeout() function has expired.
+ */
+int is_timeout(void)
+{
+    int ret = 0;
+
+    if (RTCDETECTED) {
+        if (tmr64 < *TIMER64HZ) {
+            ret = 1;
+        }
+    }
+
+    return ret;
+}
+
+// Command parsing helpers.
+/*
+ * Advance index to next token.
+ */
+int adv2nxttoken(int idx)
+{
+    while (prompt_buf[idx] == 32) {
+        idx++;
+    }
+
+    return idx;
+}
+
+/*
+ * Advance index to next space.
+ */
+int adv2nextspc(int idx)
 {
     while (prompt_buf[idx] != 0) {
 
-        if (prompt_buf[idx] == 32
-            || prompt_buf[idx] == '-') {
+        if (prompt_buf[idx] == 32
+            || prompt_buf[idx] == '-') {
+
+            prompt_buf[idx] = 0;
+            idx++;
+            break;
+        }
+        idx++;
+    }
+
+    return idx;
+}
+
+/* print error message in a separate line */
+void prnerror(int errnum)
+{
+    puts("\n\rERROR: ");
+    puts(ga_errmsg[errnum]);
+    puts("\r\n");
+}
+
+/* get line of text from input */
+void getline(void)
+{
+    memset(prompt_buf, 0, PROMPTBUF_SIZE);
+    gets(prompt_buf);
+    puts("\n\r");
+}
+
+/* parse the input buffer, set command code */
+void parse_cmd(void)
+{
+    if (0 == strlen(prompt_buf)) {
+        cmd_code = CMD_NULL;
+    }
+    else if (*prompt_buf == 'l') {
+        cmd_code = CMD_LIST;
+    }
+    else if (*prompt_buf == 'a') {
+        cmd_code = CMD_ADD;
+    }
+    else if (0 == strncmp(prompt_buf, "g ", 2)) {
+        cmd_code = CMD_GOTO;
+    }
+    else if (*prompt_buf == 'd') {
+        cmd_code = CMD_DELETE;
+    }
+    else if (*prompt_buf == 's') {
+        cmd_code = CMD_SELECT;
+    }
+    else if (*prompt_buf == 'h') {
+        cmd_code = CMD_HELP;
+    }
+    else if (*prompt_buf == 'p') {
+        cmd_code = CMD_COPY;
+    }
+    else if (1 == strlen(prompt_buf) && *prompt_buf == 'x') {
+        cmd_code = CMD_EXIT;
+    }
+    else if (1 == strlen(prompt_buf) && *prompt_buf == 'e') {
+        cmd_code = CMD_ERASE;
+    }
+    else if (*prompt_buf == 't') {
+        cmd_code = CMD_DTTM;
+    }
+    else if (*prompt_buf == 'b') {
+        cmd_code = CMD_BANK;
+    }
+    else if (*prompt_buf == 'm') {
+        cmd_code = CMD_INFO;
+    }
+    else if (*prompt_buf == 'i') {
+        cmd_code = CMD_INSERT;
+    }
+    else if (*prompt_buf == 'c') {
+        cmd_code = CMD_CUTSEL;
+    }
+    else if (*prompt_buf == 'f') {
+        cmd_code = CMD_FIND;
+    }
+    else if (*prompt_buf == 'k') {
+        cmd_code = CMD_LINK;
+    }
+    else if (*prompt_buf == 'r') {
+        cmd_code = CMD_REPLACE;
+    }
+    else if (0 == strncmp(prompt_buf, "u bin", 5)) {
+        cmd_code = CMD_IMPORT;
+    }
+    else if (*prompt_buf == 'u') {
+        cmd_code = CMD_INGEST;
+    }
+    else if (*prompt_buf == 'w') {
+        cmd_code = CMD_EXPORT;
+    }
+    else if (*prompt_buf == 'v') {
+        cmd_code = CMD_VISUAL;
+    }
+    else
+        cmd_code = CMD_UNKNOWN;
+}
+
+#pragma code-name (push, "OVERLAY1")
+#pragma rodata-name (push, "OVERLAY1")
+
+const char ovl_sigmisc[] = __DATE__ " " __TIME__;
+
+// Usage help.
+const char * const helptext[64] =
+{
+    "\n\r",
+    " b : select / show current file # (bank #).\n\r",
+    "     b [00..07]\n\r",
+    " k : link RAM bank to the end of the file (file spans banks).\n\r",
+    "     k <0..7>\n\r",
+    "     NOTE: text in the linked bank is erased.\n\r",
+    "     RAM banks 4 and 5 are reserved (clipboard, overlays).\n\r",
+    " l : List text buffer contents.\n\r",
+    "     l all [n] | sel [n] | clb | fnd [n] |\n\r",
+    "       [from_line#[-to_line# | -end]] [n]\n\r",
+    "      n - show line numbers\n\r",
+    "      all - list all content\n\r",
+    "      sel - list only selected content\n\r",
+    "      clb - list clipboard contents\n\r",
+    "      fnd - list lines found by 'f all'\n\r",
+    " a : start adding text at the end of buffer.\n\r",
+    " u : upload text at the end of buffer (fast, no echo).\n\r",
+    "     Send lines of text, then '@EOT' line. Sender must obey\n\r",
+    "     XON/XOFF flow control.\n\r",
+    "     u bin - import text exported with 'w'.\n\r",
+    " w : export text to host (binary, use tbconv to convert\n\r",
+    "     it to a text file and back).\n\r",
+    "     NOTE: 'u', 'w' - terminal must transfer binary data.\n\r",
+    " v : full screen editing (ANSI terminal, 80x24), starts at\n\r",
+    "     current line. Arrows, PgUp / PgDn, BS, ENTER, ^Y - delete\n\r",
+    "     line, ^X - back to the command prompt.\n\r",
+    " i : start inserting text at line# (or current line).\n\r",
+    "     i [line#]\n\r",
+    "     NOTE: 'a' and 'i' functions - type '@EOT' in a new line\n\r",
+    "           and press ENTER to finish and exit to command prompt.\n\r",
+    " g : go to specified line in text buffer.\n\r",
+    "     g start | end | fnd [#] | [line#]\n\r",
+    "      fnd - #-th line found by 'f all' (next one if no #)\n\r",
+    " d : delete text.\n\r",
+    "     d [from_line#[-to_line# | -end]]\n\r",
+    " s : select text. (copies to clipboard)\n\r",
+    "     s [from_line#[-to_line# | -end]]\n\r",
+    " c : delete (cut) selection.\n\r",
+    " p : copy selected text.\n\r",
+    "     p [line#]\n\r",
+    " x : exit editor, leave text in buffer.\n\r",
+    " e : erase all text.\n\r",
+    " t : insert current date / time.\n\r",
+    " m : show file and memory information.\n\r",
+    "     Current file # (memory bank #).\n\r",
+    "     # of lines in file.\n\r",
+    "     Next free address (hex) in buffer.\n\r",
+    "     Free memory in current buffer.\n\r",
+    " f : find a text, search starts in next line from current.\n\r",
+    "     Move cursor to the line of occurrence if found.\n\r",
+    "     f [text]\n\r",
+    "     f all [text] - find all lines with the text.\n\r",
+    "     List / go to them: l fnd [n], g fnd [#].\n\r",
+    " r : replace text in all lines.\n\r",
+    "     r /text/new_text/ ('/' - any character not in texts)\n\r",
+    "NOTE:\n\r",
+    "   Default line#, from_line#, to_line# is the current line.\n\r",
+    "   Arguments are <mandatory> OR [optional].\n\r",
+    "   When range is provided, SPACE can be used instead of '-'.\n\r",
+    "   Argument 'text' can contain spaces.\n\r",
+    "   'start' - 1-st line of text, 'end' - last line of text.\n\r",
+    "\n\r",
+    "@EOH"
+};
+
+/* print help */
+void texted_help(void)
+{
+    unsigned char cont = 1, i = 0;
+
+    while(cont)
+    {
+        if (0 == strncmp(helptext[i],"@EOH",4))
+            cont = 0;
+        else {
+            //puts("   ");  // 3 spaces
+            puts(helptext[i++]);
+        }
+        if (0 == (i%22)) {
+            puts("\n\r");
+            puts("Press any key to continue...");
+            while(!kbhit());    // wait for key press...
+            getc();            // consume key
+            puts("\n\r\n\r");
+        }
+    }
+}
+
+#pragma rodata-name (pop)
+#pragma code-name (pop)
+
+/*
+ * Copy overlay ovl from its slot in OVL_BANK to the overlay area, unless
+ * it is there already. Return non-zero if the overlay can be run.
+ * Overlay functions may call resident functions, but not each other.
+ */
+int ovl_load(unsigned char ovl)
+{
+    if (ovl != ovl_curr) {
+        doc_selbank(OVL_BANK);
+        memcpy(ovl_run[ovl], (const void *)(START_BRAM + ovl * OVL_SLOT),
+               (unsigned)ovl_size[ovl]);
+        doc_selbank(doc_banks[doc_curr]);
+        ovl_curr = strcmp(ovl_sigs[ovl], ovl_sig) ? OVL_NONE : ovl;
+    }
+    if (ovl != ovl_curr) {
+        prnerror(ERROR_NOOVL);
+        return 0;
+    }
 
-            prompt_buf[idx] = 0;
-            idx++;
+    return 1;
+}
+
+/*
+ * Execute command.
+ */
+int exec_cmd(void)
+{
+    int ret = 1;
+
+    switch (cmd_code)
+    {
+        case CMD_NULL:
+            break;
+        case CMD_UNKNOWN:
+            prnerror(ERROR_BADCMD);
+            break;
+        case CMD_EXIT:
+            doc_closegap();
+            puts("Bye!\n\r");
+            ret = 0;
+            break;
+        case CMD_HELP:
+            if (ovl_load(OVL_MISC)) {
+                texted_help();
+            }
+            break;
+        case CMD_ADD:
+            texted_add();
+            break;
+        case CMD_INGEST:
+            if (ovl_load(OVL_XFER)) {
+                texted_ingest();
+            }
+            break;
+        case CMD_EXPORT:
+            if (ovl_load(OVL_XFER)) {
+                texted_export();
+            }
+            break;
+        case CMD_IMPORT:
+            if (ovl_load(OVL_XFER)) {
+                texted_import();
+            }
+            break;
+        case CMD_VISUAL:
+            if (ovl_load(OVL_VISUAL)) {
+                texted_visual();
+            }
+            break;
+        case CMD_LIST:
+            texted_list();
+            break;
+        case CMD_GOTO:
+            texted_goto();
+            break;
+        case CMD_DELETE:
+            texted_delete();
+            break;
+        case CMD_ERASE:
+            texted_initbuf();
+            break;
+        case CMD_BANK:
+            texted_membank();
+            break;
+        case CMD_INFO:
+            texted_info();
+            break;
+        case CMD_SELECT:
+            texted_select();
+            break;
+        case CMD_CUTSEL:
+            texted_cut();
+            break;
+        case CMD_INSERT:
+            texted_insert();
+            break;
+        case CMD_COPY:
+            texted_copy();
+            break;
+        case CMD_FIND:
+            if (ovl_load(OVL_FIND)) {
+                texted_find();
+            }
+            break;
+        case CMD_REPLACE:
+            if (ovl_load(OVL_FIND)) {
+                texted_replace();
+            }
+            break;
+        case CMD_DTTM:
+            if (ovl_load(OVL_MISC)) {
+                texted_insdttm();
+            }
+            break;
+        case CMD_LINK:
+            texted_link();
+            break;
+        default:
+            break;
+    }
+
+    return ret;
+}
+
+/*
+ *  Add text at the end of the text buffer.
+ */
+void texted_add(void)
+{
+    uint16_t addr;
+    unsigned char part = doc_nparts - 1;
+
+    if (0 == checkbuf()) {
+        return;
+    }
+    // Position current address at the NULL line after text in the last
+    // part with text.
+    while (part > 0 && 0 == doc_nlines[part]) {
+        part--;
+    }
+    doc_select(part);
+    curr_addr = lastaddr - strlen(null_txt_hdr);
+    line_num = line_count;
+    prninfo_addtext();
+    while (1) {
+        // get line of text from user input
+        getline();
+        if (0 == strncmp(eot_str, prompt_buf, strlen(eot_str))) {
+            break;  // user entered command to end text entry
+        }
+        strcpy (CurrLine.text, prompt_buf);
+        CurrLine.len = strlen(prompt_buf);
+        addr = doc_insert(curr_addr);
+        if (0 == addr) {
+            // Text buffer full, terminate text entry here.
+            // User must still enter '@EOT' to exit loop.
+            // This is to prevent entering accidental command while loading
+            // text via serial port and buffer overflows while input data is
+            // still coming. Instead ignore all incoming text after
+            // buffer was filled until end-of-text command is entered.
+            while(1) {
+                prnerror(ERROR_FULLBUF);
+                getline();
+                if (0 == strncmp(eot_str, prompt_buf, strlen(eot_str))) {
+                    break;  // user entered command to end text entry
+                }
+            }
             break;
         }
-        idx++;
+        lidx_append(line_num, addr);
+        line_num++;
+        curr_addr = tb_next(addr);
+    }
+    checkbuf(); // update globals after text buffer was altered
+}
+
+/*
+ * Return next character from the UART RX queue. Characters are taken
+ * straight from the queue, so binary data can be received.
+ * Sender is paused with XOFF when the queue fills up and resumed with XON
+ * when the queue drains. Wait at most secs seconds (0 - forever) for
+ * the character, return -1 on timeout.
+ */
+int rx_getc(int secs)
+{
+    unsigned char level, c;
+    unsigned char wait = 0;
+
+    while (1) {
+        level = *UARTRXINPT - *UARTRXOUTPT;
+        if (level >= RXQ_HIWATER) {
+            rx_pause();
+            if (255 == level && 0 == rx_qfull) {
+                rx_overflows++; // UART IRQ handler drops characters now
+            }
+        } else if (rx_xoff && level <= RXQ_LOWATER) {
+            putchar(XON);
+            rx_xoff = 0;
+        }
+        rx_qfull = (255 == level);
+        if (level) {
+            break;
+        }
+        if (secs) {
+            if (0 == wait) {
+                set_timeout(secs);
+                wait = 1;
+            } else if (is_timeout()) {
+                return -1;
+            }
+        }
+    }
+    c = UARTRXQUE[*UARTRXOUTPT];
+    (*UARTRXOUTPT)++;
+
+    return c;
+}
+
+/*
+ * Pause the sender (send XOFF) before something that takes a while.
+ * It is resumed by rx_getc() when RX queue is drained.
+ */
+void rx_pause(void)
+{
+    if (0 == rx_xoff) {
+        putchar(XOFF);
+        rx_xoff = 1;
+    }
+}
+
+#pragma code-name (push, "OVERLAY3")
+#pragma rodata-name (push, "OVERLAY3")
+
+const char ovl_sigxfer[] = __DATE__ " " __TIME__;
+
+/*
+ * Prepare text of the last part with text for adding text records
+ * at its end: the gap is moved to the end of text.
+ */
+void ingest_init(void)
+{
+    unsigned char part = doc_nparts - 1;
+
+    while (part > 0 && 0 == doc_nlines[part]) {
+        part--;
+    }
+    doc_select(part);
+    tb_movegap(lastaddr - strlen(null_txt_hdr));
+    line_num = line_count;
+    rx_overflows = 0;
+}
+
+/*
+ * Make room for a text record of need bytes at the gap start, which is at
+ * the end of text. When current part is full, text continues in the next
+ * (empty) part or the 1-st text records of current part are moved to the
+ * previous parts.
+ * Return 0 if there is no room left in the document.
+ */
+int ingest_room(uint16_t need)
+{
+    if (gap_end - gap_start >= need) {
+        return 1;
+    }
+    rx_pause();     // moving text takes a while
+    if (doc_curr + 1 < doc_nparts) {
+        tb_fixgap();
+        doc_select(doc_curr + 1);
+        tb_movegap(lastaddr - strlen(null_txt_hdr));
+
+        return (gap_end - gap_start >= need);
+    }
+
+    return doc_room(gap_end, need);
+}
+
+/*
+ * Text of len characters (null terminated) was written at the text of
+ * record at the gap start. Complete the record header and add the record
+ * to the text.
+ */
+void ingest_putrec(unsigned char len)
+{
+    uint16_t rec = gap_start;
+
+    POKE(rec + TBREC_LEN, len);
+    gap_start = rec + len + TBREC_SIZE;
+    POKEW(rec + TBREC_NEXT, gap_start);
+    doc_nlines[doc_curr]++;
+    lidx_append(line_count++, rec);
+}
+
+/*
+ * Leave the text buffer consistent after adding text records at the gap
+ * and resume the sender.
+ */
+void ingest_done(void)
+{
+    if (rx_xoff) {
+        putchar(XON);
+        rx_xoff = 0;
+    }
+    tb_fixgap();
+    tb_putcache();
+    if (rx_overflows) {
+        puts("WARNING: RX queue overflow, input lost ");
+        puts(utoa(rx_overflows, ibuf1, RADIX_DEC));
+        puts(" time(s).\n\r");
+    }
+}
+
+/*
+ * Upload text at the end of the text buffer.
+ * Characters are taken straight from the UART RX queue, without echo, and
+ * written as text of the record at the gap start, which is at the end of
+ * text. Record header is completed when the end of line arrives, until
+ * '@EOT' line is received.
+ * Sender is paused with XOFF when RX queue fills up (or text records are
+ * being moved to make room) and resumed with XON when the queue drains.
+ * Lines longer than TEXTLINE_SIZE-1 characters are truncated, lines that
+ * don't fit in the document are dropped.
+ */
+void texted_ingest(void)
+{
+    unsigned char c, full;
+    unsigned char len = 0, prev = 0, over = 0;
+    unsigned int lines = 0, dropped = 0, truncated = 0;
+    unsigned long ticks;
+    char *txt;
+
+    if (0 == checkbuf()) {
+        return;
+    }
+    ingest_init();
+    full = (0 == ingest_room(INGEST_ROOM));
+    txt = full ? CurrLine.text : TBREC_TXTPTR(gap_start);
+    puts("\n\rSend text, end with '@EOT' line.\n\r");
+    c = rx_getc(0);
+    ticks = *TIMER64HZ; // time is measured from the 1-st character received
+    while (1) {
+        if (c >= ' ' || c == '\t') {
+            if (len < TEXTLINE_SIZE - 1) {
+                txt[len++] = c;
+            } else {
+                over = 1;
+            }
+        } else if (c == '\r' || (c == '\n' && prev != '\r')) {
+            // end of line
+            txt[len] = 0;
+            if (0 == strcmp(txt, eot_str)) {
+                break;
+            }
+            if (full) {
+                dropped++;
+            } else {
+                ingest_putrec(len);
+                lines++;
+                full = (0 == ingest_room(INGEST_ROOM));
+                txt = full ? CurrLine.text : TBREC_TXTPTR(gap_start);
+            }
+            truncated += over;
+            len = 0;
+            over = 0;
+        }
+        prev = c;
+        c = rx_getc(0);
+    }
+    ticks = *TIMER64HZ - ticks;
+    ingest_done();
+    puts(utoa(lines, ibuf1, RADIX_DEC));
+    puts(" lines, ");
+    puts(utoa(ticks ? (unsigned int)((lines * 64UL) / ticks) : lines,
+              ibuf1, RADIX_DEC));
+    puts(" lines/s.\n\r");
+    if (dropped) {
+        puts("Buffer full, ");
+        puts(utoa(dropped, ibuf1, RADIX_DEC));
+        puts(" lines dropped.\n\r");
+    }
+    if (truncated) {
+        puts(utoa(truncated, ibuf1, RADIX_DEC));
+        puts(" lines truncated (too long).\n\r");
+    }
+    checkbuf(); // update globals after text buffer was altered
+}
+
+/*
+ * Build CRC-16 (polynomial $1021, XMODEM) lookup tables.
+ */
+void crc_init(void)
+{
+    unsigned int i, crc;
+    unsigned char bit;
+
+    for (i = 0; i < 256; i++) {
+        crc = i << 8;
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+        crc_tabhi[i] = crc >> 8;
+        crc_tablo[i] = crc & 0xFF;
+    }
+}
+
+/*
+ * Send byte b of a frame to host, DLE-escape it if needed. Update CRC.
+ */
+void xfer_putc(unsigned char b)
+{
+    CRC_ADD(b);
+    if (b == XFER_SOH || b == XFER_DLE || b == XON || b == XOFF) {
+        putchar(XFER_DLE);
+        b ^= XFER_ESCXOR;
+    }
+    putchar(b);
+}
+
+/*
+ * Send n bytes of memory starting at addr in a frame to host.
+ */
+void xfer_putmem(uint16_t addr, uint16_t n)
+{
+    for ( ; n > 0; n--) {
+        xfer_putc(PEEK(addr++));
+    }
+}
+
+/*
+ * Start a frame of type and len bytes of data.
+ */
+void xfer_begin(unsigned char type, uint16_t len)
+{
+    putchar(XFER_SOH);
+    crc_hi = 0;
+    crc_lo = 0;
+    xfer_putc(type);
+    xfer_putc(len & 0xFF);
+    xfer_putc(len >> 8);
+}
+
+/*
+ * End the frame - send CRC.
+ */
+void xfer_end(void)
+{
+    unsigned char hi = crc_hi, lo = crc_lo;
+
+    xfer_putc(hi);
+    xfer_putc(lo);
+}
+
+/*
+ * Return next (unescaped) byte of a frame from host, update CRC.
+ * If the byte doesn't come in time or a new frame starts, xfer_err is set
+ * and 0 is returned, so is by all calls after that.
+ */
+unsigned char xfer_getc(void)
+{
+    int c;
+
+    if (xfer_err) {
+        return 0;
+    }
+    c = rx_getc(XFER_TIMEOUT);
+    if (XFER_DLE == c) {
+        c = rx_getc(XFER_TIMEOUT);
+        if (c >= 0) {
+            c ^= XFER_ESCXOR;
+        }
+    } else if (XFER_SOH == c) {
+        xfer_err = XFER_ERRSOH;
+        return 0;
+    }
+    if (c < 0) {
+        xfer_err = XFER_ERRTMO;
+        return 0;
+    }
+    CRC_ADD((unsigned char)c);
+
+    return c;
+}
+
+/*
+ * Export the document to host. Text records of each part are sent as
+ * they are, in a frame with CRC (see XFER_SOH), no text is moved.
+ */
+void texted_export(void)
+{
+    unsigned char part;
+    uint16_t tail, n1, n2;
+    unsigned long bytes = 0;
+
+    if (0 == checkbuf()) {
+        return;
+    }
+    crc_init();
+    puts("Start binary capture on host, then press ENTER.\n\r");
+    getline();
+    for (part = 0; part < doc_nparts; part++) {
+        doc_select(part);
+        tail = lastaddr - strlen(null_txt_hdr);
+        if (gap_start) {
+            n1 = gap_start - START_TEXT;
+            n2 = tail - gap_end;
+        } else {
+            n1 = tail - START_TEXT;
+            n2 = 0;
+        }
+        if (n1 + n2) {
+            xfer_begin(XFER_RECORDS, n1 + n2);
+            xfer_putmem(START_TEXT, n1);
+            xfer_putmem(gap_end, n2);
+            xfer_end();
+            bytes += n1 + n2;
+        }
+    }
+    xfer_begin(XFER_END, 2);
+    xfer_putc(line_count & 0xFF);
+    xfer_putc(line_count >> 8);
+    xfer_end();
+    puts("\n\rExported ");
+    puts(utoa(line_count, ibuf1, RADIX_DEC));
+    puts(" lines, ");
+    puts(ultoa(bytes, ibuf1, RADIX_DEC));
+    puts(" bytes.\n\r");
+    if (line_count) {
+        goto_line(line_num);
     }
-
-    return idx;
-}
-
-/* print error message in a separate line */
-void prnerror(int errnum)
-{
-    puts("\n\rERROR: ");
-    puts(ga_errmsg[errnum]);
-    puts("\r\n");
 }
 
-/* get line of text from input */
-void getline(void)
+/*
+ * Import text exported by texted_export() (or made by host tool tbconv)
+ * at the end of the text buffer. Text records are written directly at
+ * the gap as they are received, as in texted_ingest().
+ * Frames with bad CRC are reported, the text in them is kept.
+ */
+void texted_import(void)
 {
-    memset(prompt_buf, 0, PROMPTBUF_SIZE);
-    gets(prompt_buf);
-    puts("\n\r");
-}
+    unsigned char type, reclen, i, c, full;
+    unsigned char hi, lo, bad = 0;
+    uint16_t len, n, addr;
+    unsigned int lines = 0, total = 0, dropped = 0, crcerrs = 0;
+    int ch;
 
-/* parse the input buffer, set command code */
-void parse_cmd(void)
-{
-    if (0 == strlen(prompt_buf)) {
-        cmd_code = CMD_NULL;
+    if (0 == checkbuf()) {
+        return;
     }
-    else if (*prompt_buf == 'l') {
-        cmd_code = CMD_LIST;
+    ingest_init();
+    crc_init();
+    full = 0;
+    puts("\n\rSend exported data from host.\n\r");
+    // skip everything up to the 1-st frame
+    do {
+        ch = rx_getc(XFER_WAIT);
+    } while (ch >= 0 && ch != XFER_SOH);
+    xfer_err = (ch < 0) ? XFER_ERRTMO : XFER_ERRSOH;
+    while (XFER_ERRSOH == xfer_err) {
+        // start of frame received
+        xfer_err = 0;
+        crc_hi = 0;
+        crc_lo = 0;
+        type = xfer_getc();
+        len = xfer_getc();
+        len |= (uint16_t)xfer_getc() << 8;
+        if (XFER_RECORDS == type) {
+            for (n = 0; 0 == xfer_err && n < len; n += reclen + TBREC_SIZE) {
+                reclen = xfer_getc();
+                xfer_getc();    // next pointer, set when record is added
+                xfer_getc();
+                if (0 == full) {
+                    full = (0 == ingest_room(reclen + TBREC_SIZE));
+                }
+                addr = (uint16_t)TBREC_TXTPTR(gap_start);
+                for (i = 0; i <= reclen; i++) {
+                    c = xfer_getc();
+                    if ((0 == c) != (i == reclen)) {
+                        bad = 1;    // text must be null terminated
+                    }
+                    if (0 == full) {
+                        POKE(addr + i, c);
+                    }
+                }
+                if (bad || xfer_err) {
+                    break;
+                }
+                if (full) {
+                    dropped++;
+                } else {
+                    ingest_putrec(reclen);
+                    lines++;
+                }
+            }
+        } else if (XFER_END == type) {
+            total = xfer_getc();
+            total |= (uint16_t)xfer_getc() << 8;
+        } else {
+            bad = 1;
+        }
+        hi = crc_hi;
+        lo = crc_lo;
+        if (xfer_getc() != hi || xfer_getc() != lo) {
+            bad = 1;
+        }
+        if (bad || xfer_err) {
+            crcerrs++;
+            bad = 0;
+        } else if (XFER_END == type) {
+            break;
+        }
+        if (0 == xfer_err) {
+            // skip to the next frame (the rest of bad frame)
+            do {
+                ch = rx_getc(XFER_TIMEOUT);
+            } while (ch >= 0 && ch != XFER_SOH);
+            xfer_err = (ch < 0) ? XFER_ERRTMO : XFER_ERRSOH;
+        }
     }
-    else if (*prompt_buf == 'a') {
-        cmd_code = CMD_ADD;
+    ingest_done();
+    puts(utoa(lines, ibuf1, RADIX_DEC));
+    puts(" lines imported.\n\r");
+    if (XFER_ERRTMO == xfer_err) {
+        puts("Timeout, end of data not received.\n\r");
+    } else if (lines + dropped != total) {
+        puts("WARNING: ");
+        puts(utoa(total, ibuf1, RADIX_DEC));
+        puts(" lines were exported.\n\r");
     }
-    else if (0 == strncmp(prompt_buf, "g ", 2)) {
-        cmd_code = CMD_GOTO;
+    if (crcerrs) {
+        puts(utoa(crcerrs, ibuf1, RADIX_DEC));
+        puts(" bad frame(s) (CRC or format error).\n\r");
     }
-    else if (*prompt_buf == 'd') {
-        cmd_code = CMD_DELETE;
+    if (dropped) {
+        puts("Buffer full, ");
+        puts(utoa(dropped, ibuf1, RADIX_DEC));
+        puts(" lines dropped.\n\r");
     }
-    else if (*prompt_buf == 's') {
-        cmd_code = CMD_SELECT;
+    checkbuf(); // update globals after text buffer was altered
+}
+
+#pragma rodata-name (pop)
+#pragma code-name (pop)
+
+#pragma code-name (push, "OVERLAY4")
+#pragma rodata-name (push, "OVERLAY4")
+
+const char ovl_sigvisual[] = __DATE__ " " __TIME__;
+const char scr_help[] = "^X exit, ^Y delete line, ^B / ^F page up / down";
+const char scr_full[] = "Buffer full, line not changed.";
+
+/*
+ * Move terminal cursor to row, col of the screen (counted from 0) unless
+ * it is already there.
+ */
+void scr_gotoxy(unsigned char row, unsigned char col)
+{
+    if (row != scr_crow || col != scr_ccol) {
+        ansi_set_cursor(col + 1, row + 1);
+        scr_crow = row;
+        scr_ccol = col;
     }
-    else if (*prompt_buf == 'h') {
-        cmd_code = CMD_HELP;
+}
+
+/*
+ * Show text in the row of the screen. Only the span of characters that
+ * differ from the shadow copy of the row is sent, the rest of a longer old
+ * text is cleared. Control characters are shown as spaces.
+ */
+void scr_putrow(unsigned char row, const char *text)
+{
+    char *shadow = scr_shadow[row];
+    unsigned char lo, hi, len;
+    unsigned char oldlen = strlen(shadow);
+
+    for (len = 0; text[len] && len < SCR_COLS - 1; len++)
+        ;
+    for (lo = 0; lo < len && lo < oldlen; lo++) {
+        if (SCR_CHR(text[lo]) != shadow[lo]) {
+            break;
+        }
     }
-    else if (*prompt_buf == 'p') {
-        cmd_code = CMD_COPY;
+    if (lo == len && len == oldlen) {
+        return;     // no change
     }
-    else if (1 == strlen(prompt_buf) && *prompt_buf == 'x') {
-        cmd_code = CMD_EXIT;
+    hi = len;
+    if (len == oldlen) {
+        while (SCR_CHR(text[hi - 1]) == shadow[hi - 1]) {
+            hi--;
+        }
     }
-    else if (1 == strlen(prompt_buf) && *prompt_buf == 'e') {
-        cmd_code = CMD_ERASE;
+    scr_gotoxy(row, lo);
+    for ( ; lo < hi; lo++) {
+        shadow[lo] = SCR_CHR(text[lo]);
+        putchar(shadow[lo]);
     }
-    else if (*prompt_buf == 't') {
-        cmd_code = CMD_DTTM;
+    scr_ccol = hi;
+    if (len < oldlen) {
+        ansi_clreol();
     }
-    else if (*prompt_buf == 'b') {
-        cmd_code = CMD_BANK;
+    shadow[len] = 0;
+}
+
+/*
+ * Scroll rows row .. SCR_ROWS-1 of the screen one row up (up != 0, the row
+ * is removed, the last row is empty) or down (empty row is inserted at
+ * row). The terminal scrolls the text in a scroll region, nothing is sent
+ * again.
+ */
+void scr_scroll(unsigned char row, unsigned char up)
+{
+    if (row) {
+        ansi_set_scrollrgn(row + 1, SCR_ROWS);
+        scr_crow = 0xFF;
     }
-    else if (*prompt_buf == 'm') {
-        cmd_code = CMD_INFO;
+    if (up) {
+        scr_gotoxy(SCR_ROWS - 1, 0);
+        ansi_scrolldown(1);
+        memmove(scr_shadow[row], scr_shadow[row + 1],
+                (SCR_ROWS - 1 - row) * SCR_COLS);
+        scr_shadow[SCR_ROWS - 1][0] = 0;
+    } else {
+        scr_gotoxy(row, 0);
+        ansi_scrollup(1);
+        memmove(scr_shadow[row + 1], scr_shadow[row],
+                (SCR_ROWS - 1 - row) * SCR_COLS);
+        scr_shadow[row][0] = 0;
     }
-    else if (*prompt_buf == 'i') {
-        cmd_code = CMD_INSERT;
+    if (row) {
+        ansi_set_scrollrgn(1, SCR_ROWS);
+        scr_crow = 0xFF;
     }
-    else if (*prompt_buf == 'c') {
-        cmd_code = CMD_CUTSEL;
+}
+
+/*
+ * Show lines of text in rows from row down to the bottom of the screen.
+ * The edited line is shown from scr_edit. Rows after the end of text are
+ * empty.
+ */
+void scr_fill(unsigned char row)
+{
+    unsigned int line = scr_top + row;
+    uint16_t addr = 0;
+
+    if (line < line_count) {
+        addr = lidx_addr(line);
     }
-    else if (*prompt_buf == 'f') {
-        cmd_code = CMD_FIND;
+    for ( ; row < SCR_ROWS; row++, line++) {
+        if (line == scr_line) {
+            scr_putrow(row, scr_edit);
+        } else if (line < line_count) {
+            scr_putrow(row, TBREC_TXTPTR(addr));
+        } else {
+            scr_putrow(row, "");
+        }
+        if (line < line_count) {
+            addr = doc_next(addr);
+        }
     }
-    else
-        cmd_code = CMD_UNKNOWN;
 }
 
-/* print help */
-void texted_help(void)
+/*
+ * Make the edited line visible and show the screen. If the line is just
+ * above / below the screen, the screen is scrolled by one row.
+ */
+void scr_show(void)
 {
-    unsigned char cont = 1, i = 0;
-
-    while(cont)
-    {
-        if (0 == strncmp(helptext[i],"@EOH",4))
-            cont = 0;
-        else {
-            //puts("   ");  // 3 spaces
-            puts(helptext[i++]);
+    if (scr_line < scr_top) {
+        if (scr_top - scr_line == 1) {
+            scr_scroll(0, 0);
         }
-        if (0 == (i%22)) {
-            puts("\n\r");
-            puts("Press any key to continue...");
-            while(!kbhit());    // wait for key press...
-            getc();            // consume key
-            puts("\n\r\n\r");
+        scr_top = scr_line;
+    } else if (scr_line >= scr_top + SCR_ROWS) {
+        if (scr_line - scr_top == SCR_ROWS) {
+            scr_scroll(0, 1);
         }
+        scr_top = scr_line - SCR_ROWS + 1;
     }
+    scr_fill(0);
 }
 
 /*
- * Execute command.
+ * Show line# of the edited line, last line# and message in status line.
  */
-int exec_cmd(void)
+void scr_status(const char *msg)
 {
-    int ret = 1;
+    strcpy(prompt_buf, " Line ");
+    strcat(prompt_buf, utoa(scr_line, ibuf1, RADIX_DEC));
+    strcat(prompt_buf, "/");
+    strcat(prompt_buf, utoa(last_line, ibuf1, RADIX_DEC));
+    strcat(prompt_buf, "  ");
+    strcat(prompt_buf, msg);
+    scr_putrow(SCR_STATUS, prompt_buf);
+}
 
-    switch (cmd_code)
-    {
-        case CMD_NULL:
-            break;
-        case CMD_UNKNOWN:
-            prnerror(ERROR_BADCMD);
-            break;
-        case CMD_EXIT:
-            puts("Bye!\n\r");
-            ret = 0;
-            break;
-        case CMD_HELP:
-            texted_help();
-            break;
-        case CMD_ADD:
-            texted_add();
-            break;
-        case CMD_LIST:
-            texted_list();
-            break;
-        case CMD_GOTO:
-            texted_goto();
-            break;
-        case CMD_DELETE:
-            texted_delete();
-            break;
-        case CMD_ERASE:
-            texted_initbuf();
-            break;
-        case CMD_BANK:
-            texted_membank();
-            break;
-        case CMD_INFO:
-            texted_info();
-            break;
-        case CMD_SELECT:
-            texted_select();
-            break;
-        case CMD_CUTSEL:
-            texted_cut();
-            break;
-        case CMD_INSERT:
-            texted_insert();
-            break;
-        case CMD_COPY:
-            texted_copy();
-            break;
-        case CMD_FIND:
-            texted_find();
-            break;
-        case CMD_DTTM:
-            texted_insdttm();
+/*
+ * Load text of line# scr_line to scr_edit.
+ */
+void scr_getline(void)
+{
+    unsigned char len;
+
+    strcpy(scr_edit, TBREC_TXTPTR(lidx_addr(scr_line)));
+    scr_dirty = 0;
+    len = strlen(scr_edit);
+    if (scr_col > len) {
+        scr_col = len;
+    }
+}
+
+/*
+ * Write the edited line back to the text buffer if it was changed.
+ * Return 0 if there was no room for the longer text, old text of the line
+ * is loaded back then.
+ */
+int scr_putline(void)
+{
+    if (0 == scr_dirty) {
+        return 1;
+    }
+    strcpy(CurrLine.text, scr_edit);
+    CurrLine.len = strlen(scr_edit);
+    if (doc_putline(scr_line)) {
+        scr_dirty = 0;
+        return 1;
+    }
+    scr_getline();
+
+    return 0;
+}
+
+/*
+ * Wait for a key. Cursor and page keys (ESC sequences) are returned as
+ * KEY_UP .. KEY_PGDN, unknown sequences as 0.
+ */
+int scr_getkey(void)
+{
+    int c = rx_getc(0);
+
+    if (ESC != c) {
+        return c;
+    }
+    c = rx_getc(0);
+    if ('[' != c && 'O' != c) {
+        return 0;
+    }
+    c = rx_getc(0);
+    switch (c) {
+        case 'A':
+            return KEY_UP;
+        case 'B':
+            return KEY_DOWN;
+        case 'C':
+            return KEY_RIGHT;
+        case 'D':
+            return KEY_LEFT;
+        case '5':
+        case '6':
+            if ('~' == rx_getc(0)) {
+                return ('5' == c) ? KEY_PGUP : KEY_PGDN;
+            }
             break;
         default:
             break;
     }
 
-    return ret;
+    return 0;
 }
 
 /*
- *  Add text at the end of the text buffer.
+ * Full screen editing, starts at current line.
+ * Text rows of the screen are the scroll region, status line is below it.
+ * Only the edited row is refreshed after a character is typed, after
+ * the cursor moved to another line the screen is compared with the shadow
+ * copy, so only new or changed rows are sent.
  */
-void texted_add(void)
+void texted_visual(void)
 {
-    uint16_t nxtaddr;
+    int key;
+    unsigned char row, len;
+    unsigned char redraw = 1;
+    const char *msg = scr_help;
 
-    curr_addr = START_BRAM;
-    line_num = 0;
     if (0 == checkbuf()) {
         return;
     }
-    // Position current address at the NULL line after text.
-    while (1) {
-        if (isnull_hdr((const char *)curr_addr)) {
-            break; // found null header
-        }
-        line_num = PEEKW(curr_addr) + 1;
-        nxtaddr = PEEKW(curr_addr + 3);
-        curr_addr = nxtaddr;
-        if (isaddr_oor(curr_addr)) {
-            return;
-        }
+    if (0 == line_count) {  // edit one empty line
+        CurrLine.text[0] = 0;
+        CurrLine.len = 0;
+        doc_select(0);
+        lidx_append(0, doc_insert(tb_first()));
+        line_num = 0;
     }
-    prninfo_addtext();
+    scr_line = line_num;
+    scr_top = line_num;
+    scr_col = 0;
+    scr_getline();
+    memset(scr_shadow, 0, sizeof(scr_shadow));
+    ansi_cls();
+    ansi_set_scrollrgn(1, SCR_ROWS);
+    scr_crow = 0xFF;
     while (1) {
-        // create and store null text header at current address
-        strcpy((char *)curr_addr, null_txt_hdr);
-        // get line of text from user input
-        getline();
-        if (0 == strncmp(eot_str, prompt_buf, strlen(eot_str))) {
-            break;  // user entered command to end text entry
+        if (redraw) {
+            scr_show();
+            redraw = 0;
+        } else {
+            scr_putrow(scr_line - scr_top, scr_edit);
         }
-        strcpy (CurrLine.text, prompt_buf);
-        CurrLine.len = strlen(prompt_buf);
-        CurrLine.next_ptr = curr_addr + CurrLine.len + 6;
-        if (CurrLine.next_ptr > (END_BRAM - 6)) {
-            // Text buffer full, terminate text entry here.
-            // User must still enter '@EOT' to exit loop.
-            // This is to prevent entering accidental command while loading
-            // text via serial port and buffer overflows while input data is
-            // still coming. Instead ignore all incoming text after
-            // buffer was filled until end-of-text command is entered.
-            while(1) {
-                prnerror(ERROR_FULLBUF);
-                getline();
-                if (0 == strncmp(eot_str, prompt_buf, strlen(eot_str))) {
-                    break;  // user entered command to end text entry
-                }
-            }
+        scr_status(msg);
+        msg = scr_help;     // message is shown until the next key
+        row = scr_line - scr_top;
+        scr_gotoxy(row, scr_col);
+        key = scr_getkey();
+        len = strlen(scr_edit);
+        if (KEY_CTRLX == key) {
             break;
         }
-        // update header and text at current address
-        CurrLine.num = line_num;
-        write_text2mem(curr_addr);
-        // proceed to next address
-        line_num++;
-        curr_addr = CurrLine.next_ptr;
-        if (isaddr_oor(curr_addr)) {
-            return;
+        switch (key) {
+            case KEY_UP:
+            case KEY_DOWN:
+            case KEY_PGUP:
+            case KEY_CTRLB:
+            case KEY_PGDN:
+            case KEY_CTRLF:
+                if (0 == scr_putline()) {
+                    msg = scr_full;
+                }
+                if (KEY_UP == key && scr_line > 0) {
+                    scr_line--;
+                } else if (KEY_DOWN == key && scr_line < last_line) {
+                    scr_line++;
+                } else if (KEY_PGUP == key || KEY_CTRLB == key) {
+                    scr_line = (scr_line > SCR_ROWS - 1)
+                               ? scr_line - (SCR_ROWS - 1) : 0;
+                    scr_top = (scr_top > SCR_ROWS - 1)
+                              ? scr_top - (SCR_ROWS - 1) : 0;
+                } else if (KEY_PGDN == key || KEY_CTRLF == key) {
+                    scr_line = (last_line - scr_line > SCR_ROWS - 1)
+                               ? scr_line + (SCR_ROWS - 1) : last_line;
+                    if (last_line - scr_top > SCR_ROWS - 1) {
+                        scr_top += SCR_ROWS - 1;
+                    }
+                }
+                scr_getline();
+                redraw = 1;
+                break;
+            case KEY_LEFT:
+                if (scr_col > 0) {
+                    scr_col--;
+                }
+                break;
+            case KEY_RIGHT:
+                if (scr_col < len) {
+                    scr_col++;
+                }
+                break;
+            case KEY_BS:
+            case KEY_DEL:
+                if (scr_col > 0) {
+                    scr_col--;
+                    memmove(scr_edit + scr_col, scr_edit + scr_col + 1,
+                            len - scr_col);
+                    scr_dirty = 1;
+                    break;
+                }
+                if (0 == scr_line) {
+                    break;
+                }
+                // join the line with the previous one
+                if (0 == scr_putline()) {
+                    msg = scr_full;
+                    break;
+                }
+                strcpy(CurrLine.text, TBREC_TXTPTR(lidx_addr(scr_line - 1)));
+                key = strlen(CurrLine.text);
+                if (key + len > TEXTLINE_SIZE - 1) {
+                    putchar(BEL);
+                    break;
+                }
+                strcat(CurrLine.text, scr_edit);
+                CurrLine.len = key + len;
+                if (0 == doc_putline(scr_line - 1)) {
+                    msg = scr_full;
+                    break;
+                }
+                delete_text(scr_line, scr_line);
+                scr_scroll(row, 1);
+                scr_line--;
+                scr_getline();
+                scr_col = key;
+                redraw = 1;
+                break;
+            case KEY_CR:
+                // split the line, text after the cursor goes to a new line
+                if (0 == scr_putline()) {
+                    msg = scr_full;
+                    break;
+                }
+                strcpy(CurrLine.text, scr_edit + scr_col);
+                CurrLine.len = len - scr_col;
+                if (0 == doc_insert(lidx_addr(scr_line + 1))) {
+                    msg = scr_full;
+                    break;
+                }
+                lidx_insert(scr_line + 1);
+                scr_edit[scr_col] = 0;
+                scr_dirty = 1;
+                scr_putline();  // shorter text always fits
+                if (row + 1 < SCR_ROWS) {
+                    scr_scroll(row + 1, 0);
+                }
+                scr_line++;
+                scr_col = 0;
+                scr_getline();
+                redraw = 1;
+                break;
+            case KEY_CTRLY:
+                if (0 == last_line) {   // the only line is cleared
+                    scr_edit[0] = 0;
+                    scr_col = 0;
+                    scr_dirty = 1;
+                    break;
+                }
+                delete_text(scr_line, scr_line);
+                scr_scroll(row, 1);
+                if (scr_line > last_line) {
+                    scr_line = last_line;
+                }
+                scr_getline();
+                redraw = 1;
+                break;
+            default:
+                if ((key < ' ' && '\t' != key) || key >= KEY_DEL) {
+                    break;  // not a character
+                }
+                if (len >= TEXTLINE_SIZE - 1) {
+                    putchar(BEL);
+                    break;
+                }
+                memmove(scr_edit + scr_col + 1, scr_edit + scr_col,
+                        len - scr_col + 1);
+                scr_edit[scr_col++] = (char)key;
+                scr_dirty = 1;
+                break;
         }
     }
+    if (0 == scr_putline()) {
+        msg = scr_full;
+    }
+    ansi_reset_scrollrgn();
+    ansi_set_cursor(1, SCR_STATUS + 1);
+    ansi_clreol();
+    if (msg == scr_full) {
+        puts(msg);
+        puts("\n\r");
+    }
+    line_num = scr_line;
     checkbuf(); // update globals after text buffer was altered
+    goto_line(line_num);
 }
 
+#pragma rodata-name (pop)
+#pragma code-name (pop)
+
 /*
- * Renumber line numbers in text records starting at address addr.
- * Also, refresh the next record pointers in these text records as this
- * function is called after the text has been relocated in buffer.
- * Return address where the renumbering ended.
+ * Refresh the next record pointers in text records from address addr up to
+ * end (or null header). This function is called after the text has been
+ * relocated in buffer.
+ * Return address where the relinking ended.
  */
-uint16_t renumber(uint16_t addr, int offs)
+uint16_t relink(uint16_t addr, uint16_t end)
 {
-    unsigned int lnum;
     uint16_t nxtaddr;
 
-    while(1) {
+    while(addr < end) {
         if (isnull_hdr((const char *)addr)) {
             break;
         }
-        lnum = PEEKW(addr) + offs;
-        POKEW(addr, lnum);
-        nxtaddr = addr + PEEK(addr + 2) + 6;
+        nxtaddr = addr + TBREC_GETLEN(addr) + TBREC_SIZE;
         if (isaddr_oor(nxtaddr)) {
             break;
         }
-        POKEW(addr + 3, nxtaddr);
+        POKEW(addr + TBREC_NEXT, nxtaddr);
         addr = nxtaddr;
     }
 
@@ -906,7 +3028,6 @@ uint16_t renumber(uint16_t addr, int offs)
 void texted_insert(void)
 {
     int n1;
-    uint16_t addr;
     int n0 = 2;
 
     if (0 == checkbuf()) {
@@ -921,7 +3042,7 @@ void texted_insert(void)
         prnerror(ERROR_BADARG);
         return;
     }
-    if (isnull_hdr((const char *)START_BRAM)) {
+    if (0 == line_count) {
         texted_add();   // if we are inserting into empty buffer
                         // it is the same as adding text
     } else {
@@ -935,20 +3056,9 @@ void texted_insert(void)
             }
             strcpy (CurrLine.text, prompt_buf);
             CurrLine.len = strlen(prompt_buf);
-            CurrLine.next_ptr = curr_addr + CurrLine.len + 6;
-            // make space for new line by moving all the text below down
-            if (END_BRAM > (lastaddr + CurrLine.len + 6)) {
-                // there is space for new line, so continue...
-                // 1. Move text down
-                memmove((void *)CurrLine.next_ptr,
-                        (const void *)curr_addr,
-                        (size_t)(lastaddr - curr_addr + 1));
-                // 2. Insert newly entered line
-                CurrLine.num = line_num;
-                write_text2mem(curr_addr);
-                // 3. Renumber following lines
-                addr = CurrLine.next_ptr;
-                addr = renumber(addr, 1);
+            // insert new line in the gap, moved to current line if needed
+            if (doc_insert(curr_addr)) {
+                lidx_insert(line_num);
                 line_num++;
                 checkbuf();
             } else {
@@ -973,20 +3083,17 @@ void texted_insert(void)
  */
 void texted_copy(void)
 {
-    int n1;
-    uint16_t addr;
-    int n0 = 2;
-    int clipbrd_index = 0;
-    int adding = 0;
+    int n0, n1;
+    unsigned int n;
 
     if (0 == checkbuf()) {
         return;
     }
-    if (isnull_hdr((const char *)clipbrd)) {
+    if (0 == clip_lines) {
         prnerror(ERROR_EMPTYCLIPBRD);
         return;
     }
-    n0 = adv2nxttoken(n0);
+    n0 = adv2nxttoken(2);
     n1 = adv2nextspc(n0);
     if (n1 > n0) {
         line_num = atoi(prompt_buf + n0);
@@ -995,119 +3102,310 @@ void texted_copy(void)
         prnerror(ERROR_BADARG);
         return;
     }
-    if (isnull_hdr((const char *)START_BRAM)) {
+    if (0 == line_count) {
         line_num = 0;
-        curr_addr = START_BRAM;
-        adding = 1;
+        curr_addr = doc_first();
     } else {
         goto_line(line_num);
     }
-    while(clipbrd_index < CLIPBRDBUF_SIZE) {
-        if (isnull_hdr((const char *)(clipbrd + clipbrd_index))) {
-            break; // reached the end of text in clipboard
-        }
-        adding = isnull_hdr((const char *)curr_addr);
-        strcpy(CurrLine.text, (const char *)(clipbrd + clipbrd_index));
-        CurrLine.len = strlen((const char *)(clipbrd + clipbrd_index));
-        clipbrd_index += (CurrLine.len + 1);
-        CurrLine.num = line_num;
-        CurrLine.next_ptr = curr_addr + CurrLine.len + 6;
-        if (END_BRAM > (lastaddr + CurrLine.len + 6)) {
-            // there is space for new line, so continue...
-            // 1. Move text down (if inserting)
-            if (0 == adding) {
-                memmove((void *)CurrLine.next_ptr,
-                        (const void *)curr_addr,
-                        (size_t)(lastaddr - curr_addr + 1));
-            }
-            // 2. Insert newly entered line
-            write_text2mem(curr_addr);
-            // 3. Renumber following lines (if inserting)
-            addr = CurrLine.next_ptr;
-            curr_addr = addr;
-            if (adding) {
-                strcpy((char *)addr, null_txt_hdr); // write null header
-            } else {
-                addr = renumber(addr, 1);
+    n = clip_paste(curr_addr);
+    if (n < clip_lines) {
+        // buffer full, only part of clipboard was inserted
+        prnerror(ERROR_FULLBUF);
+    }
+    // line after the inserted text becomes current
+    goto_line(line_num + n);
+}
+
+#pragma code-name (push, "OVERLAY2")
+#pragma rodata-name (push, "OVERLAY2")
+
+const char ovl_sigfind[] = __DATE__ " " __TIME__;
+
+/*
+ * Build Horspool skip table of find_text: for each character, distance of
+ * its last occurrence (except the last character) from the end of text.
+ */
+void find_init(void)
+{
+    unsigned char i;
+
+    memset(find_skip, find_len, sizeof(find_skip));
+    for (i = 0; i + 1 < find_len; i++) {
+        find_skip[(unsigned char)find_text[i]] = find_len - 1 - i;
+    }
+}
+
+/*
+ * Return offset of the 1-st occurrence of find_text in text txt of length
+ * len or -1 if it is not there.
+ * The text is compared from the end of find_text, on mismatch it is
+ * shifted by the skip of the character under the end of find_text.
+ */
+int find_match(const char *txt, unsigned char len)
+{
+    unsigned char i, j;
+
+    if (len < find_len) {
+        return -1;
+    }
+    for (i = 0; i <= len - find_len;
+         i += find_skip[(unsigned char)txt[i + find_len - 1]]) {
+
+        j = find_len - 1;
+        while (txt[i + j] == find_text[j]) {
+            if (0 == j) {
+                return i;
             }
-            lastaddr = addr + strlen(null_txt_hdr);
-            line_num++;
-            //checkbuf();
-        } else {
-            // buffer full, end here
-            prnerror(ERROR_FULLBUF);
-            break;
+            j--;
         }
     }
+
+    return -1;
 }
 
 /*
  * Find text in buffer.
  * Command is expected in prompt_buf before calling this function:
- * "f [text]"
+ * "f [all] [text]"
  * Search starts in the next line from current line.
  * Search ends when 1-st occurrence is found.
  * Cursor / current line is changed to the line where the text was found.
  * If end is reached, message is printed.
- * If no argument is provided, previous one (if valid) is used.
- * With this implementation, each next search will find the next occurrences
- * with minimum use of memory.
+ * With 'all' all the text is searched in one pass, the numbers of lines
+ * where the text was found are kept for 'l fnd' and 'g fnd' commands.
+ * Current line is not changed.
+ * If no text is provided, previous one (if valid) is used.
+ * Text records are searched in place, walking all parts of document.
  */
 void texted_find(void)
 {
-    uint16_t nxt_line;
+    uint16_t addr;
     int n;
-    char *tptr;
+    int all = 0;
+    unsigned int hits = 0;
     unsigned int line = line_num + 1;   // start search in next line
 
     if (0 == checkbuf()) {
         return;
     }
+    n = adv2nxttoken(1);
+    if (0 == strncmp(prompt_buf + n, "all", 3)
+        && (0 == prompt_buf[n + 3] || ' ' == prompt_buf[n + 3])) {
+
+        all = 1;
+        line = 0;
+        n = adv2nxttoken(n + 3);
+    }
     // if there is argument, new search string is provided by user
     // otherwise search for one used previously
-    if (strlen(prompt_buf) > 2) {
-        memset(CurrLine.text, 0, TEXTLINE_SIZE);
-        n = adv2nxttoken(1);
-        strcpy(CurrLine.text, prompt_buf + n);
+    if (prompt_buf[n]) {
+        strcpy(find_text, prompt_buf + n);
+        find_len = strlen(find_text);
     }
     // sanity check
-    CurrLine.len = strlen(CurrLine.text);
-    if (0 == CurrLine.len) {
+    if (0 == find_len) {
         prnerror(ERROR_BADARG);
         return;
     }
-    if (line > last_line) {
+    if (line > last_line || 0 == line_count) {
         prnerror(ERROR_END);    // search reached end of text buffer
         return;
     }
-    n = 0;
-    while(1) {
-        puts("Searching ");
-        puts(utoa(line, ibuf1, RADIX_DEC));
-        putchar(0x0A);
-        nxt_line = goto_line(line);
-        tptr = (char *) (curr_addr + 5);
-        while(*tptr != 0) {
-            if (0 == strncmp(tptr, CurrLine.text, CurrLine.len)) {
-                n = 1;
-                break; // found text, current line already set
+    find_init();
+    if (all) {
+        find_count = 0;
+        find_bank = doc_banks[0];
+    }
+    addr = lidx_addr(line);
+    while (0 == isnull_hdr((const char *)addr)) {
+        if (find_match(TBREC_TXTPTR(addr), TBREC_GETLEN(addr)) >= 0) {
+            if (0 == all) {
+                break;  // found text
+            }
+            if (find_count < FIND_MAXHITS) {
+                find_lines[find_count++] = line;
             }
-            tptr++;
+            hits++;
         }
-        if (0 != n || 0xFFFF == nxt_line) {
-            break;  // no more text to search
+        addr = doc_next(addr);
+        line++;
+        if (isaddr_oor(addr)) {
+            break;
         }
-        line = nxt_line;
     }
-    if (n) {
+    if (all) {
+        puts("* Found in ");
+        puts(utoa(hits, ibuf1, RADIX_DEC));
+        puts(" line(s) *\n\r");
+        if (hits > find_count) {
+            puts("Only 1-st ");
+            puts(utoa(find_count, ibuf1, RADIX_DEC));
+            puts(" of them are kept.\n\r");
+        }
+        goto_line(line_num);
+    } else if (0 == isnull_hdr((const char *)addr)) {
+        line_num = line;
+        curr_addr = addr;
         puts("* Found *\n\r");
-        puts((const char *)(curr_addr + 5));
+        puts(TBREC_TXTPTR(addr));
         puts("\n\r");
     } else {
         puts("* Not found *  \n\r");
+        goto_line(line_num);
+    }
+}
+
+/*
+ * Replace all occurrences of find_text in text txt of length len with text
+ * repl of length rlen, the result goes to CurrLine (text and len).
+ * Return # of replacements or -1 if the result doesn't fit in a line.
+ */
+int repl_line(const char *txt, unsigned char len,
+              const char *repl, unsigned char rlen)
+{
+    int pos;
+    int n = 0;
+    unsigned char olen = 0;
+
+    while ((pos = find_match(txt, len)) >= 0) {
+        if (olen + pos + rlen >= TEXTLINE_SIZE) {
+            return -1;
+        }
+        memcpy(CurrLine.text + olen, txt, pos);
+        olen += pos;
+        memcpy(CurrLine.text + olen, repl, rlen);
+        olen += rlen;
+        txt += pos + find_len;
+        len -= pos + find_len;
+        n++;
+    }
+    if (olen + len >= TEXTLINE_SIZE) {
+        return -1;
+    }
+    memcpy(CurrLine.text + olen, txt, len + 1); // with null terminator
+    CurrLine.len = olen + len;
+
+    return n;
+}
+
+/*
+ * Replace text in all lines of document.
+ * Command is expected in prompt_buf before calling this function:
+ * "r /text/new_text/"
+ * The 1-st character of argument is the delimiter, the last one may be
+ * omitted.
+ * Each part is rewritten in a single pass: the gap is moved to the
+ * beginning of the part, then each text record after the gap is read and
+ * written with replaced text at the start of the gap. If the new text
+ * doesn't fit in the gap, room is made in the neighbour parts. Lines that
+ * would be too long (or don't fit) are left unchanged.
+ */
+void texted_replace(void)
+{
+    int n;
+    char *repl;
+    char *tail;
+    unsigned char part, rlen;
+    uint16_t rec;
+    int done = 0;
+    unsigned int count = 0;
+    unsigned int lines = 0;
+    unsigned int skipped = 0;
+
+    if (0 == checkbuf()) {
+        return;
+    }
+    if (0 == line_count) {
+        prnerror(ERROR_NOTEXT);
+        return;
+    }
+    n = adv2nxttoken(1);
+    repl = 0;
+    if (prompt_buf[n]) {
+        repl = strchr(prompt_buf + n + 1, prompt_buf[n]);
+    }
+    if (0 == repl || repl == prompt_buf + n + 1) {
+        prnerror(ERROR_BADARG);
+        return;
+    }
+    *repl++ = 0;
+    tail = strchr(repl, prompt_buf[n]);
+    if (tail) {
+        *tail = 0;
+    }
+    rlen = strlen(repl);
+    strcpy(find_text, prompt_buf + n + 1);
+    find_len = strlen(find_text);
+    find_init();
+
+    for (part = 0; part < doc_nparts; part++) {
+        doc_select(part);
+        // the 1-st record may be already done (moved from previous part)
+        tb_movegap(done ? tb_next(tb_first()) : tb_first());
+        done = 0;
+        while (0 == isnull_hdr((const char *)gap_end)) {
+            rec = gap_end;
+            n = repl_line(TBREC_TXTPTR(rec), TBREC_GETLEN(rec), repl, rlen);
+            gap_end = TBREC_GETNXT(rec);    // record goes to the gap
+            if (n > 0
+                && tb_free() < CurrLine.len + TBREC_SIZE
+                && 0 == doc_room(gap_end, CurrLine.len + TBREC_SIZE)) {
+
+                if (part + 1 < doc_nparts
+                    && tb_spillnext(gap_end, CurrLine.len + TBREC_SIZE)) {
+                    // the rest of the part went to the next part, new text
+                    // goes before it
+                    tb_fixgap();
+                    doc_nlines[part]--;
+                    line_count--;
+                    tb_putcache();
+                    doc_select(part + 1);
+                    tb_insert(tb_first());
+                    count += n;
+                    lines++;
+                    done = 1;
+                    break;
+                }
+                n = -1;
+            }
+            if (n < 0) {
+                // keep the old text, it is still in the gap
+                strcpy(CurrLine.text, TBREC_TXTPTR(rec));
+                CurrLine.len = TBREC_GETLEN(rec);
+                skipped++;
+            } else if (n > 0) {
+                count += n;
+                lines++;
+            }
+            CurrLine.next_ptr = gap_start + CurrLine.len + TBREC_SIZE;
+            write_text2mem(gap_start);
+            gap_start = CurrLine.next_ptr;
+        }
+        if (0 == done) {
+            tb_fixgap();
+            tb_putcache();
+        }
+    }
+    lidx_count = 0;     // records moved, rebuild line index when needed
+    find_count = 0;
+    goto_line(line_num);
+
+    puts("* Replaced ");
+    puts(utoa(count, ibuf1, RADIX_DEC));
+    puts(" time(s) in ");
+    puts(utoa(lines, ibuf1, RADIX_DEC));
+    puts(" line(s) *\n\r");
+    if (skipped) {
+        puts("WARNING: ");
+        puts(utoa(skipped, ibuf1, RADIX_DEC));
+        puts(" line(s) not changed, new text too long or no room.\n\r");
     }
 }
 
+#pragma rodata-name (pop)
+#pragma code-name (pop)
+
 /*
  * List text buffer contents.
  * Command is expected in prompt_buf before calling this function:
@@ -1118,7 +3416,7 @@ void texted_list(void)
     int      n0, n;
     uint16_t from_line = line_num;
     uint16_t to_line = line_num;
-    uint16_t addr = START_BRAM;
+    uint16_t addr;
     uint16_t line = 0;
     int      show_num = 0;
 
@@ -1130,13 +3428,24 @@ void texted_list(void)
         n = adv2nextspc(n0);
         if (0 == strncmp(prompt_buf + n0, "clb", 3)) {
 
-            if (0 == isnull_hdr((const char *)clipbrd)) {
+            if (clip_lines) {
                 list_clipbrd();
             } else {
                 prnerror(ERROR_EMPTYCLIPBRD);
             }
             return;
 
+        } else if (0 == strncmp(prompt_buf + n0, "fnd", 3)) {
+
+            n = adv2nxttoken(n);
+            adv2nextspc(n);
+            if (0 == find_count || find_bank != doc_banks[0]) {
+                puts("* Not found *  \n\r");
+            } else {
+                list_found(prompt_buf[n] == 'n');
+            }
+            return;
+
         } else if (0 == strncmp(prompt_buf + n0, "sel", 3)) {
 
             n = adv2nxttoken(n);
@@ -1177,29 +3486,22 @@ void texted_list(void)
             n0 = adv2nextspc(n);
             show_num = (prompt_buf[n] == 'n');
             from_line = 0;
-            while (1) {
-                if (isnull_hdr((const char *)addr)) {
-                    break;  // found last line
-                }
-                to_line = PEEKW(addr);
-                addr = PEEKW(addr + 3);
-                if (isaddr_oor(addr)) {
-                    return;
-                }
-            }
-            addr = START_BRAM;
+            to_line = last_line;
         }
     }
-    if (isnull_hdr((const char *)START_BRAM)) {
+    if (0 == line_count) {
         prnerror(ERROR_NOTEXT);
         return;
     }
 
+    n = lidx_find(from_line);
+    doc_select(lidx[n].part);
+    line = lidx[n].line;
+    addr = lidx[n].addr;
     while (1) {
         if (isnull_hdr((const char *)addr)) {
             break; // EOT, null text header is next
         }
-        line = PEEKW(addr);
         if (line > to_line) {
             break;
         }
@@ -1209,10 +3511,11 @@ void texted_list(void)
                 puts(ibuf1);
                 puts(":");
             }
-            puts ((const char *)(addr + 5));
+            puts (TBREC_TXTPTR(addr));
             puts ("\n\r");
         }
-        addr = PEEKW(addr + 3);
+        addr = doc_next(addr);
+        line++;
         if (isaddr_oor(addr)) {
             return;
         }
@@ -1222,30 +3525,36 @@ void texted_list(void)
 }
 
 /*
- * Position current line at gtl.
- * Return # of next line or 0xFFFF if null header.
+ * Position current line at gtl (or the last line), RAM bank of its part
+ * is selected.
+ * Return # of next line or 0xFFFF if it is the last line.
  */
 uint16_t goto_line(unsigned int gtl)
 {
     unsigned int line;
-    uint16_t nxtaddr;
+    uint16_t addr;
     unsigned int line_to = gtl;
-    uint16_t addr = START_BRAM;
     uint16_t ret = 0;
 
+    line = lidx_find(gtl);
+    doc_select(lidx[line].part);
+    addr = lidx[line].addr;
+    line = lidx[line].line;
     while (1) {
-        line = PEEKW(addr);
-        nxtaddr = PEEKW(addr + 3);
-        if (line == line_to
-            ||
-            isnull_hdr((const char *)nxtaddr)) {
-
+        if (line >= last_line) {
             line_num = line;
             curr_addr = addr;
-            ret = PEEKW(nxtaddr);
+            ret = 0xFFFF;
             break;
         }
-        addr = nxtaddr;
+        if (line == line_to) {
+            line_num = line;
+            curr_addr = addr;
+            ret = line + 1;
+            break;
+        }
+        addr = doc_next(addr);
+        line++;
         if (isaddr_oor(addr)) {
             break;
         }
@@ -1267,7 +3576,7 @@ void texted_goto(void)
     if (0 == checkbuf()) {
         return;
     }
-    if (isnull_hdr((const char *)START_BRAM)) {
+    if (0 == line_count) {
         prnerror(ERROR_NOTEXT);
         return;
     }
@@ -1279,6 +3588,29 @@ void texted_goto(void)
             line_to = 0;
         } else if (0 == strncmp(prompt_buf + n0, "end", 3)) {
             line_to = last_line;
+        } else if (0 == strncmp(prompt_buf + n0, "fnd", 3)) {
+            if (0 == find_count || find_bank != doc_banks[0]) {
+                puts("* Not found *  \n\r");
+                return;
+            }
+            n0 = adv2nxttoken(n1);
+            if (adv2nextspc(n0) > n0) {
+                n1 = atoi(prompt_buf + n0);
+            } else {    // next found line after current line
+                for (n1 = 0; n1 < find_count; n1++) {
+                    if (find_lines[n1] > line_num) {
+                        break;
+                    }
+                }
+                if (n1 == find_count) {
+                    n1 = 0;     // wrap around to the 1-st one
+                }
+            }
+            if (n1 < 0 || n1 >= find_count) {
+                prnerror(ERROR_BADARG);
+                return;
+            }
+            line_to = find_lines[n1];
         } else {
             line_to = atoi(prompt_buf + n0);
         }
@@ -1307,7 +3639,7 @@ void texted_delete(void)
     if (0 == checkbuf()) {
         return;
     }
-    if (isnull_hdr((const char *)START_BRAM)) {
+    if (0 == line_count) {
         prnerror(ERROR_NOTEXT);
         return;
     }
@@ -1343,33 +3675,51 @@ void texted_delete(void)
  */
 void delete_text(unsigned int from_line, unsigned int to_line)
 {
-    uint16_t tmpaddr, endaddr;
-    uint16_t addr = START_BRAM;
+    uint16_t endaddr;
+    unsigned int n, last;
+    unsigned char part;
 
     if (to_line < from_line) {
         prnerror (ERROR_BADARG);
         return;
     }
-    // the actual delete procedure
-    // 1. Go to the from_line position.
-    goto_line(from_line);
-    tmpaddr = curr_addr; // remember current addr - we shift up to this addr
-    // 2. Find address of the next line after to_line.
-    goto_line(to_line);
-    endaddr = PEEKW(curr_addr + 3);
-    utoa((unsigned int)endaddr, ibuf1, RADIX_HEX);
-    strcat(ibuf1, " ");
-    strcat(ibuf1, utoa((unsigned int)lastaddr, ibuf2, RADIX_HEX));
-    texted_assert(__LINE__, (endaddr <= lastaddr), ibuf1);
-    // 3. Delete lines from_line .. to_line by moving text up in the buffer.
-    memmove((void *)tmpaddr, (void *)endaddr,
-            lastaddr - endaddr + strlen(null_txt_hdr));
-    // renumerate lines and change pointer to next line in each
-    addr = tmpaddr;
-    lastaddr = lastaddr - (endaddr - tmpaddr);  // last address is now closer
-    addr = renumber(addr, (from_line - to_line - 1));
-    if (addr >= lastaddr && 0 == isaddr_oor(addr)) {
-        strcpy((char *)addr, null_txt_hdr);
+    // the actual delete procedure, repeated for each part of document
+    // with deleted lines
+    n = to_line - from_line + 1;
+    while (n > 0) {
+        // 1. Find the last line to delete in the part of from_line and
+        //    address of the next line after it.
+        goto_line(from_line);
+        last = doc_nlines[doc_curr] - 1;
+        for (part = 0; part < doc_curr; part++) {
+            last += doc_nlines[part];
+        }
+        if (last > from_line + n - 1) {
+            last = from_line + n - 1;
+        }
+        goto_line(last);
+        endaddr = tb_next(curr_addr);
+        utoa((unsigned int)endaddr, ibuf1, RADIX_HEX);
+        strcat(ibuf1, " ");
+        strcat(ibuf1, utoa((unsigned int)lastaddr, ibuf2, RADIX_HEX));
+        texted_assert(__LINE__, (endaddr <= lastaddr), ibuf1);
+        // 2. Move the gap right after the last line, so lines
+        //    from_line .. last are just before the gap. The gap record is
+        //    not written yet, so from_line is found first, without leaving
+        //    the part (the gap move keeps curr_addr up to date).
+        goto_line(from_line);
+        tb_movegap(endaddr);
+        // 3. Delete lines from_line .. last by extending the gap up to the
+        //    from_line position.
+        gap_start = curr_addr;
+        tb_putgap();
+        curr_addr = gap_end;
+        lidx_delete(from_line, last);
+        doc_nlines[doc_curr] -= last - from_line + 1;
+        line_count -= last - from_line + 1;
+        last_line = line_count ? line_count - 1 : 0;
+        tb_putcache();
+        n -= last - from_line + 1;
     }
 }
 
@@ -1387,7 +3737,7 @@ void texted_select(void)
     if (0 == checkbuf()) {
         return;
     }
-    if (isnull_hdr((const char *)START_BRAM)) {
+    if (0 == line_count) {
         prnerror(ERROR_NOTEXT);
         return;
     }
@@ -1427,7 +3777,7 @@ void texted_cut(void)
     if (0 == checkbuf()) {
         return;
     }
-    if (isnull_hdr((const char *)START_BRAM)) {
+    if (0 == line_count) {
         prnerror(ERROR_NOTEXT);
         return;
     }
@@ -1471,19 +3821,32 @@ void texted_banner(void)
  */
 void texted_initbuf(void)
 {
+    unsigned char part = doc_nparts;
+
     puts("Initialize text buffer? (Y/N) ");
     getline();
     if (*prompt_buf == 'y' || *prompt_buf == 'Y') {
-        strcpy((char *)START_BRAM, null_txt_hdr);
+        // each part of document becomes an empty, unlinked text buffer
+        while (part-- > 0) {
+            doc_selbank(doc_banks[part]);
+            doc_curr = part;
+            doc_nlines[part] = 0;
+            tb_puthdr();
+            strcpy((char *)START_TEXT, null_txt_hdr);
+            gap_start = 0;
+            lastaddr = START_TEXT + strlen(null_txt_hdr);
+            bankinit_flags[bank_num] = 1;
+            tb_putcache();
+        }
+        doc_nparts = 1;
         line_num = 0;
         sel_begin = 0;
         sel_end = 0;
-        bank_num = *RAMBANKNUM;
-        curr_addr = START_BRAM;
+        curr_addr = START_TEXT;
         last_line = 0;
         line_count = 0;
-        lastaddr = curr_addr + strlen(null_txt_hdr);
-        bankinit_flags[bank_num] = 1;
+        lidx_count = 0;
+        find_count = 0;
     }
 }
 
@@ -1494,37 +3857,117 @@ void texted_initbuf(void)
  */
 void texted_membank(void)
 {
+    unsigned char part = doc_curr;
+
+    doc_closegap();     // leave text buffers contiguous in all parts
+    doc_select(part);
     __asm__("jsr %w", MOS_BRAMSEL);
 
+    if (CLIPBRD_BANK == *RAMBANKNUM || OVL_BANK == *RAMBANKNUM) {
+        prnerror(ERROR_RSVBANK);
+        doc_selbank(bank_num);  // stay in current RAM bank
+    }
     if (*RAMBANKNUM != bank_num) {
         puts("WARNING: RAM bank has been switched.\n\r");
         puts("Cursor position and text selection markers were reset.\n\r");
         line_num = 0;
         sel_begin = 0;
         sel_end = 0;
-        curr_addr = START_BRAM;
+        curr_addr = START_TEXT;
         last_line = 0;
         line_count = 0;
-        bank_num = *RAMBANKNUM;
+        doc_head();     // file starts in this or a previous RAM bank
         texted_info();  // set bank_num, validate buffer and display info
     }
 }
 
+/*
+ * Link RAM bank to the end of the document, text in it is erased.
+ * Command is expected in prompt_buf before calling this function:
+ * "k <bank#>" (e.g.: "k 3")
+ */
+void texted_link(void)
+{
+    int n0, n1, bank;
+    unsigned char part;
+
+    if (0 == checkbuf()) {
+        return;
+    }
+    if (doc_nparts >= DOC_MAXPARTS) {
+        prnerror(ERROR_DOCFULL);
+        return;
+    }
+    n0 = adv2nxttoken(2);
+    n1 = adv2nextspc(n0);
+    bank = (n1 > n0) ? atoi(prompt_buf + n0) : -1;
+    for (part = 0; part < doc_nparts; part++) {
+        if (doc_banks[part] == bank) {
+            bank = -1;  // already a part of document
+        }
+    }
+    if (bank < 0 || bank > 7) {
+        prnerror(ERROR_BADARG);
+        return;
+    }
+    if (CLIPBRD_BANK == bank || OVL_BANK == bank) {
+        prnerror(ERROR_RSVBANK);
+        return;
+    }
+    puts("Text in RAM bank# ");
+    puts(utoa((unsigned int)bank, ibuf1, RADIX_DEC));
+    puts(" will be erased. Continue? (Y/N) ");
+    getline();
+    if (*prompt_buf != 'y' && *prompt_buf != 'Y') {
+        return;
+    }
+    // link the last part to the new one
+    part = doc_nparts - 1;
+    doc_select(part);
+    TBHDR_PUTB(TBHDR_NXTBANK, bank + 1);
+    tb_putcache();
+    // new part - empty text buffer linked back to the last part
+    doc_banks[doc_nparts] = bank;
+    doc_nlines[doc_nparts] = 0;
+    doc_curr = doc_nparts++;
+    doc_selbank(bank);
+    tb_puthdr();
+    TBHDR_PUTB(TBHDR_PRVBANK, doc_banks[part] + 1);
+    strcpy((char *)START_TEXT, null_txt_hdr);
+    gap_start = 0;
+    lastaddr = START_TEXT + strlen(null_txt_hdr);
+    bankinit_flags[bank_num] = 1;
+    tb_putcache();
+    texted_info();  // validate document and display info
+}
+
 /*
  * Set bank_num, validate buffer and display text buffer and memory use info.
  */
 void texted_info(void)
 {
+    unsigned char part;
+
     checkbuf();
     puts(divider);
     puts("Current RAM bank#........: ");
     puts(utoa((unsigned int)bank_num, ibuf1, RADIX_DEC));
     puts("\n\r");
+    puts("File RAM banks#..........:");
+    for (part = 0; part < doc_nparts; part++) {
+        puts(" ");
+        puts(utoa((unsigned int)doc_banks[part], ibuf1, RADIX_DEC));
+    }
+    puts("\n\r");
     puts("Current memory address...: $");
     puts(utoa((unsigned int)curr_addr, ibuf1, RADIX_HEX));
     puts("\n\r");
     puts("Next free memory address.: $");
-    puts(utoa((unsigned int)lastaddr, ibuf1, RADIX_HEX));
+    puts(utoa((unsigned int)(gap_start ? gap_start : lastaddr),
+              ibuf1, RADIX_HEX));
+    puts("\n\r");
+    puts("Free memory..............: ");
+    puts(utoa(tb_free(), ibuf1, RADIX_DEC));
     puts("\n\r");
     puts("Current line#............: ");
     puts(utoa((unsigned int)line_num, ibuf1, RADIX_DEC));
@@ -1544,47 +3987,33 @@ void texted_info(void)
 }
 
 /*
- * Sanity check.
- * Check the text buffer and set global variables.
- * Return non-zero if buffer has text or was ever initialized.
+ * Sanity check of the text buffer in current RAM bank (part doc_curr).
+ * Buffer is walked when checked 1-st time or if values cached in the buffer
+ * header are not valid. Text buffer state and the # of lines of the part
+ * are set.
+ * Return 1 if buffer has text or was ever initialized.
  * Return 0 if buffer has non-initialized (random) data.
+ * Return -1 if buffer may be corrupted (timeout).
  */
-int checkbuf(void)
+int tb_check(void)
 {
-    uint16_t addr = START_BRAM;
+    uint16_t addr = START_TEXT;
     uint16_t lcount = MAX_LINES;
+    unsigned int lines = 0;
     int ret = 0;
+    int nxtofs = TBREC_NEXT;
+    int walk = 1;
 
-    // RAM bank# sanity check:
-    if (bank_num != *RAMBANKNUM) {
-        puts("\n\rWARNING: Application RAM bank# is different than indicated by system variable.");
-        puts("\n\rSystem bank#.....: ");
-        puts(itoa(*RAMBANKNUM, ibuf1, RADIX_DEC));
-        puts("\n\rApplication bank#: ");
-        puts(itoa(bank_num, ibuf1, RADIX_DEC));
-        puts("\n\rWhich value should be set?");
-        puts("\n\r   a|A - app. / s|S - system / number - Other ");
-        getline();
-        puts("\n\r");
-        if (*prompt_buf == 's' ||  *prompt_buf == 'S') {
-            bank_num = *RAMBANKNUM;
-        } else if (*prompt_buf != 'a' && *prompt_buf != 'A') {
-            bank_num = atoi(prompt_buf);
-            if (bank_num < 0 || bank_num > 7) {
-                prnerror(ERROR_BADARG);
-                bank_num = 0;
-                puts("bank# = 0\n\r");
-            }
-        }
-        __asm__("lda %v", bank_num);
-        __asm__("jsr %w", MOS_BANKEDRAMSEL);
-    }
-    //bank_num = *RAMBANKNUM;
     if (0 == bankinit_flags[bank_num]) {
         // Check if the buffer was ever initialized.
         // Several protective measures applied to prevent this loop from
         // looping forever.
         puts("Text buffer sanity check ... ");
+        if (0 == TB_HDROK) {
+            // no header, maybe text buffer format version 1
+            addr = START_BRAM;
+            nxtofs = 3;
+        }
         set_timeout(30); // 30 seconds timeout
         while (lcount > 0 && 0 == is_timeout()) {
 
@@ -1592,22 +4021,32 @@ int checkbuf(void)
                ret = 1;
                break;
            }
-           addr = PEEKW(addr + 3);
+           addr = PEEKW(addr + nxtofs);
            if (isaddr_oor(addr)) {
                break;
            }
            lcount--;
         }
         puts("done.\n\r");
+        if (ret && nxtofs != TBREC_NEXT) {
+            puts("Converting text buffer to new format ... ");
+            ret = tb_convert();
+            puts("done.\n\r");
+            lidx_count = 0;
+        }
     } else {
         ret = 1;
+        walk = (0 == tb_cacheok());
     }
-    if (ret) {
-        bankinit_flags[bank_num] = 1;   // set the flag, buffer is sane
-        addr = START_BRAM;
-        line_count = 0;
-        // Find last line (pointing to null_txt_hdr) and line count.
-        ret = 0;
+    if (0 == ret) {
+        return ret;
+    }
+    bankinit_flags[bank_num] = 1;   // set the flag, buffer is sane
+    if (walk) {
+        addr = START_TEXT;
+        gap_start = 0;
+        // Find last line (pointing to null_txt_hdr), line count and gap.
+        ret = -1;
         set_timeout(30);   // 30 seconds timeout
         lcount = MAX_LINES;
         while (lcount > 0 && 0 == is_timeout()) {
@@ -1615,45 +4054,170 @@ int checkbuf(void)
                 ret = 1;
                 break;  // found last line
             }
-            last_line = PEEKW(addr);
-            addr = PEEKW(addr + 3);
+            if (isgap_hdr(addr)) {
+                gap_start = addr;
+                gap_end = TBREC_GETNXT(addr);
+                addr = gap_end;
+                if (isaddr_oor(addr)) {
+                    break;
+                }
+                continue;
+            }
+            addr = TBREC_GETNXT(addr);
             if (isaddr_oor(addr)) {
                 break;
             }
-            line_count++;
+            lines++;
             lcount--;
         }
-        if (ret) {
-            lastaddr = addr + strlen(null_txt_hdr);
-            if (0 == line_count
-                || sel_begin > last_line
-                || sel_end > last_line) {
+    } else {
+        // values cached in buffer header are valid
+        addr = TBHDR_GETW(TBHDR_TAIL);
+        lines = TBHDR_GETW(TBHDR_LINES);
+        tb_getcache();
+    }
+    if (ret > 0) {
+        lastaddr = addr + strlen(null_txt_hdr);
+        doc_nlines[doc_curr] = lines;
+        tb_putcache();
+    }
+
+    return ret;
+}
+
+/*
+ * Sanity check.
+ * Check text buffers of all parts of the document and set global variables.
+ * Part with invalid text or link is cut off the document with its
+ * following parts. Current line of the document is selected.
+ * Return non-zero if buffer has text or was ever initialized.
+ * Return 0 if buffer has non-initialized (random) data.
+ */
+int checkbuf(void)
+{
+    int ret, bank;
+    unsigned char part, i;
+    int cut = 0;
 
-                sel_begin = 0;
-                sel_end = 0;
-                puts("WARNING: Text selection was reset to line #0.\n\r");
+    // RAM bank# sanity check:
+    if (bank_num != *RAMBANKNUM) {
+        puts("\n\rWARNING: Application RAM bank# is different than indicated by system variable.");
+        puts("\n\rSystem bank#.....: ");
+        puts(itoa(*RAMBANKNUM, ibuf1, RADIX_DEC));
+        puts("\n\rApplication bank#: ");
+        puts(itoa(bank_num, ibuf1, RADIX_DEC));
+        puts("\n\rWhich value should be set?");
+        puts("\n\r   a|A - app. / s|S - system / number - Other ");
+        getline();
+        puts("\n\r");
+        if (*prompt_buf == 's' ||  *prompt_buf == 'S') {
+            bank_num = *RAMBANKNUM;
+        } else if (*prompt_buf != 'a' && *prompt_buf != 'A') {
+            bank_num = atoi(prompt_buf);
+            if (bank_num < 0 || bank_num > 7
+                || CLIPBRD_BANK == bank_num || OVL_BANK == bank_num) {
+                prnerror(ERROR_BADARG);
+                bank_num = 0;
+                puts("bank# = 0\n\r");
+            }
+        }
+        __asm__("lda %v", bank_num);
+        __asm__("jsr %w", MOS_BANKEDRAMSEL);
+        for (part = 0; part < doc_nparts; part++) {
+            if (doc_banks[part] == bank_num) {
+                break;
+            }
+        }
+        if (part == doc_nparts) {
+            // bank is not a part of document, start a new one in it
+            doc_banks[0] = bank_num;
+            doc_nparts = 1;
+        }
+    }
+    // check parts in order of links, one RAM bank at a time
+    line_count = 0;
+    part = 0;
+    while (1) {
+        doc_selbank(doc_banks[part]);
+        doc_curr = part;
+        ret = tb_check();
+        if (ret <= 0) {
+            if (0 == part) {
+                if (ret < 0) {
+                    prnerror(ERROR_TIMEOUT);
+                    puts("Text buffer may be corrupted.");
+                } else {
+                    prnerror(ERROR_BUFNOTINIT);
+                }
+                doc_nparts = 1;
+                texted_initbuf();
+                return isnull_hdr((const char *)START_TEXT);
+            }
+            cut = 1;
+            part--;
+            break;
+        }
+        line_count += doc_nlines[part];
+        bank = TBHDR_GETB(TBHDR_NXTBANK) - 1;
+        if (bank < 0) {
+            break;  // last part
+        }
+        for (i = 0; i <= part; i++) {
+            if (doc_banks[i] == bank) {
+                bank = 8;   // loop in links
             }
-            if (line_num > last_line) {
+        }
+        if (CLIPBRD_BANK == bank || OVL_BANK == bank) {
+            bank = 8;       // clipboard is not a part of document
+        }
+        if (bank <= 7 && part + 1 < DOC_MAXPARTS) {
+            doc_selbank(bank);
+            if (TB_HDROK
+                && TBHDR_GETB(TBHDR_PRVBANK) == doc_banks[part] + 1) {
 
-                line_num = last_line;
-                curr_addr = addr;
-                puts("WARNING: Current line was reset to last line #");
-                puts(utoa(line_num, ibuf1, RADIX_DEC));
-                puts("\n\r");
+                doc_banks[++part] = bank;
+                continue;
             }
-        } else {
-            prnerror(ERROR_TIMEOUT);
-            puts("Text buffer may be corrupted.");
-            texted_initbuf();
-            ret = isnull_hdr((const char *)START_BRAM);
         }
+        cut = 1;
+        break;
+    }
+    if (cut) {
+        // cut off the rest of document after the last valid part
+        doc_selbank(doc_banks[part]);
+        tb_getcache();
+        TBHDR_PUTB(TBHDR_NXTBANK, 0);
+        puts("WARNING: Link to the next RAM bank of file was not valid.\n\r");
+        puts("File ends in RAM bank# ");
+        puts(utoa((unsigned int)bank_num, ibuf1, RADIX_DEC));
+        puts(".\n\r");
+    }
+    doc_nparts = part + 1;
+    doc_curr = part;
+    last_line = line_count ? line_count - 1 : 0;
+    if (0 == line_count
+        || sel_begin > last_line
+        || sel_end > last_line) {
+
+        sel_begin = 0;
+        sel_end = 0;
+        puts("WARNING: Text selection was reset to line #0.\n\r");
+    }
+    if (line_num > last_line) {
+
+        line_num = last_line;
+        puts("WARNING: Current line was reset to last line #");
+        puts(utoa(line_num, ibuf1, RADIX_DEC));
+        puts("\n\r");
+    }
+    // select part with current line
+    if (line_count) {
+        goto_line(line_num);
     } else {
-        prnerror(ERROR_BUFNOTINIT);
-        texted_initbuf();
-        ret = isnull_hdr((const char *)START_BRAM);
+        curr_addr = doc_first();
     }
 
-    return ret;
+    return 1;
 }
 
 int main(void)
@@ -1665,10 +4229,21 @@ int main(void)
     sel_begin = 0;
     sel_end = 0;
     bank_num = 0;
-    curr_addr = START_BRAM;
+    curr_addr = START_TEXT;
     last_line = 0;
     line_count = 0;
-    lastaddr = START_BRAM;
+    lastaddr = START_TEXT;
+    lidx_count = 0;
+    find_count = 0;
+    find_len = 0;
+    gap_start = 0;
+    clip_tail = START_TEXT;     // clipboard RAM bank is cleared by 1-st copy
+    clip_lines = 0;
+    doc_banks[0] = 0;
+    doc_nlines[0] = 0;
+    doc_nparts = 1;
+    doc_curr = 0;
+    ovl_curr = OVL_NONE;
 
     // initialize text buffer init flags
     for (i=0; i<8; i++) {
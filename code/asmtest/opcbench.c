@@ -0,0 +1,202 @@
+/*
+ *----------------------------------------------------------------------------
+ * File:  opcbench.c
+ *
+ * Author: Marek Karcz
+ *
+ * Date created: 10/19/2026
+ *
+ * Purpose:
+ *
+ *    Benchmark of mnemonic lookup of 6502 assembler core on host computer.
+ *    Mnemonics of the source file (the 1-st word of each line, after
+ *    label, if it has 3 letters) are looked up many times with:
+ *     - linear scan, the way asm6502 did it before opc_find(): each
+ *       OpCodes entry is copied to a local struct and compared with
+ *       strncmp(), up to the "nnn" end mark,
+ *     - opc_find() of apps/asm6502core.c (perfect hash).
+ *    Mnemonics are converted to lowercase first, the linear scan is case
+ *    sensitive. Shows time per line in ns and # of OpCodes entries
+ *    compared per line by each method, checks that both find the same
+ *    entries.
+ *
+ *    Usage:
+ *       opcbench SourceFile
+ *
+ *    Build:
+ *       gcc -O2 -o opcbench opcbench.c ../apps/asm6502core.c
+ *
+ * Revision history:
+ *
+ * 10/19/2026
+ * 	Created.
+ *----------------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <time.h>
+#include "../apps/asm6502core.h"
+
+#define MAX_MNEMS       65536
+#define MIN_SECS        0.5     // each method runs at least this long
+
+char g_aMnem[MAX_MNEMS][4];
+int g_nMnems = 0;
+long g_nCompared = 0;
+
+int ReadMnems(const char *name);
+int LinearFind(const char *s);
+double Measure(int (*find)(const char *));
+
+int main(int argc, char *argv[])
+{
+   int i, n = 0;
+   double t0, t1;
+
+   if (argc < 2)
+   {
+      printf("Usage:\n   opcbench SourceFile\n");
+      return 1;
+   }
+   if (ReadMnems(argv[1]))
+      return 1;
+   for (i = 0; i < g_nMnems; i++)
+   {
+      if (LinearFind(g_aMnem[i]) != opc_find(g_aMnem[i]))
+      {
+         printf("Methods differ for '%s'.\n", g_aMnem[i]);
+         return 1;
+      }
+      if (opc_find(g_aMnem[i]) >= 0)
+         n++;
+   }
+   printf("%d lines with 3-letter word, %d mnemonics\n", g_nMnems, n);
+   t0 = Measure(LinearFind);
+   t1 = Measure(opc_find);
+   printf("linear scan: %.1f ns/line, %.1f entries compared/line\n",
+          t0, (double)g_nCompared / g_nMnems);
+   printf("opc_find():  %.1f ns/line, at most 1 entry compared/line\n", t1);
+
+   return 0;
+}
+
+/*
+ * Read the 1-st word after label of each line of source file to g_aMnem,
+ * if it has 3 letters.
+ */
+int ReadMnems(const char *name)
+{
+   FILE *fp;
+   char line[1024];
+   char *p, *w;
+   int len;
+
+   if (NULL == (fp = fopen(name, "r")))
+   {
+      printf("Unable to open %s\n", name);
+      return 1;
+   }
+   while (NULL != fgets(line, sizeof(line), fp) && g_nMnems < MAX_MNEMS)
+   {
+      p = line;
+      while (' ' == *p || '\t' == *p)
+         p++;
+      w = p;
+      while (isalnum((unsigned char)*p) || '_' == *p)
+         p++;
+      if (':' == *p)
+      {
+         p++;
+         while (' ' == *p || '\t' == *p)
+            p++;
+         w = p;
+         while (isalpha((unsigned char)*p))
+            p++;
+      }
+      len = (int)(p - w);
+      if (3 == len && isalpha((unsigned char)w[0])
+          && 0 == isalnum((unsigned char)*p) && '_' != *p)
+      {
+         for (len = 0; len < 3; len++)
+            g_aMnem[g_nMnems][len] = (char)tolower((unsigned char)w[len]);
+         g_nMnems++;
+      }
+   }
+   fclose(fp);
+
+   return 0;
+}
+
+/*
+ * Return index of mnemonic s in OpCodes or -1, linear scan.
+ */
+int LinearFind(const char *s)
+{
+   struct instr asm_instr;
+   int i = 0;
+
+   while (1)
+   {
+      asm_instr = OpCodes[i];
+      g_nCompared++;
+      if (0 == strncmp(asm_instr.mnem, s, 3))
+         return i;
+      if (0 == strncmp(asm_instr.mnem, "nnn", 3))
+         return -1;
+      i++;
+   }
+}
+
+/*
+ * Return time per line in ns of looking up all mnemonics with find.
+ */
+double Measure(int (*find)(const char *))
+{
+   volatile int sink = 0;
+   clock_t t0, t1;
+   long runs = 0;
+   int i;
+
+   t0 = clock();
+   do
+   {
+      for (i = 0; i < g_nMnems; i++)
+         sink += find(g_aMnem[i]);
+      runs++;
+      t1 = clock();
+   } while ((double)(t1 - t0) / CLOCKS_PER_SEC < MIN_SECS);
+   if (LinearFind == find)
+      g_nCompared /= runs + 1;     // + check in main()
+
+   return (double)(t1 - t0) / CLOCKS_PER_SEC * 1e9 / runs / g_nMnems;
+}
+
+/*
+ * Symbol table and output of assembler core, not used by opc_find().
+ */
+uint16_t symb_find(const char *name, unsigned char len, unsigned char add)
+{
+   return 0;
+}
+
+unsigned char symb_read(uint16_t sym, uint16_t *val)
+{
+   return 0;
+}
+
+void symb_write(uint16_t sym, uint16_t val, unsigned char flags)
+{
+}
+
+void asm_puts(const char *s)
+{
+}
+
+char *utoa(unsigned val, char *buf, int radix)
+{
+   return buf;
+}
@@ -0,0 +1,167 @@
+;
+; File:     ops.asm
+; Purpose:  Conformance test of 6502 assembler core (asm6502core.c), used by
+;           asm6502 and xasm6502. Every one of the 151 op-code / addressing
+;           mode pairs of the NMOS 6502 once, expected machine code is in
+;           ops.exp. Run with run.sh.
+; Author:   Marek Karcz
+; Created:  10/19/2026
+;
+; Operands: #$7F - immediate, $12 - zero page, $3456 - absolute,
+;           ($5678) - indirect JMP, branches go to labels back / fwd.
+;
+
+	.org $1000
+	adc #$7F
+	adc $12
+	adc $12,x
+	adc $3456
+	adc $3456,x
+	adc $3456,y
+	adc ($12,x)
+	adc ($12),y
+	and #$7F
+	and $12
+	and $12,x
+	and $3456
+	and $3456,x
+	and $3456,y
+	and ($12,x)
+	and ($12),y
+	asl $12
+	asl $12,x
+	asl $3456
+	asl $3456,x
+	asl a
+	bit $12
+	bit $3456
+back:
+	bpl back
+	bmi fwd
+	bvc back
+	bvs fwd
+	bcc back
+	bcs fwd
+	bne back
+	beq fwd
+fwd:
+	brk
+	cmp #$7F
+	cmp $12
+	cmp $12,x
+	cmp $3456
+	cmp $3456,x
+	cmp $3456,y
+	cmp ($12,x)
+	cmp ($12),y
+	cpx #$7F
+	cpx $12
+	cpx $3456
+	cpy #$7F
+	cpy $12
+	cpy $3456
+	dec $12
+	dec $12,x
+	dec $3456
+	dec $3456,x
+	eor #$7F
+	eor $12
+	eor $12,x
+	eor $3456
+	eor $3456,x
+	eor $3456,y
+	eor ($12,x)
+	eor ($12),y
+	clc
+	sec
+	cli
+	sei
+	clv
+	cld
+	sed
+	inc $12
+	inc $12,x
+	inc $3456
+	inc $3456,x
+	jmp $3456
+	jmp ($5678)
+	jsr $3456
+	lda #$7F
+	lda $12
+	lda $12,x
+	lda $3456
+	lda $3456,x
+	lda $3456,y
+	lda ($12,x)
+	lda ($12),y
+	ldx #$7F
+	ldx $12
+	ldx $12,y
+	ldx $3456
+	ldx $3456,y
+	ldy #$7F
+	ldy $12
+	ldy $12,x
+	ldy $3456
+	ldy $3456,x
+	lsr $12
+	lsr $12,x
+	lsr $3456
+	lsr $3456,x
+	lsr a
+	nop
+	ora #$7F
+	ora $12
+	ora $12,x
+	ora $3456
+	ora $3456,x
+	ora $3456,y
+	ora ($12,x)
+	ora ($12),y
+	tax
+	txa
+	dex
+	inx
+	tay
+	tya
+	dey
+	iny
+	rol $12
+	rol $12,x
+	rol $3456
+	rol $3456,x
+	rol a
+	ror $12
+	ror $12,x
+	ror $3456
+	ror $3456,x
+	ror a
+	rti
+	rts
+	sbc #$7F
+	sbc $12
+	sbc $12,x
+	sbc $3456
+	sbc $3456,x
+	sbc $3456,y
+	sbc ($12,x)
+	sbc ($12),y
+	sta $12
+	sta $12,x
+	sta $3456
+	sta $3456,x
+	sta $3456,y
+	sta ($12,x)
+	sta ($12),y
+	txs
+	tsx
+	pha
+	pla
+	php
+	plp
+	stx $12
+	stx $12,y
+	stx $3456
+	sty $12
+	sty $12,x
+	sty $3456
@@ -0,0 +1,47 @@
+;
+; File:     peep.asm
+; Purpose:  Test of peephole optimization of 6502 assembler core
+;           (asm6502core.c, option 'o' of asm6502, -p of xasm6502). Each
+;           pattern the optimizer changes, and code it has to keep as it is.
+;           Expected machine code (with -p) is in peep.exp. Run with run.sh.
+; Author:   Marek Karcz
+; Created:  10/19/2026
+;
+
+	.org $2000
+; LDA after STA removed, N, Z flags reflect A already
+	lda #1
+	sta $10
+	lda $10
+; label before STA: code jumping to it may set N, Z flags, LDA is kept
+	lda #5
+	cpx #3
+	jmp l1
+	lda #0
+l1:	sta $10
+	lda $10
+	beq l2
+	nop
+l2:	lda #2
+	sta $3456
+l3:
+	lda $3456
+; load from I/O space is kept
+	lda #3
+	sta $C000
+	lda $C000
+; label on STA line
+	lda #6
+l4:	sta $11
+	lda $11
+; JSR followed by RTS becomes JMP
+	jsr sub
+	rts
+; NOP after JMP is not reachable
+	jmp l2
+	nop
+; branch over JMP becomes inverted branch
+sub:	ldx #0
+	bne skip
+	jmp l2
+skip:	rts
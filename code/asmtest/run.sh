@@ -0,0 +1,94 @@
+#!/bin/sh
+#
+# File:     run.sh
+# Purpose:  Conformance test of 6502 assembler core (apps/asm6502core.c).
+#           Builds xasm6502, assembles ops.asm (all 151 op-code / addressing
+#           mode pairs) with each set of options below and compares the
+#           machine code with ops.exp, and peep.asm (peephole optimization)
+#           with peep.exp. Large source mchess.asm is assembled in one and
+#           in more passes, then the speed of the assembler is shown.
+#           Run it after every change of the assembler core.
+# Author:   Marek Karcz
+# Created:  10/19/2026
+#
+# Usage:    sh run.sh
+#           Exit code is 0 if all tests passed.
+#
+
+D=`dirname "$0"`
+T=${TMPDIR:-/tmp}/asmtest.$$
+CC=${CC:-gcc}
+mkdir -p "$T" || exit 1
+trap 'rm -rf "$T"' 0
+
+$CC -o "$T/xasm6502" "$D/../xasm6502.c" "$D/../apps/asm6502core.c" || exit 1
+
+# expected bytes of file $1, one per line, to file $2
+expected()
+{
+    grep -v '^;' "$1" | sed -e 's/^[0-9A-Fa-f]*://' \
+        -e 's/^\(\( [0-9A-Fa-f][0-9A-Fa-f]\)*\).*/\1/' \
+        | tr -s ' ' '\n' | grep . | tr 'a-f' 'A-F' > "$2"
+}
+
+expected "$D/ops.exp" "$T/exp.txt"
+expected "$D/peep.exp" "$T/peep.txt"
+
+fail=0
+# options: multi-pass, single-pass, long branches, peephole optimization
+# (ops.asm has no code the optimizer may change)
+for opts in "" "-1" "-b" "-p"; do
+    if "$T/xasm6502" -f "$D/ops.asm" -o "$T/ops.bin" $opts > "$T/log.txt" \
+        && od -An -tx1 -v "$T/ops.bin" | tr -s ' ' '\n' | grep . \
+           | tr 'a-f' 'A-F' > "$T/got.txt" \
+        && cmp -s "$T/exp.txt" "$T/got.txt"; then
+        echo "PASS ops.asm $opts"
+    else
+        echo "FAIL ops.asm $opts"
+        cat "$T/log.txt"
+        diff "$T/exp.txt" "$T/got.txt" | head -20
+        fail=1
+    fi
+done
+# monitor 'w' commands: code must start at $1000
+if "$T/xasm6502" -f "$D/ops.asm" -o "$T/ops.txt" -w > "$T/log.txt" \
+    && head -1 "$T/ops.txt" | grep -q '^w 1000 ' \
+    && sed -e 's/^w [0-9A-F]*//' "$T/ops.txt" | tr -s ' ' '\n' | grep . \
+       > "$T/got.txt" \
+    && cmp -s "$T/exp.txt" "$T/got.txt"; then
+    echo "PASS ops.asm -w"
+else
+    echo "FAIL ops.asm -w"
+    fail=1
+fi
+# code the optimizer changes and code it has to keep
+if "$T/xasm6502" -f "$D/peep.asm" -o "$T/peep.bin" -p > "$T/log.txt" \
+    && od -An -tx1 -v "$T/peep.bin" | tr -s ' ' '\n' | grep . \
+       | tr 'a-f' 'A-F' > "$T/got.txt" \
+    && cmp -s "$T/peep.txt" "$T/got.txt"; then
+    echo "PASS peep.asm -p"
+else
+    echo "FAIL peep.asm -p"
+    cat "$T/log.txt"
+    diff "$T/peep.txt" "$T/got.txt" | head -20
+    fail=1
+fi
+# large source: single pass makes the same code as multi-pass
+if "$T/xasm6502" -f "$D/mchess.asm" -o "$T/mchess.bin" > "$T/log.txt" \
+    && "$T/xasm6502" -f "$D/mchess.asm" -o "$T/mchess1.bin" -1 \
+       > "$T/log.txt" \
+    && cmp -s "$T/mchess.bin" "$T/mchess1.bin"; then
+    echo "PASS mchess.asm -1"
+else
+    echo "FAIL mchess.asm -1"
+    cat "$T/log.txt"
+    fail=1
+fi
+
+# throughput of the assembler core and of its mnemonic lookup (host
+# computer, informative only)
+"$T/xasm6502" -f "$D/mchess.asm" -t 200 | tail -1
+$CC -O2 -o "$T/opcbench" "$D/opcbench.c" "$D/../apps/asm6502core.c" \
+    && "$T/opcbench" "$D/mchess.asm"
+
+exit $fail
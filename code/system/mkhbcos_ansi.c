@@ -22,6 +22,14 @@
  *
  * 7/26/2016
  *    ansi_set_cursor() and ansi_set_colors().
+ *
+ * 10/18/2026
+ *    ansi_set_cursor() and ansi_set_colors() print numbers with putdec()
+ *    directly to the console (no itoa() conversion to buffer).
+ *
+ * 10/18/2026
+ *    Added clear to end of line, set / reset scroll region and
+ *    reverse scroll (cursor up with scrolling at the top of region).
  */
 
 #include <stdlib.h>
@@ -29,8 +37,6 @@
 #include "mkhbcos_serialio.h"
 #include "mkhbcos_ansi.h"
 
-#define TBUF_MAX	20
-
 unsigned char ansicode_scrldown [] 	= {ESC, 'D', 0};
 unsigned char ansicode_cls [] 		= {ESC, '[', '2', 'J', 0};
 unsigned char ansicode_home [] 		= {ESC, '[', '1', ';', '1', 'H', 0};
@@ -39,8 +45,10 @@ unsigned char ansicode_reset [] 	= {ESC, '[', '0', 'm', 0};
 unsigned char ansicode_esc1 []		= {ESC, '[', 0};
 unsigned char ansicode_bold []		= {ESC, '[', '1', 'm', 0};
 unsigned char ansicode_reverse []	= {ESC, '[', '7', 'm', 0};
+unsigned char ansicode_scrlup []	= {ESC, 'M', 0};
+unsigned char ansicode_clreol []	= {ESC, '[', 'K', 0};
+unsigned char ansicode_rstrgn []	= {ESC, '[', 'r', 0};
 
-char termbuf[TBUF_MAX];
 
 void ansi_resetallattr(void)
 {
@@ -54,6 +62,13 @@ void ansi_scrolldown(int n)
 		puts(ansicode_scrldown);
 }
 
+void ansi_scrollup(int n)
+{
+	int i;
+	for (i = 0; i < n; i++)
+		puts(ansicode_scrlup);
+}
+
 void ansi_cls(void)
 {
 	puts(ansicode_cls);
@@ -82,14 +97,11 @@ void ansi_reverseon(void)
 
 void ansi_set_cursor(int col, int row)
 {
-	memset(termbuf,0,TBUF_MAX);
-
 	puts(ansicode_esc1);
-	puts(itoa(row,termbuf,10));
-	puts(";");
-	memset(termbuf,0,TBUF_MAX);
-	puts(itoa(col,termbuf,10));
-	puts("f");
+	putdec(row);
+	putchar(';');
+	putdec(col);
+	putchar('f');
 }
 
 void ansi_set_colors(int bkg, int fg)
@@ -97,16 +109,39 @@ void ansi_set_colors(int bkg, int fg)
 	int lcbg = ANSI_COL_BLACK;
 	int lcfg = ANSI_COL_GREEN;
 	
-	memset(termbuf,0,TBUF_MAX);
-
 	puts(ansicode_esc1);
 	if (bkg >= 0 && bkg < ANSI_COL_ENDTABLE)
 		lcbg = bkg + 40;
 	if (fg >= 0 && fg < ANSI_COL_ENDTABLE)
 		lcfg = fg + 30;
-	puts(itoa(lcbg,termbuf,10));
-	puts(";");
-	memset(termbuf,0,TBUF_MAX);
-	puts(itoa(lcfg,termbuf,10));
-	puts("m");
+	putdec(lcbg);
+	putchar(';');
+	putdec(lcfg);
+	putchar('m');
+}
+
+void ansi_clreol(void)
+{
+	puts(ansicode_clreol);
+}
+
+/*
+ * Scrolling (ansi_scrolldown() at the bottom, ansi_scrollup() at the top)
+ * is limited to rows top..bottom. Cursor goes home.
+ */
+void ansi_set_scrollrgn(int top, int bottom)
+{
+	puts(ansicode_esc1);
+	putdec(top);
+	putchar(';');
+	putdec(bottom);
+	putchar('r');
+}
+
+/*
+ * Scrolling region is the whole screen. Cursor goes home.
+ */
+void ansi_reset_scrollrgn(void)
+{
+	puts(ansicode_rstrgn);
 }
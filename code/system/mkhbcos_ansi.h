@@ -14,6 +14,11 @@
  *    Added bold-on function.
  *    Added reverse-on function.
  *
+ * 10/18/2026
+ *
+ *    Added scroll-up (reverse scroll), clear to end of line,
+ *    set / reset scroll region functions.
+ *
  */
 
 #ifndef MKHBCOS_ANSI
@@ -34,6 +39,7 @@ enum ansi_colors
 
 void ansi_resetallattr(void);
 void ansi_scrolldown(int n);
+void ansi_scrollup(int n);
 void ansi_cls(void);
 void ansi_crsr_home(void);
 void ansi_blinkon(void);
@@ -41,6 +47,9 @@ void ansi_set_cursor(int col, int row);
 void ansi_set_colors(int bkg, int fg);
 void ansi_boldon(void);
 void ansi_reverseon(void);
+void ansi_clreol(void);
+void ansi_set_scrollrgn(int top, int bottom);
+void ansi_reset_scrollrgn(void);
 
 unsigned char ansicode_scrldown [];
 unsigned char ansicode_cls [] ;
@@ -49,5 +58,8 @@ unsigned char ansicode_reset [];
 unsigned char ansicode_esc1 [];
 unsigned char ansicode_bold [];
 unsigned char ansicode_reverse [];
+unsigned char ansicode_scrlup [];
+unsigned char ansicode_clreol [];
+unsigned char ansicode_rstrgn [];
 
 #endif
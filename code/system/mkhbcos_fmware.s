@@ -48,6 +48,21 @@
 ; 3/14/2018
 ;   Removed some unneeded NOP-s.
 ;
+; 10/18/2026
+;   Added ROM library fast call gate: jump table of direct entry points at
+;   fixed addresses (segment LIBJT) with register / zero page arguments.
+;   Hot functions (puts, memory copy, memory init) are implemented here in
+;   assembly and do not re-enter the C runtime startup.
+;   Exported C runtime routines (strcpy, strcat, itoa, utoa, memset, atoi,
+;   atol)
+;   of ROM library image via fast call gate, so the applications don't have
+;   to link their own copies.
+;   Added number formatting kernel (decimal via BCD, hexadecimal via table)
+;   with zero padded fixed width, printing directly to UART TX queue or
+;   to caller's buffer.
+;   Added formatted output FmtOut (%d %u %x with width, %s, %c) on top of
+;   number formatting kernel.
+;
 ; ---------------------------------------------------------------------------
 
 .export   _init, _exit
@@ -58,6 +73,7 @@
 .import   __LIBARG_START__, __LIBARG_SIZE__
 
 .import    copydata, zerobss, initlib, donelib
+.import    _strcpy, _strcat, _itoa, _utoa, _memset, _atoi, _atol
 
 ;.include  "zeropage.inc"
 .include  "mkhbcos_ml.inc"
@@ -239,6 +255,10 @@ IrqVect     =   $00E8       ; Customizable IRQ vector
 GetChVect   =   $00EA       ; Custom GetCh function jump vector
 PutChVect   =   $00EC       ; Custom PutCh function jump vector
 
+; Number formatting kernel / formatted output variables
+NumPad      =   $EE         ; padding character
+NumSign     =   $EF         ; pending sign character (0 - none)
+
 ; MOS device detection flags are defined in mkhbcos_ml.inc
 
 DetectedDevices     =   DetectedDev
@@ -2526,6 +2546,632 @@ BankedRamSel:
     sta RamBankSwitch
     rts
 
+;-----------------------------------------------------------------------------
+;-----------------------------------------------------------------------------
+; ROM library fast call gate.
+; Entry points below are reached via LIBJT jump table. Arguments are passed
+; in registers and in RomLibArg1..RomLibArg3 zero page registers (see
+; mkhbcos_ml.inc). The C runtime is not re-initialized (no copydata, zerobss,
+; initlib / donelib) and the LIBARG exchange area is not used.
+; NOTE: RomLibArg1..RomLibArg3 are not preserved.
+;-----------------------------------------------------------------------------
+;-----------------------------------------------------------------------------
+
+.segment "CODE"
+
+;-----------------------------------------------------------------------------
+; Call ROM library function via legacy dispatcher.
+; Input: A - function code, X (lo) / Y (hi) - pointer to arguments.
+; Returns: pointer to return values (if any) in FuncCodeRetPtr.
+;-----------------------------------------------------------------------------
+FastLibCall:
+    sta FuncCodeReg
+    stx FuncCodeArgPtr
+    sty FuncCodeArgPtr+1
+    jmp RomLibFunc
+
+;-----------------------------------------------------------------------------
+; Print a string.
+; Input: A (lo) / X (hi) - address of zero-terminated string.
+;-----------------------------------------------------------------------------
+FastPuts:
+    sta StrPtr
+    stx StrPtr+1
+    jmp Puts
+
+;-----------------------------------------------------------------------------
+; Copy memory, areas may overlap.
+; Input: RomLibArg1 - destination address, RomLibArg2 - source address,
+;        A (lo) / X (hi) - # of bytes to copy.
+;-----------------------------------------------------------------------------
+FastMemCpy:
+    sta RomLibArg3
+    stx RomLibArg3+1
+    ora RomLibArg3+1
+    beq FastMemCpyRts       ; nothing to copy
+    lda RomLibArg2+1        ; if source is below destination, copy
+    cmp RomLibArg1+1        ; backwards (from the end), so the overlapping
+    bcc FastMemCpyDn        ; source bytes are not overwritten before
+    bne FastMemCpyUp        ; they are copied
+    lda RomLibArg2
+    cmp RomLibArg1
+    bcc FastMemCpyDn
+FastMemCpyUp:
+    ldy #0
+    ldx RomLibArg3+1        ; # of full pages
+    beq FastMemCpyUpRem
+FastMemCpyUpPg:
+    lda (RomLibArg2),y
+    sta (RomLibArg1),y
+    iny
+    bne FastMemCpyUpPg
+    inc RomLibArg2+1
+    inc RomLibArg1+1
+    dex
+    bne FastMemCpyUpPg
+FastMemCpyUpRem:
+    ldx RomLibArg3          ; remaining bytes
+    beq FastMemCpyRts
+FastMemCpyUpLp:
+    lda (RomLibArg2),y
+    sta (RomLibArg1),y
+    iny
+    dex
+    bne FastMemCpyUpLp
+FastMemCpyRts:
+    rts
+FastMemCpyDn:
+    clc                     ; move both pointers to the last (partial) page
+    lda RomLibArg1+1
+    adc RomLibArg3+1
+    sta RomLibArg1+1
+    clc
+    lda RomLibArg2+1
+    adc RomLibArg3+1
+    sta RomLibArg2+1
+    ldy RomLibArg3          ; copy partial page first
+    beq FastMemCpyDnPg
+FastMemCpyDnRem:
+    dey
+    lda (RomLibArg2),y
+    sta (RomLibArg1),y
+    cpy #0
+    bne FastMemCpyDnRem
+FastMemCpyDnPg:
+    ldx RomLibArg3+1        ; now full pages, from the top
+    beq FastMemCpyRts
+FastMemCpyDnPgLp:
+    dec RomLibArg1+1
+    dec RomLibArg2+1
+FastMemCpyDnByte:           ; Y = 0 here, copy bytes $FF .. $00 of the page
+    dey
+    lda (RomLibArg2),y
+    sta (RomLibArg1),y
+    cpy #0
+    bne FastMemCpyDnByte
+    dex
+    bne FastMemCpyDnPgLp
+    rts
+
+;-----------------------------------------------------------------------------
+; Initialize memory with value.
+; Input: RomLibArg1 - start address, A (lo) / X (hi) - # of bytes,
+;        Y - value.
+;-----------------------------------------------------------------------------
+FastMemInit:
+    sta RomLibArg3
+    stx RomLibArg3+1
+    tya
+    ldy #0
+    ldx RomLibArg3+1        ; # of full pages
+    beq FastMemInitRem
+FastMemInitPg:
+    sta (RomLibArg1),y
+    iny
+    bne FastMemInitPg
+    inc RomLibArg1+1
+    dex
+    bne FastMemInitPg
+FastMemInitRem:
+    ldx RomLibArg3          ; remaining bytes
+    beq FastMemInitRts
+FastMemInitLp:
+    sta (RomLibArg1),y
+    iny
+    dex
+    bne FastMemInitLp
+FastMemInitRts:
+    rts
+
+;-----------------------------------------------------------------------------
+; Shared C runtime entry points.
+; Application pushes arguments on its own C stack (as for any cc65 call),
+; then its stub (see mkhbcos_romrt.s) calls the entry point with:
+;   RomLibArg1 - caller's C stack pointer (pointer to pushed arguments),
+;   Y - size of pushed arguments in bytes,
+;   A (lo) / X (hi) - last (__fastcall__) argument.
+; Arguments are copied to the ROM library C stack and the runtime routine
+; linked in ROM image is executed. Return value is passed back in A / X.
+; Caller's C stack must be cleaned by the caller's stub.
+;-----------------------------------------------------------------------------
+FastCArgs:
+    sta RomLibArg3          ; save last argument
+    stx RomLibArg3+1
+    sty RomLibArg2          ; ROM C stack pointer = top - size of arguments
+    sec
+    lda #<(__RAM_START__ + __RAM_SIZE__)
+    sbc RomLibArg2
+    sta sp
+    lda #>(__RAM_START__ + __RAM_SIZE__)
+    sbc #0
+    sta sp+1
+    cpy #0
+    beq FastCArgsDone
+FastCArgsLp:
+    dey
+    lda (RomLibArg1),y
+    sta (sp),y
+    cpy #0
+    bne FastCArgsLp
+FastCArgsDone:
+    lda RomLibArg3
+    ldx RomLibArg3+1
+    rts
+
+; char* strcpy(char *dest, const char *src)
+FastStrCpy:
+    jsr FastCArgs
+    jmp _strcpy
+
+; char* strcat(char *dest, const char *src)
+FastStrCat:
+    jsr FastCArgs
+    jmp _strcat
+
+; char* itoa(int val, char *buf, int radix)
+FastItoa:
+    jsr FastCArgs
+    jmp _itoa
+
+; char* utoa(unsigned val, char *buf, int radix)
+FastUtoa:
+    jsr FastCArgs
+    jmp _utoa
+
+; void* memset(void *ptr, int c, size_t n)
+FastMemSet:
+    jsr FastCArgs
+    jmp _memset
+
+; int atoi(const char *s)
+FastAtoi:
+    jsr FastCArgs
+    jmp _atoi
+
+; long atol(const char *s), high word of result returned in RomLibArg2
+; (ROM library sreg is not the caller's sreg)
+FastAtol:
+    jsr FastCArgs
+    jsr _atol
+    ldy sreg
+    sty RomLibArg2
+    ldy sreg+1
+    sty RomLibArg2+1
+    rts
+
+;-----------------------------------------------------------------------------
+; Number formatting kernel.
+; Binary to BCD conversion is done in decimal mode (ISR clears D flag on
+; entry, so no need to disable interrupts), leading zero bits of the value
+; (the whole high byte if it is zero) are skipped. Hexadecimal digits come
+; from the table. Both are printed by common loop, one nibble per digit,
+; from 6-digit (3 bytes) field NumBcd, with leading zeros suppressed down to
+; the width.
+; Input:
+;   A (lo) / X (hi) - value,
+;   Y - width (minimum number of digits, zero padded; 0 - no padding),
+;   RomLibArg2 - output: hi byte = 0 - UART TX queue (via PutCh),
+;                        otherwise pointer to caller's buffer (advanced,
+;                        string is kept null terminated).
+; NOTE: Uses RomLibArg3 and MOS ArrayPtr4, Cnt1, Cnt2 as work registers.
+;       Entry points with suffix P pad with character in NumPad (used by
+;       formatted output, see FmtOut).
+;       A, X, Y are not preserved.
+;-----------------------------------------------------------------------------
+NumVal      =   RomLibArg3      ; value being converted
+NumPos      =   RomLibArg3      ; digit position (after conversion)
+NumStart    =   RomLibArg3+1    ; significant digit found flag
+NumBcd      =   ArrayPtr4       ; 3 bytes: ArrayPtr4, ArrayPtr4+1, Cnt1
+NumWidth    =   Cnt2            ; minimum number of digits
+NumOutPtr   =   RomLibArg2      ; output buffer pointer
+
+; Print signed 16-bit integer in decimal format.
+NumOutI16:
+    jsr NumZeroPad
+NumOutI16P:
+    sty NumWidth
+    ldy #0
+    sty NumSign
+    cpx #$80
+    bcc NumOutI16Pos
+    sta NumVal              ; negative: absolute value
+    sec
+    lda #0
+    sbc NumVal
+    sta NumVal
+    lda #0
+    stx NumVal+1
+    sbc NumVal+1
+    sta NumVal+1
+    lda #'-'
+    ldx NumPad
+    cpx #'0'
+    beq NumSignNow
+    sta NumSign             ; space padded, sign goes right before digits
+    bne NumSignDone         ; (always)
+NumSignNow:
+    jsr NumEmit             ; zero padded, sign goes before zeros
+NumSignDone:
+    lda NumVal
+    ldx NumVal+1
+    ldy NumWidth            ; sign takes one digit of the width
+    beq NumOutU16S
+    dey
+    jmp NumOutU16S
+NumOutI16Pos:
+    ldy NumWidth
+    jmp NumOutU16S
+
+; Print unsigned 16-bit integer in decimal format.
+NumOutU16:
+    jsr NumZeroPad
+NumOutU16P:
+    jsr NumNoSign
+NumOutU16S:
+    sta NumVal
+    stx NumVal+1
+    sty NumWidth
+    lda #0
+    sta NumBcd
+    sta NumBcd+1
+    sta NumBcd+2
+    ldx #16
+    lda NumVal+1
+    bne NumBcdSkip
+    lda NumVal              ; high byte is zero, convert low byte only
+    sta NumVal+1
+    ldx #8
+NumBcdSkip:
+    sed
+NumBcdZero:                 ; leading zero bits leave BCD zero, skip them
+    asl NumVal
+    rol NumVal+1
+    bcs NumBcdBit           ; 1-st one bit
+    dex
+    bne NumBcdZero
+    beq NumBcdDone          ; value is zero (always)
+NumBin2Bcd:
+    asl NumVal              ; next bit of binary value to carry
+    rol NumVal+1
+NumBcdBit:
+    lda NumBcd              ; BCD = BCD * 2 + carry
+    adc NumBcd
+    sta NumBcd
+    lda NumBcd+1
+    adc NumBcd+1
+    sta NumBcd+1
+    lda NumBcd+2
+    adc NumBcd+2
+    sta NumBcd+2
+    dex
+    bne NumBin2Bcd
+NumBcdDone:
+    cld
+    jmp NumOutDigits
+
+; Print unsigned 16-bit integer in hexadecimal format.
+NumOutHex:
+    jsr NumZeroPad
+NumOutHexP:
+    jsr NumNoSign
+    sta NumBcd
+    stx NumBcd+1
+    sty NumWidth
+    lda #0
+    sta NumBcd+2
+
+; Print digits from NumBcd, most significant nibble first. Y is the byte
+; of NumBcd (PutCh preserves Y, as Puts relies on).
+NumOutDigits:
+    lda #6
+    sta NumPos
+    lda #0
+    sta NumStart
+    ldy #2
+NumDigitLp:
+    lda NumBcd,y
+    lsr a                   ; high nibble
+    lsr a
+    lsr a
+    lsr a
+    jsr NumDigit
+    lda NumBcd,y            ; low nibble
+    and #$0F
+    jsr NumDigit
+    dey
+    bpl NumDigitLp
+    rts
+
+; Print digit in A at position NumPos (leading zero is printed as padding
+; or suppressed), go to the next position.
+NumDigit:
+    tax
+    bne NumDigitSig         ; non-zero digit
+    lda NumStart
+    bne NumDigitOut         ; zero after significant digit, print
+    lda NumPos
+    cmp #1
+    beq NumDigitSig         ; last digit is always significant
+    cmp NumWidth
+    beq NumDigitPad         ; padding: position <= width
+    bcs NumDigitNext        ; leading zero, suppress
+NumDigitPad:
+    lda NumPad
+    jsr NumEmit
+    jmp NumDigitNext
+NumDigitSig:
+    lda #1
+    sta NumStart
+    lda NumSign
+    beq NumDigitOut
+    txa                     ; print pending sign first
+    pha
+    lda NumSign
+    jsr NumEmit
+    lda #0
+    sta NumSign
+    pla
+    tax
+NumDigitOut:
+    lda HexDigits,x
+    jsr NumEmit
+NumDigitNext:
+    dec NumPos
+    rts
+
+; Set zero padding (A, X, Y preserved).
+NumZeroPad:
+    pha
+    lda #'0'
+    sta NumPad
+    pla
+    rts
+
+; Clear pending sign (A, X, Y preserved).
+NumNoSign:
+    pha
+    lda #0
+    sta NumSign
+    pla
+    rts
+
+; Emit character in A to current output (UART TX queue or buffer).
+NumEmit:
+    ldx NumOutPtr+1
+    bne NumEmitBuf
+    jmp PutCh
+NumEmitBuf:
+    ldx #0
+    sta (NumOutPtr,x)
+    inc NumOutPtr
+    bne NumEmitZ
+    inc NumOutPtr+1
+NumEmitZ:
+    txa
+    sta (NumOutPtr,x)       ; keep string terminated
+    rts
+
+HexDigits:
+    .byte "0123456789ABCDEF"
+
+;-----------------------------------------------------------------------------
+; Formatted output (subset of printf) in one pass, no intermediate buffers.
+; Conversions: %d, %u, %x (%X) with optional width (space padded, or zero
+; padded when width starts with 0, e.g.: %02d), %s, %c and %%.
+; Input:
+;   RomLibArg1 - format string,
+;   A (lo) / X (hi) - argument list pointer (cc65 va_list: points to last
+;                     fixed argument on C stack, arguments are at lower
+;                     addresses, 2 bytes each),
+;   RomLibArg2 - output, same as for number formatting kernel.
+; Returns:
+;   A (lo) / X (hi) - RomLibArg2 (end of string in buffer).
+; NOTE: Uses StrPtr and tmp_zpgPt, besides registers listed above.
+;-----------------------------------------------------------------------------
+FmtPtr      =   RomLibArg1      ; format string pointer
+FmtArgPtr   =   tmp_zpgPt       ; argument list pointer
+
+FmtOut:
+    sta FmtArgPtr
+    stx FmtArgPtr+1
+    ldx NumOutPtr+1
+    beq FmtLoop
+    ldy #0                  ; empty string in buffer
+    tya
+    sta (NumOutPtr),y
+FmtLoop:
+    jsr FmtGetCh
+    beq FmtDone
+    cmp #'%'
+    beq FmtSpec
+FmtEmit:
+    jsr NumEmit
+    jmp FmtLoop
+FmtDone:
+    lda NumOutPtr
+    ldx NumOutPtr+1
+    rts
+FmtSpec:
+    lda #' '
+    sta NumPad
+    lda #0
+    sta NumWidth
+    jsr FmtGetCh
+    cmp #'0'
+    bne FmtWidth
+    sta NumPad
+FmtWidthLp:
+    jsr FmtGetCh
+FmtWidth:
+    cmp #'9'+1
+    bcs FmtConv
+    cmp #'0'
+    bcc FmtConv
+    and #$0F
+    pha
+    lda NumWidth            ; width = width * 10 + digit
+    asl a
+    asl a
+    clc
+    adc NumWidth
+    asl a
+    sta NumWidth
+    pla
+    clc
+    adc NumWidth
+    sta NumWidth
+    jmp FmtWidthLp
+FmtConv:
+    cmp #0
+    beq FmtDone             ; format string ends after '%'
+    cmp #'c'
+    beq FmtChar
+    cmp #'s'
+    beq FmtStr
+    cmp #'d'
+    beq FmtDec
+    cmp #'u'
+    beq FmtUDec
+    cmp #'x'
+    beq FmtHex
+    cmp #'X'
+    beq FmtHex
+    bne FmtEmit             ; '%' or unknown, print as is
+FmtChar:
+    jsr FmtArg
+    jmp FmtEmit
+FmtStr:
+    jsr FmtArg
+    sta StrPtr
+    stx StrPtr+1
+FmtStrLp:
+    ldy #0
+    lda (StrPtr),y
+    beq FmtNext
+    jsr NumEmit
+    inc StrPtr
+    bne FmtStrLp
+    inc StrPtr+1
+    jmp FmtStrLp
+FmtDec:
+    jsr FmtArg
+    ldy NumWidth
+    jsr NumOutI16P
+    jmp FmtLoop
+FmtUDec:
+    jsr FmtArg
+    ldy NumWidth
+    jsr NumOutU16P
+    jmp FmtLoop
+FmtHex:
+    jsr FmtArg
+    ldy NumWidth
+    jsr NumOutHexP
+FmtNext:
+    jmp FmtLoop
+
+; Get next character of format string to A (pointer is not advanced past
+; the terminating zero). Z flag set at the end of string.
+FmtGetCh:
+    ldy #0
+    lda (FmtPtr),y
+    beq FmtGetChEnd
+    inc FmtPtr
+    bne FmtGetChNz
+    inc FmtPtr+1
+FmtGetChNz:
+    cmp #0
+FmtGetChEnd:
+    rts
+
+; Get next argument to A (lo) / X (hi).
+FmtArg:
+    sec
+    lda FmtArgPtr
+    sbc #2
+    sta FmtArgPtr
+    bcs FmtArgGet
+    dec FmtArgPtr+1
+FmtArgGet:
+    ldy #1
+    lda (FmtArgPtr),y
+    tax
+    dey
+    lda (FmtArgPtr),y
+    rts
+
+;-----------------------------------------------------------------------------
+; ROM library fast call jump table.
+; Same rules as for kernel jump table apply - entries stay at the same
+; addresses, new entries are only added at the end.
+;-----------------------------------------------------------------------------
+.segment "LIBJT"
+
+CallFastLibCall:    ; $FF77
+    jmp FastLibCall
+
+CallFastPuts:       ; $FF7A
+    jmp FastPuts
+
+CallFastMemCpy:     ; $FF7D
+    jmp FastMemCpy
+
+CallFastMemInit:    ; $FF80
+    jmp FastMemInit
+
+CallFastStrCpy:     ; $FF83
+    jmp FastStrCpy
+
+CallFastStrCat:     ; $FF86
+    jmp FastStrCat
+
+CallFastItoa:       ; $FF89
+    jmp FastItoa
+
+CallFastUtoa:       ; $FF8C
+    jmp FastUtoa
+
+CallFastMemSet:     ; $FF8F
+    jmp FastMemSet
+
+CallFastAtoi:       ; $FF92
+    jmp FastAtoi
+
+CallFastAtol:       ; $FF95
+    jmp FastAtol
+
+CallNumOutU16:      ; $FF98
+    jmp NumOutU16
+
+CallNumOutI16:      ; $FF9B
+    jmp NumOutI16
+
+CallNumOutHex:      ; $FF9E
+    jmp NumOutHex
+
+CallFmtOut:         ; $FFA1
+    jmp FmtOut
+
 ;-----------------------------------------------------------------------------
 ; Kernel jump table.
 ;-----------------------------------------------------------------------------
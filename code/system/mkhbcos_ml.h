@@ -40,6 +40,9 @@
  * 3/8/2018
  *    Added entries in kernel jump table.
  *
+ * 10/18/2026
+ *    Added pointer to UART RX queue.
+ *
  */
 
 #ifndef MKHBCOS_ML
@@ -53,6 +56,8 @@
                                               // flags
 #define UARTRXINPT  ((unsigned char *)0x00F2) // ptr to beg. of UART RX queue
 #define UARTRXOUTPT ((unsigned char *)0x00F3) // ptr to end of UART RX queue
+#define UARTRXQUE   ((unsigned char *)0x0300) // UART RX queue (256 bytes),
+                                              // filled by UART IRQ handler
 
 // masking flags and their complements
 
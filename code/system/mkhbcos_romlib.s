@@ -0,0 +1,107 @@
+;-----------------------------------------------------------------------------
+;
+; File: 	mkhbcos_romlib.s
+; Author:	Marek Karcz
+; Purpose:	C wrappers for ROM library fast call gate.
+;           This file is a part of MKHBCOS operating system programming API
+;           for MKHBC-8-Rx computer.
+;
+; Revision history:
+;
+;   2026-10-18
+;       Initial revision.
+;
+;-----------------------------------------------------------------------------
+
+.include "mkhbcos_ml.inc"
+
+.setcpu	"6502"
+.import popax,popa
+
+; code
+
+.export _romlib_call,_romlib_puts,_romlib_memcpy,_romlib_meminit
+
+; void __fastcall__ romlib_call(unsigned char func_code, void *args)
+
+.proc _romlib_call: near
+
+.segment "CODE"
+
+	pha                 ; save pointer to args
+	txa
+	pha
+	jsr popa            ; function code
+	sta tmp1
+	pla
+	tay                 ; Y - args hi
+	pla
+	tax                 ; X - args lo
+	lda tmp1
+	jmp romlib_FastLibCall
+
+.endproc
+
+; void __fastcall__ romlib_puts(const char *s)
+
+.proc _romlib_puts: near
+
+.segment "CODE"
+
+	jmp romlib_FastPuts
+
+.endproc
+
+; void* __fastcall__ romlib_memcpy(void *dst, const void *src, size_t n)
+
+.proc _romlib_memcpy: near
+
+.segment "CODE"
+
+	sta ptr1            ; save n
+	stx ptr1+1
+	jsr popax           ; source address
+	sta RomLibArg2
+	stx RomLibArg2+1
+	jsr popax           ; destination address
+	sta RomLibArg1
+	stx RomLibArg1+1
+	pha                 ; save destination to return it
+	txa
+	pha
+	lda ptr1
+	ldx ptr1+1
+	jsr romlib_FastMemCpy
+	pla
+	tax
+	pla
+	rts
+
+.endproc
+
+; void* __fastcall__ romlib_meminit(void *dst, unsigned char val, size_t n)
+
+.proc _romlib_meminit: near
+
+.segment "CODE"
+
+	sta ptr1            ; save n
+	stx ptr1+1
+	jsr popa            ; value
+	sta tmp1
+	jsr popax           ; destination address
+	sta RomLibArg1
+	stx RomLibArg1+1
+	pha                 ; save destination to return it
+	txa
+	pha
+	ldy tmp1
+	lda ptr1
+	ldx ptr1+1
+	jsr romlib_FastMemInit
+	pla
+	tax
+	pla
+	rts
+
+.endproc
@@ -0,0 +1,162 @@
+;-----------------------------------------------------------------------------
+;
+; File: 	mkhbcos_romrt.s
+; Author:	Marek Karcz
+; Purpose:	Stubs of C runtime routines resident in ROM library image.
+;           Archived into library mkhbcosrt.lib. Applications linked with
+;           this library (before mkhbcos.lib and cc65 runtime) use single copy
+;           of the routines in ROM instead of linking their own.
+;           This file is a part of MKHBCOS operating system programming API
+;           for MKHBC-8-Rx computer.
+;
+;           NOTE: Stubs cover all symbols exported by the cc65 runtime
+;                 modules they replace (memset.o - memset, bzero, _bzero;
+;                 atoi.o - atoi, atol), so the linker never pulls these
+;                 modules in and no symbol is defined twice.
+;
+; Revision history:
+;
+;   2026-10-18
+;       Initial revision.
+;
+;-----------------------------------------------------------------------------
+
+.include "mkhbcos_ml.inc"
+
+.setcpu	"6502"
+.import incsp2,incsp4,pushax
+
+; code
+
+.export _strcpy,_strcat,_itoa,_utoa,_memset,_atoi,_atol,_bzero,__bzero
+
+; char* __fastcall__ strcpy(char *dest, const char *src)
+
+.proc _strcpy: near
+
+.segment "CODE"
+
+	ldy #2
+	jsr stackargs
+	jsr romlib_FastStrCpy
+	jmp incsp2
+
+.endproc
+
+; char* __fastcall__ strcat(char *dest, const char *src)
+
+.proc _strcat: near
+
+.segment "CODE"
+
+	ldy #2
+	jsr stackargs
+	jsr romlib_FastStrCat
+	jmp incsp2
+
+.endproc
+
+; char* __fastcall__ itoa(int val, char *buf, int radix)
+
+.proc _itoa: near
+
+.segment "CODE"
+
+	ldy #4
+	jsr stackargs
+	jsr romlib_FastItoa
+	jmp incsp4
+
+.endproc
+
+; char* __fastcall__ utoa(unsigned val, char *buf, int radix)
+
+.proc _utoa: near
+
+.segment "CODE"
+
+	ldy #4
+	jsr stackargs
+	jsr romlib_FastUtoa
+	jmp incsp4
+
+.endproc
+
+; void* __fastcall__ memset(void *ptr, int c, size_t n)
+
+.proc _memset: near
+
+.segment "CODE"
+
+	ldy #4
+	jsr stackargs
+	jsr romlib_FastMemSet
+	jmp incsp4
+
+.endproc
+
+; int __fastcall__ atoi(const char *s)
+
+.proc _atoi: near
+
+.segment "CODE"
+
+	ldy #0
+	jmp romlib_FastAtoi
+
+.endproc
+
+; long __fastcall__ atol(const char *s)
+
+.proc _atol: near
+
+.segment "CODE"
+
+	ldy #0
+	jsr romlib_FastAtol
+	ldy RomLibArg2          ; high word of result
+	sty sreg
+	ldy RomLibArg2+1
+	sty sreg+1
+	rts
+
+.endproc
+
+; void __fastcall__ bzero(void *ptr, size_t n)
+; (memset with c = 0 pushed between the arguments)
+
+.segment "CODE"
+
+__bzero:
+
+.proc _bzero: near
+
+.segment "CODE"
+
+	sta RomLibArg3          ; save n
+	stx RomLibArg3+1
+	lda #0
+	tax
+	jsr pushax
+	lda RomLibArg3
+	ldx RomLibArg3+1
+	ldy #4
+	jsr stackargs
+	jsr romlib_FastMemSet
+	jmp incsp4
+
+.endproc
+
+.segment "CODE"
+
+; Pass pointer to arguments on C stack to ROM library (A, X, Y preserved).
+
+stackargs:
+
+	pha
+	lda sp
+	sta RomLibArg1
+	lda sp+1
+	sta RomLibArg1+1
+	pla
+	rts
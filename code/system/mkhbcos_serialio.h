@@ -12,6 +12,10 @@
  * 2/5/2018
  *  Added kbhit().
  *
+ * 10/18/2026
+ *  Added number output functions (ROM number formatting kernel).
+ *  Added mos_printf() and mos_sprintf().
+ *
  */
 
 #ifndef MKHBCOS_SERIALIO
@@ -26,6 +30,31 @@ int		__fastcall__	getc(void);
 int		__fastcall__	fgetc(void);
 int     __fastcall__    kbhit(void);
 
+/*
+ * Print number directly to serial console (UART TX queue), no buffers.
+ * Variants with suffix 0 print at least 'width' digits, zero padded
+ * (sign of negative value counts as a digit), e.g.: puthex0(4, 0x3F) prints
+ * 003F, putdec0(3, -7) prints -07.
+ */
+void    __fastcall__    putdec(int val);
+void    __fastcall__    putudec(unsigned val);
+void    __fastcall__    puthex(unsigned val);
+void    __fastcall__    putdec0(unsigned char width, int val);
+void    __fastcall__    putudec0(unsigned char width, unsigned val);
+void    __fastcall__    puthex0(unsigned char width, unsigned val);
+
+/*
+ * Formatted output in one pass (implemented in ROM), subset of printf:
+ * %d, %u, %x with width (e.g.: %5u, %02d, %04x), %s, %c, %%.
+ * mos_printf() prints directly to serial console (UART TX queue),
+ * mos_sprintf() writes to buf and returns pointer to the terminating null,
+ * so the output can be appended by next call.
+ * NOTE: Arguments must be 2 bytes each (int, unsigned, pointer, char
+ *       promoted to int). Long values are not supported.
+ */
+void                    mos_printf(const char *fmt, ...);
+char*                   mos_sprintf(char *buf, const char *fmt, ...);
+
 #define	ESC	0x1B
 
 #endif
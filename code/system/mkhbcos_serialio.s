@@ -26,17 +26,25 @@
 ;       procedure 'getcharacter'.
 ;       Got rid of function mos_puts().
 ;
+;   2026-10-18
+;       Added putdec(), putudec(), puthex() and fixed width zero padded
+;       variants putdec0(), putudec0(), puthex0(). These call number
+;       formatting kernel in ROM, which prints straight to UART TX queue.
+;       Added mos_printf() and mos_sprintf() (formatted output in ROM).
+;
 ;-----------------------------------------------------------------------------
 
 .include "mkhbcos_ml.inc"
 
 .setcpu	"6502"
 .import ldaxysp,pushax,popax,pusha,popa
-.import incsp2
+.import incsp2,addysp
 
 ; code
 
 .export _puts,_putchar,_gets,_getchar,_getc,_fgetc,_kbhit
+.export _putdec,_putudec,_puthex,_putdec0,_putudec0,_puthex0
+.export _mos_printf,_mos_sprintf
 ;_mos_puts
 ;,_read
 
@@ -158,3 +166,178 @@ getcharacter:
     jsr mos_CallGetCh
     ldx #$00
     rts
+
+; void __fastcall__ putdec(int val)
+
+.proc _putdec: near
+
+.segment "CODE"
+
+	ldy #$00
+	jmp numout_i16
+
+.endproc
+
+; void __fastcall__ putudec(unsigned val)
+
+.proc _putudec: near
+
+.segment "CODE"
+
+	ldy #$00
+	jmp numout_u16
+
+.endproc
+
+; void __fastcall__ puthex(unsigned val)
+
+.proc _puthex: near
+
+.segment "CODE"
+
+	ldy #$00
+	jmp numout_hex
+
+.endproc
+
+; void __fastcall__ putdec0(unsigned char width, int val)
+
+.proc _putdec0: near
+
+.segment "CODE"
+
+	jsr popwidth
+	jmp numout_i16
+
+.endproc
+
+; void __fastcall__ putudec0(unsigned char width, unsigned val)
+
+.proc _putudec0: near
+
+.segment "CODE"
+
+	jsr popwidth
+	jmp numout_u16
+
+.endproc
+
+; void __fastcall__ puthex0(unsigned char width, unsigned val)
+
+.proc _puthex0: near
+
+.segment "CODE"
+
+	jsr popwidth
+	jmp numout_hex
+
+.endproc
+
+.segment "CODE"
+
+; Pop width argument from C stack to Y (A, X preserved).
+
+popwidth:
+
+	pha
+	jsr popa
+	tay
+	pla
+	rts
+
+; Select UART TX queue as output of ROM number formatting kernel
+; and call it (A, X, Y preserved).
+
+numout_i16:
+
+	jsr numout_tx
+	jmp romlib_NumOutI16
+
+numout_u16:
+
+	jsr numout_tx
+	jmp romlib_NumOutU16
+
+numout_hex:
+
+	jsr numout_tx
+	jmp romlib_NumOutHex
+
+numout_tx:
+
+	pha
+	lda #$00
+	sta RomLibArg2+1
+	pla
+	rts
+
+; void mos_printf(const char *fmt, ...)
+; (variadic: all arguments on C stack, Y - size of arguments)
+
+.proc _mos_printf: near
+
+.segment "CODE"
+
+	tya
+	pha                 ; size of arguments, to clean up C stack
+	dey
+	dey                 ; Y - offset of fmt (1-st argument)
+	jsr numout_tx
+	jsr fmtout
+	pla
+	tay
+	jmp addysp
+
+.endproc
+
+; char* mos_sprintf(char *buf, const char *fmt, ...)
+; Returns pointer to terminating null of the string in buf.
+
+.proc _mos_sprintf: near
+
+.segment "CODE"
+
+	tya
+	pha                 ; size of arguments, to clean up C stack
+	dey
+	lda (sp),y          ; buf (1-st argument) is the output
+	sta RomLibArg2+1
+	dey
+	lda (sp),y
+	sta RomLibArg2
+	dey
+	dey                 ; Y - offset of fmt (2-nd argument)
+	jsr fmtout
+	sta tmp_zpgPt       ; end of string
+	stx tmp_zpgPt+1
+	pla
+	tay
+	jsr addysp
+	lda tmp_zpgPt
+	ldx tmp_zpgPt+1
+	rts
+
+.endproc
+
+.segment "CODE"
+
+; Call ROM formatted output, fmt is on C stack at offset Y.
+; Argument list starts at fmt (cc65 va_list).
+
+fmtout:
+
+	lda (sp),y
+	sta RomLibArg1
+	iny
+	lda (sp),y
+	sta RomLibArg1+1
+	dey
+	tya
+	clc
+	adc sp
+	pha
+	lda sp+1
+	adc #$00
+	tax
+	pla
+	jmp romlib_FmtOut
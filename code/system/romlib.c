@@ -26,6 +26,18 @@
  * 2/24/2018
  *  Bug fixes. Refactoring.
  *
+ * 10/18/2026
+ *  Second ABI: fast call gate. Hot functions (puts, memory copy, memory init)
+ *  have direct entry points in LIBJT jump table (see mkhbcos_fmware.s) with
+ *  arguments in registers. These do not go through main() and C runtime
+ *  initialization at all. This entry point remains for the remaining
+ *  functions and for backwards compatibility.
+ *  C runtime routines linked in this image (strcpy, strcat, itoa, utoa,
+ *  memset, atoi) are shared with applications via the same jump table
+ *  (applications link stubs from mkhbcosrt.lib).
+ *  date_show() prints with mos_printf() (formatted output in ROM) instead of
+ *  building strings with strcpy() / strcat() / itoa() chains.
+ *
  */
 
 #include <stdlib.h>
@@ -43,7 +55,6 @@ extern uint16_t _IO7_START__, _IO7_SIZE__;
 
 #define TXTBUF_SIZE     80
 #define IBUF1_SIZE      30
-#define IBUF2_SIZE      30
 #define IBUF3_SIZE      30
 #define RADIX_DEC       10
 #define RADIX_HEX       16
@@ -58,7 +69,7 @@ extern uint16_t _IO7_START__, _IO7_SIZE__;
 struct ds1685_clkdata	clkdata;
 
 char txtbuf[TXTBUF_SIZE];
-char ibuf1[IBUF1_SIZE], ibuf2[IBUF2_SIZE], ibuf3[IBUF3_SIZE];
+char ibuf1[IBUF1_SIZE], ibuf3[IBUF3_SIZE];
 
 const char *daysofweek[8] =
 {
@@ -82,60 +93,28 @@ void memory_dump(uint16_t staddr, uint16_t enaddr);
  */
 void date_show(void)
 {
+    const char *dow = "???";
+    const char *mon = "???";
+
     if (RTCDETECTED) {
 
         ds1685_rdclock (&clkdata);
 
-        memset(ibuf1, 0, IBUF1_SIZE);
-        memset(ibuf2, 0, IBUF2_SIZE);
-        //memset(ibuf3, 0, IBUF3_SIZE);
-        strcpy(ibuf1, "Date: ");
-
-        if (clkdata.dayofweek > 0 && clkdata.dayofweek < 8)	{
-           strcat(ibuf1, daysofweek[clkdata.dayofweek-1]);
-        } else {
-
-            strcat(ibuf1, "???");
-        }
-        strcat(ibuf1, ", ");
-        strcat(ibuf1, itoa(clkdata.date, ibuf3, RADIX_DEC));
-        strcat(ibuf1, " ");
+        if (clkdata.dayofweek > 0 && clkdata.dayofweek < 8)
+            dow = daysofweek[clkdata.dayofweek-1];
         if (clkdata.month > 0 && clkdata.month < 13)
-            strcat(ibuf1, monthnames[clkdata.month-1]);
-        else
-            strcat(ibuf1, "???");
-        strcat(ibuf1, " ");
+            mon = monthnames[clkdata.month-1];
+        mos_printf("Date: %s, %d %s ", dow, clkdata.date, mon);
         if (clkdata.century < 100)
-            strcat(ibuf1, itoa(clkdata.century, ibuf3, RADIX_DEC));
+            mos_printf("%d", clkdata.century);
         else
-            strcat(ibuf1, "??");
-        if(clkdata.year < 100)
-        {
-            if (clkdata.year < 10)
-                strcat(ibuf1, "0");
-            strcat(ibuf1, itoa(clkdata.year, ibuf3, RADIX_DEC));
-        }
+            puts("??");
+        if (clkdata.year < 100)
+            mos_printf("%02d\r\n", clkdata.year);
         else
-            strcat(ibuf1, "??");
-
-        strcat(ibuf1, "\r\n");
-        puts(ibuf1);
-
-        strcpy(ibuf2, "Time: ");
-        if (clkdata.hours < 10)
-            strcat(ibuf2, "0");
-        strcat(ibuf2, itoa(clkdata.hours, ibuf3, RADIX_DEC));
-        strcat(ibuf2, " : ");
-        if (clkdata.minutes < 10)
-            strcat(ibuf2, "0");
-        strcat(ibuf2, itoa(clkdata.minutes, ibuf3, RADIX_DEC));
-        strcat(ibuf2, " : ");
-        if (clkdata.seconds < 10)
-            strcat(ibuf2, "0");
-        strcat(ibuf2, itoa(clkdata.seconds, ibuf3, RADIX_DEC));
-
-        strcat(ibuf2, "\r\n");
-        puts(ibuf2);
+            puts("??\r\n");
+        mos_printf("Time: %02d : %02d : %02d\r\n",
+                   clkdata.hours, clkdata.minutes, clkdata.seconds);
         POKEW(RETPTR, (uint16_t) &clkdata);
     } else {
         puts("RTC not detected.\n\r");
@@ -280,7 +259,7 @@ int main (void)
 
     switch(func_code) {
         case 0: // Function #0 : Print information about library.
-            puts("MKHBCROM library 1.5.0.\n\r"
+            puts("MKHBCROM library 1.6.0.\n\r"
                  "(C) Marek Karcz 2018, 2020. All rights reserved.\n\r");
             break;
         case 1: // Function #1 : Print date / time.
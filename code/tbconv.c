@@ -0,0 +1,350 @@
+/*
+ *----------------------------------------------------------------------------
+ * File:  tbconv.c
+ *
+ * Author: Marek Karcz
+ *
+ * Date created: 10/18/2026
+ *
+ * Purpose:
+ *
+ *    Converting text exported from text editor (texted, command 'w') running
+ *    on MKHBC-8-Rx homebrew 8-bit computer system to plain text file and
+ *    plain text file to data that can be imported by texted (command
+ *    'u bin').
+ *    Exported data is captured by terminal emulation program to a file
+ *    (binary capture, e.g.: Tera Term "Log" with "Binary" option). Anything
+ *    captured before the 1-st frame is ignored. Data for import is sent with
+ *    "Send File" feature with "Binary" option.
+ *
+ *    Data is a stream of frames:
+ *       SOH ($01), type, length of data (2 bytes, LSB first), data,
+ *       CRC-16 (XMODEM) of type, length and data (2 bytes, MSB first).
+ *    All bytes after SOH equal to $01, $10, $11 or $13 are sent as
+ *    $10, byte ^ $20. Frame types:
+ *       'R' - text records: length of text (1 byte), 2 bytes (not used),
+ *             text, $00,
+ *       'E' - the last frame, data is # of lines (2 bytes, LSB first).
+ *
+ *    Usage:
+ *       tbconv -d -f CaptureFile -o TextFile
+ *       tbconv -e -f TextFile -o DataFile
+ *
+ *    Build:
+ *       gcc -o tbconv tbconv.c
+ *
+ * Revision history:
+ *
+ * 10/18/2026:
+ * 	Created.
+ *----------------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SOH          0x01
+#define DLE          0x10
+#define XON          0x11
+#define XOFF         0x13
+#define ESCXOR       0x20
+#define TYPE_RECORDS 'R'
+#define TYPE_END     'E'
+#define MAX_TEXTLEN  79     // longest line of text editor
+#define MAX_FRAME    4096   // max. length of data in frame made by tbconv
+
+char g_szInputFileName[256];
+char g_szOutputFileName[256];
+int g_nEncode = 0;
+int g_nDecode = 0;
+
+unsigned short g_nCrc = 0;
+FILE *g_fpi = NULL;
+FILE *g_fpo = NULL;
+int g_nFrameErr = 0;
+
+void ScanArgs(int argc, char *argv[]);
+void Usage(void);
+void CrcAdd(unsigned char b);
+void PutByte(unsigned char b);
+void PutFrame(int type, unsigned char *data, int len);
+int GetByte(void);
+int DecodeFile(void);
+int EncodeFile(void);
+
+int main(int argc, char *argv[])
+{
+   int ret = 1;
+
+   ScanArgs(argc, argv);
+   if (g_nEncode == g_nDecode
+       || 0 == strlen(g_szInputFileName)
+       || 0 == strlen(g_szOutputFileName))
+   {
+      Usage();
+      return 1;
+   }
+   if (NULL == (g_fpi = fopen(g_szInputFileName, "rb")))
+   {
+      printf("Unable to open %s\n", g_szInputFileName);
+      return 1;
+   }
+   if (NULL == (g_fpo = fopen(g_szOutputFileName, "wb")))
+   {
+      printf("Unable to create %s\n", g_szOutputFileName);
+      fclose(g_fpi);
+      return 1;
+   }
+   if (g_nDecode)
+      ret = DecodeFile();
+   else
+      ret = EncodeFile();
+   fclose(g_fpi);
+   fclose(g_fpo);
+
+   return ret;
+}
+
+/*
+ * tbconv -d|-e -f InputFile -o OutputFile
+ */
+void ScanArgs(int argc, char *argv[])
+{
+   int n = 1;
+
+   while (n < argc)
+   {
+      if (strcmp(argv[n], "-f") == 0 && n + 1 < argc)
+      {
+         n++;
+         strncpy(g_szInputFileName, argv[n], 255);
+      }
+      else if (strcmp(argv[n], "-o") == 0 && n + 1 < argc)
+      {
+         n++;
+         strncpy(g_szOutputFileName, argv[n], 255);
+      }
+      else if (strcmp(argv[n], "-d") == 0)
+      {
+         g_nDecode = 1;
+      }
+      else if (strcmp(argv[n], "-e") == 0)
+      {
+         g_nEncode = 1;
+      }
+
+      n++;
+   }
+}
+
+void Usage(void)
+{
+   printf("Usage:\n");
+   printf("   tbconv -d -f CaptureFile -o TextFile\n");
+   printf("      convert data exported by texted to text file\n");
+   printf("   tbconv -e -f TextFile -o DataFile\n");
+   printf("      convert text file to data to import by texted\n");
+}
+
+/*
+ * Update CRC-16 (polynomial $1021, XMODEM) with byte b.
+ */
+void CrcAdd(unsigned char b)
+{
+   int i;
+
+   g_nCrc ^= (unsigned short)b << 8;
+   for (i = 0; i < 8; i++)
+   {
+      if (g_nCrc & 0x8000)
+         g_nCrc = (g_nCrc << 1) ^ 0x1021;
+      else
+         g_nCrc <<= 1;
+   }
+}
+
+/*
+ * Write byte of a frame, escape it if needed, update CRC.
+ */
+void PutByte(unsigned char b)
+{
+   CrcAdd(b);
+   if (b == SOH || b == DLE || b == XON || b == XOFF)
+   {
+      fputc(DLE, g_fpo);
+      b ^= ESCXOR;
+   }
+   fputc(b, g_fpo);
+}
+
+void PutFrame(int type, unsigned char *data, int len)
+{
+   int i;
+   unsigned short crc;
+
+   fputc(SOH, g_fpo);
+   g_nCrc = 0;
+   PutByte(type);
+   PutByte(len & 0xFF);
+   PutByte(len >> 8);
+   for (i = 0; i < len; i++)
+      PutByte(data[i]);
+   crc = g_nCrc;
+   PutByte(crc >> 8);
+   PutByte(crc & 0xFF);
+}
+
+/*
+ * Return next unescaped byte of a frame, update CRC.
+ * Return -1 at the end of file or if a new frame starts (g_nFrameErr set).
+ */
+int GetByte(void)
+{
+   int c = fgetc(g_fpi);
+
+   if (c == DLE)
+   {
+      c = fgetc(g_fpi);
+      if (c != EOF)
+         c ^= ESCXOR;
+   }
+   else if (c == SOH)
+   {
+      ungetc(c, g_fpi);
+      c = EOF;
+   }
+   if (c == EOF)
+   {
+      g_nFrameErr = 1;
+      return -1;
+   }
+   CrcAdd((unsigned char)c);
+
+   return c;
+}
+
+/*
+ * Convert captured data to text file.
+ */
+int DecodeFile(void)
+{
+   int c, type, len, n, reclen, i, hi, lo;
+   int frames = 0, lines = 0, badframes = 0, total = -1;
+   unsigned short crc;
+   char text[256];
+
+   printf("Processing...\n");
+   while (total < 0)
+   {
+      // skip everything up to the start of frame
+      while ((c = fgetc(g_fpi)) != EOF && c != SOH)
+         ;
+      if (c == EOF)
+         break;
+      g_nCrc = 0;
+      g_nFrameErr = 0;
+      type = GetByte();
+      len = GetByte();
+      len |= GetByte() << 8;
+      if (type == TYPE_RECORDS)
+      {
+         for (n = 0; n < len && 0 == g_nFrameErr; n += reclen + 4)
+         {
+            reclen = GetByte();
+            GetByte();
+            GetByte();
+            for (i = 0; i <= reclen && 0 == g_nFrameErr; i++)
+               text[i] = (char)GetByte();
+            if (g_nFrameErr || text[reclen] != 0
+                || (int)strlen(text) != reclen)
+            {
+               g_nFrameErr = 1;
+               break;
+            }
+            fprintf(g_fpo, "%s\n", text);
+            lines++;
+         }
+      }
+      else if (type == TYPE_END)
+      {
+         lo = GetByte();
+         hi = GetByte();
+         if (0 == g_nFrameErr)
+            total = (hi << 8) | lo;
+      }
+      else
+      {
+         g_nFrameErr = 1;
+      }
+      crc = g_nCrc;
+      hi = GetByte();
+      lo = GetByte();
+      if (g_nFrameErr || hi != (crc >> 8) || lo != (crc & 0xFF))
+      {
+         printf("Frame #%d is bad (CRC or format error).\n", frames);
+         badframes++;
+         total = -1;
+      }
+      frames++;
+   }
+   printf("%d frames, %d lines.\n", frames, lines);
+   if (total < 0)
+   {
+      printf("End of data not found.\n");
+      return 1;
+   }
+   if (total != lines)
+   {
+      printf("%d lines were exported.\n", total);
+      return 1;
+   }
+
+   return badframes ? 1 : 0;
+}
+
+/*
+ * Convert text file to data for import.
+ */
+int EncodeFile(void)
+{
+   unsigned char frame[MAX_FRAME];
+   char line[1024];
+   int len = 0, reclen, lines = 0, truncated = 0;
+   unsigned char cnt[2];
+
+   printf("Processing...\n");
+   while (NULL != fgets(line, sizeof(line), g_fpi))
+   {
+      line[strcspn(line, "\r\n")] = 0;
+      reclen = strlen(line);
+      if (reclen > MAX_TEXTLEN)
+      {
+         reclen = MAX_TEXTLEN;
+         line[reclen] = 0;
+         truncated++;
+      }
+      if (len + reclen + 4 > MAX_FRAME)
+      {
+         PutFrame(TYPE_RECORDS, frame, len);
+         len = 0;
+      }
+      frame[len] = (unsigned char)reclen;
+      frame[len + 1] = 0;
+      frame[len + 2] = 0;
+      memcpy(frame + len + 3, line, reclen + 1);
+      len += reclen + 4;
+      lines++;
+   }
+   if (len > 0)
+      PutFrame(TYPE_RECORDS, frame, len);
+   cnt[0] = lines & 0xFF;
+   cnt[1] = lines >> 8;
+   PutFrame(TYPE_END, cnt, 2);
+   printf("%d lines.\n", lines);
+   if (truncated)
+      printf("%d lines longer than %d characters truncated.\n",
+             truncated, MAX_TEXTLEN);
+
+   return 0;
+}
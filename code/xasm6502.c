@@ -0,0 +1,583 @@
+/*
+ *----------------------------------------------------------------------------
+ * File:  xasm6502.c
+ *
+ * Author: Marek Karcz
+ *
+ * Date created: 10/18/2026
+ *
+ * Purpose:
+ *
+ *    MOS 6502 cross assembler for host computer. It is built from the same
+ *    assembler core (apps/asm6502core.c) as asm6502 running on MKHBC-8-Rx
+ *    homebrew 8-bit computer system, so the source code is assembled
+ *    exactly the same way. This file replaces the I/O of asm6502: source
+ *    code is read from text file, symbol table is kept in host memory and
+ *    machine code is written to a file.
+ *
+ *    Output file is a binary image of memory from the lowest to the highest
+ *    address of machine code (gaps are filled with 0) or (option -w) text
+ *    with monitor commands 'w hhhh bb ...', the same as asm6502 puts in its
+ *    output buffer.
+ *    Option -t N assembles the source N times and shows the speed of the
+ *    assembler core in lines per second.
+ *    Option -i N File gives the file of source unit N (0..7) for directive
+ *    '.include N', it stands for text buffer in RAM bank# N of asm6502.
+ *
+ *    Usage:
+ *       xasm6502 -f SourceFile [-i N File ...] [-o OutputFile] [-w] [-1] [-b]
+ *                [-p] [-l] [-t N]
+ *
+ *    Build:
+ *       gcc -o xasm6502 xasm6502.c apps/asm6502core.c
+ *
+ * Revision history:
+ *
+ * 10/18/2026
+ * 	Created.
+ *
+ * 10/18/2026
+ * 	Option -p - peephole optimization (option 'o' of asm6502).
+ *
+ * 10/18/2026
+ * 	Option -i - source units for .include, macros are read again from
+ * 	source units for each call.
+ *----------------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "apps/asm6502core.h"
+
+#define MAX_LINES       65536
+#define SYMB_SLOTS      8192    // hash table slots, power of 2
+#define SYMB_MAXCOUNT   (SYMB_SLOTS / 8 * 7)
+#define OUT_MAXBYTES    16      // max. # of bytes in line of 'w' command
+#define SRC_UNITS       9       // source units: 0..7 - .include,
+#define SRC_MAIN        8       //  source code (-f)
+#define SRC_DEPTH       8       // max. # of nested .include and macro calls
+
+struct symbol {
+   char name[SYMB_NAMELEN];
+   unsigned char len;
+   unsigned char flags;
+   uint16_t val;
+};
+
+// Source unit being assembled, position of the next line.
+struct source {
+   int unit;
+   int line;
+   int macro;     // lines of macro, see mac_line()
+};
+
+char g_szInputFileName[256];
+char g_aszUnitFileName[SRC_UNITS][256];
+char g_szOutputFileName[256];
+int g_nText = 0;
+int g_nPasses = ASM_MAXPASS;
+int g_nOpts = 0;
+int g_nRuns = 0;
+int g_nQuiet = 0;
+
+char **g_appUnit[SRC_UNITS];
+int g_anUnitLines[SRC_UNITS];
+struct source g_aSrc[SRC_DEPTH];
+int g_nSrcDepth = 0;
+struct symbol g_aSymb[SYMB_MAXCOUNT];
+int g_nSymbCount = 0;
+uint16_t g_anSlot[SYMB_SLOTS];   // index of symbol + 1, 0 - empty slot
+unsigned char g_aImage[0x10000];
+unsigned char g_aUsed[0x10000];
+long g_nLow, g_nHigh;
+
+void ScanArgs(int argc, char *argv[]);
+void Usage(void);
+int ReadSource(int unit);
+void Assemble(void);
+void SourcePush(int unit, int line, int macro);
+void Emit(void);
+void FixResolve(void);
+void FixError(int errnum, const struct fixup *f);
+int WriteOutput(void);
+void Report(void);
+
+int main(int argc, char *argv[])
+{
+   int i;
+   clock_t t0, t1;
+   double secs;
+   long lines;
+
+   ScanArgs(argc, argv);
+   if (0 == strlen(g_szInputFileName)
+       || (0 == strlen(g_szOutputFileName) && 0 == g_nRuns
+           && 0 == (g_nOpts & OPT_LIST))
+       || ((g_nOpts & OPT_PEEP) && 1 == g_nPasses))
+   {
+      Usage();
+      return 1;
+   }
+   strcpy(g_aszUnitFileName[SRC_MAIN], g_szInputFileName);
+   for (i = 0; i < SRC_UNITS; i++)
+   {
+      if (strlen(g_aszUnitFileName[i]) && ReadSource(i))
+         return 1;
+   }
+   Assemble();
+   Report();
+   if (asm_errors)
+      return 1;
+   if (strlen(g_szOutputFileName) && WriteOutput())
+      return 1;
+   if (g_nRuns > 0)
+   {
+      g_nQuiet = 1;
+      lines = (long)g_nRuns * asm_line;
+      t0 = clock();
+      for (i = 0; i < g_nRuns; i++)
+         Assemble();
+      t1 = clock();
+      secs = (double)(t1 - t0) / CLOCKS_PER_SEC;
+      printf("%d runs, %ld lines in %.3f s", g_nRuns, lines, secs);
+      if (secs > 0)
+         printf(", %.0f lines/s", (double)lines / secs);
+      printf("\n");
+   }
+
+   return 0;
+}
+
+/*
+ * xasm6502 -f SourceFile [-i N File ...] [-o OutputFile] [-w] [-1] [-b]
+ *          [-p] [-l] [-t N]
+ */
+void ScanArgs(int argc, char *argv[])
+{
+   int n = 1;
+   int unit;
+
+   while (n < argc)
+   {
+      if (strcmp(argv[n], "-f") == 0 && n + 1 < argc)
+      {
+         n++;
+         strncpy(g_szInputFileName, argv[n], 255);
+      }
+      else if (strcmp(argv[n], "-o") == 0 && n + 1 < argc)
+      {
+         n++;
+         strncpy(g_szOutputFileName, argv[n], 255);
+      }
+      else if (strcmp(argv[n], "-i") == 0 && n + 2 < argc)
+      {
+         unit = atoi(argv[n + 1]);
+         n += 2;
+         if (unit >= 0 && unit < SRC_MAIN)
+            strncpy(g_aszUnitFileName[unit], argv[n], 255);
+      }
+      else if (strcmp(argv[n], "-t") == 0 && n + 1 < argc)
+      {
+         n++;
+         g_nRuns = atoi(argv[n]);
+      }
+      else if (strcmp(argv[n], "-w") == 0)
+      {
+         g_nText = 1;
+      }
+      else if (strcmp(argv[n], "-1") == 0)
+      {
+         g_nPasses = 1;
+      }
+      else if (strcmp(argv[n], "-b") == 0)
+      {
+         g_nOpts |= OPT_LONGBR;
+      }
+      else if (strcmp(argv[n], "-p") == 0)
+      {
+         g_nOpts |= OPT_PEEP;
+      }
+      else if (strcmp(argv[n], "-l") == 0)
+      {
+         g_nOpts |= OPT_LIST;
+      }
+
+      n++;
+   }
+}
+
+void Usage(void)
+{
+   printf("Usage:\n");
+   printf("   xasm6502 -f SourceFile [-i N File ...] [-o OutputFile] [-w] [-1] [-b]\n");
+   printf("            [-p] [-l] [-t N]\n");
+   printf("      -i - File is source unit N (0..7) for '.include N'\n");
+   printf("      -o - write machine code (binary image) to OutputFile\n");
+   printf("      -w - write monitor commands 'w hhhh bb ...' instead\n");
+   printf("      -1 - single pass, forward references are patched at the end\n");
+   printf("      -b - branch out of range to inverted branch over jmp\n");
+   printf("      -p - optimize: redundant lda, jsr+rts, unreachable nop,\n");
+   printf("           branch over jmp (not with -1)\n");
+   printf("      -l - list assembled code with cycles of instructions\n");
+   printf("      -t - assemble N more times, show speed in lines/s\n");
+}
+
+/*
+ * Read lines of source code of unit. Lines longer than the longest line
+ * of text editor are truncated.
+ */
+int ReadSource(int unit)
+{
+   FILE *fp;
+   char line[1024];
+   char **lines;
+   int len, n = 0, truncated = 0;
+
+   if (NULL == (fp = fopen(g_aszUnitFileName[unit], "r")))
+   {
+      printf("Unable to open %s\n", g_aszUnitFileName[unit]);
+      return 1;
+   }
+   lines = malloc(MAX_LINES * sizeof(char *));
+   while (NULL != fgets(line, sizeof(line), fp))
+   {
+      if (n == MAX_LINES)
+      {
+         printf("More than %d lines in %s.\n", MAX_LINES,
+                g_aszUnitFileName[unit]);
+         fclose(fp);
+         return 1;
+      }
+      line[strcspn(line, "\r\n")] = 0;
+      len = strlen(line);
+      if (len > ASM_LINESIZE - 1)
+      {
+         line[ASM_LINESIZE - 1] = 0;
+         truncated++;
+      }
+      lines[n++] = strdup(line);
+   }
+   fclose(fp);
+   g_appUnit[unit] = lines;
+   g_anUnitLines[unit] = n;
+   if (truncated)
+      printf("%d lines of %s longer than %d characters truncated.\n",
+             truncated, g_aszUnitFileName[unit], ASM_LINESIZE - 1);
+
+   return 0;
+}
+
+/*
+ * Assemble the source code to g_aImage. Lines of units included by
+ * .include and of called macros are assembled in place of the line.
+ */
+void Assemble(void)
+{
+   struct source *src;
+   unsigned char r;
+
+   memset(g_anSlot, 0, sizeof(g_anSlot));
+   memset(g_aUsed, 0, sizeof(g_aUsed));
+   g_nSymbCount = 0;
+   g_nLow = 0x10000;
+   g_nHigh = -1;
+   asm_main = SRC_MAIN;
+   asm_start(g_nPasses, g_nOpts);
+   do
+   {
+      asm_begin();
+      g_nSrcDepth = 0;
+      SourcePush(SRC_MAIN, 0, 0);
+      while (g_nSrcDepth > 0)
+      {
+         src = &g_aSrc[g_nSrcDepth - 1];
+         if (src->line >= g_anUnitLines[src->unit])
+         {
+            if (src->macro)
+            {
+               asm_error(ERROR_MACRO);    // no .endm
+               mac_exit();
+            }
+            g_nSrcDepth--;
+            continue;
+         }
+         asm_unit = (unsigned char)src->unit;
+         asm_pos = (uint16_t)src->line;
+         asm_srcline = src->line;
+         strcpy(asm_buf, g_appUnit[src->unit][src->line++]);
+         if (src->macro)
+         {
+            r = mac_line(asm_buf);
+            if (MAC_END == r)
+               g_nSrcDepth--;
+            if (MAC_LINE != r)
+               continue;
+         }
+         asm6502(asm_buf);
+         if (asm_emit)
+         {
+            if (asm_opts & OPT_LIST)
+               list_line();
+            if (asm_len)
+               Emit();
+         }
+         asm_next();
+         if (SRC_NONE != asm_include)
+         {
+            if (asm_include >= SRC_MAIN || NULL == g_appUnit[asm_include])
+               asm_error(ERROR_BADBANK);
+            else
+               SourcePush(asm_include, 0, 0);
+         }
+         if (asm_call)
+            SourcePush(mac_unit, mac_pos, 1);
+      }
+   } while (0 == asm_end());
+   FixResolve();
+}
+
+/*
+ * Continue assembly with lines of unit from line (macro: the .macro line).
+ */
+void SourcePush(int unit, int line, int macro)
+{
+   struct source *src = &g_aSrc[g_nSrcDepth];
+
+   if (SRC_DEPTH == g_nSrcDepth)
+   {
+      asm_error(ERROR_NESTING);
+      if (macro)
+         mac_exit();
+      return;
+   }
+   src->unit = unit;
+   src->line = line;
+   src->macro = macro;
+   g_nSrcDepth++;
+}
+
+/*
+ * Put machine code of the line to memory image, set addresses of fixups.
+ */
+void Emit(void)
+{
+   unsigned int f;
+   int i;
+   uint16_t addr;
+
+   for (f = fix_line; f < fix_count; f++)
+      fixups[f].loc = (uint16_t)(asm_pc + fixups[f].col);
+   for (i = 0; i < asm_len; i++)
+   {
+      addr = (uint16_t)(asm_pc + i);
+      g_aImage[addr] = asm_code[i];
+      g_aUsed[addr] = 1;
+      if (addr < g_nLow)
+         g_nLow = addr;
+      if (addr > g_nHigh)
+         g_nHigh = addr;
+   }
+   asm_bytes += asm_len;
+}
+
+/*
+ * Patch values of forward references in memory image.
+ */
+void FixResolve(void)
+{
+   struct fixup *f = fixups;
+   unsigned int i;
+   uint16_t val;
+
+   for (i = 0; i < fix_count; i++, f++)
+   {
+      if (0 == symb_read(f->sym, &val))
+      {
+         FixError(ERROR_UNDEFSYMB, f);
+         continue;
+      }
+      val += f->addend;
+      if (FIX_LO == f->type)
+         val &= 0xFF;
+      else if (FIX_HI == f->type)
+         val >>= 8;
+      else if (FIX_BYTE == f->type && val > 0xFF && val < 0xFF80)
+         FixError(ERROR_RANGE, f);
+      else if (FIX_REL == f->type && val >= 0x80 && val < 0xFF80)
+         FixError(ERROR_BRANCH, f);
+      g_aImage[f->loc] = (unsigned char)val;
+      if (FIX_WORD == f->type)
+         g_aImage[(uint16_t)(f->loc + 1)] = (unsigned char)(val >> 8);
+   }
+}
+
+/*
+ * Report error errnum of fixup f: line of source code the fixup comes from
+ * and its symbol.
+ */
+void FixError(int errnum, const struct fixup *f)
+{
+   struct symbol *s = &g_aSymb[f->sym - 1];
+
+   if (0 == g_nQuiet)
+   {
+      printf("\nERROR in line #%u", f->line);
+      if (f->unit != asm_main)
+         printf(" of bank#%u", f->unit);
+      printf(": %s\nSymbol: %.*s\n", ga_errmsg[errnum], s->len, s->name);
+   }
+   asm_errors++;
+}
+
+/*
+ * Write memory image from the lowest to the highest address of code to
+ * the output file, as binary data or as monitor commands.
+ */
+int WriteOutput(void)
+{
+   FILE *fp;
+   long addr;
+   int n = 0;
+
+   if (g_nHigh < 0)
+   {
+      printf("No machine code.\n");
+      return 1;
+   }
+   if (NULL == (fp = fopen(g_szOutputFileName, g_nText ? "w" : "wb")))
+   {
+      printf("Unable to create %s\n", g_szOutputFileName);
+      return 1;
+   }
+   if (0 == g_nText)
+   {
+      fwrite(g_aImage + g_nLow, 1, g_nHigh - g_nLow + 1, fp);
+      fclose(fp);
+      return 0;
+   }
+   for (addr = g_nLow; addr <= g_nHigh; addr++)
+   {
+      if (0 == g_aUsed[addr] || OUT_MAXBYTES == n)
+      {
+         if (n)
+            fprintf(fp, "\n");
+         n = 0;
+         if (0 == g_aUsed[addr])
+            continue;
+      }
+      if (0 == n)
+         fprintf(fp, "w %04lX", addr);
+      fprintf(fp, " %02X", g_aImage[addr]);
+      n++;
+   }
+   if (n)
+      fprintf(fp, "\n");
+   fclose(fp);
+
+   return 0;
+}
+
+void Report(void)
+{
+   printf("--------------------------------------------\n");
+   printf("Lines....................: %u\n", asm_line);
+   printf("Passes...................: %d\n", asm_pass);
+   printf("Bytes of code............: %u\n", asm_bytes);
+   if (asm_opts & OPT_PEEP)
+   {
+      printf("Optimized lines..........: %u\n", peep_lines);
+      printf("Bytes saved..............: %u\n", peep_bytes);
+      printf("Cycles saved.............: %u\n", peep_cycles);
+   }
+   printf("Forward references.......: %u\n", fix_count);
+   printf("Symbols..................: %d\n", g_nSymbCount);
+   if (g_nHigh >= 0)
+      printf("Code address.............: $%04lX - $%04lX\n", g_nLow, g_nHigh);
+   printf("Errors...................: %u\n", asm_errors);
+   printf("--------------------------------------------\n");
+}
+
+/*
+ * Symbol table used by assembler core. Symbol is referred to by its index
+ * in g_aSymb + 1. Names are hashed the same way as in asm6502.
+ */
+uint16_t symb_find(const char *name, unsigned char len, unsigned char add)
+{
+   uint16_t h = 0;
+   int i;
+   struct symbol *s;
+
+   if (len > SYMB_NAMELEN)
+      len = SYMB_NAMELEN;
+   for (i = 0; i < len; i++)
+      h = (h << 5) + h + (unsigned char)name[i];
+   h = (uint16_t)(h * 40503U) >> 3;     // 16 - log2(SYMB_SLOTS)
+   while (g_anSlot[h & (SYMB_SLOTS - 1)])
+   {
+      s = &g_aSymb[g_anSlot[h & (SYMB_SLOTS - 1)] - 1];
+      if (s->len == len && 0 == memcmp(s->name, name, len))
+         return g_anSlot[h & (SYMB_SLOTS - 1)];
+      h++;
+   }
+   if (0 == add || g_nSymbCount == SYMB_MAXCOUNT)
+      return 0;
+   s = &g_aSymb[g_nSymbCount++];
+   memcpy(s->name, name, len);
+   s->len = len;
+   s->flags = 0;
+   s->val = 0;
+   g_anSlot[h & (SYMB_SLOTS - 1)] = g_nSymbCount;
+
+   return g_nSymbCount;
+}
+
+unsigned char symb_read(uint16_t sym, uint16_t *val)
+{
+   *val = g_aSymb[sym - 1].val;
+
+   return g_aSymb[sym - 1].flags;
+}
+
+void symb_write(uint16_t sym, uint16_t val, unsigned char flags)
+{
+   g_aSymb[sym - 1].val = val;
+   g_aSymb[sym - 1].flags = flags;
+}
+
+/*
+ * Text output of assembler core (errors, listing), "\n\r" line ends of
+ * the target system are printed as "\n".
+ */
+void asm_puts(const char *s)
+{
+   if (g_nQuiet)
+      return;
+   for (; *s; s++)
+   {
+      if (*s != '\r')
+         putchar(*s);
+   }
+}
+
+/*
+ * Function of cc65 library used by assembler core.
+ */
+char *utoa(unsigned val, char *buf, int radix)
+{
+   char tmp[34];
+   int i = 0, j = 0;
+
+   do
+   {
+      tmp[i++] = "0123456789ABCDEF"[val % radix];
+      val /= radix;
+   } while (val);
+   while (i > 0)
+      buf[j++] = tmp[--i];
+   buf[j] = 0;
+
+   return buf;
+}